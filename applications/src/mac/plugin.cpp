@@ -4,6 +4,7 @@
 #include "plugin.h"
 #include "terminal.h"
 #include "ui_configwidget.h"
+#include "warmup.h"
 #include <QDir>
 #include <QMessageBox>
 #include <QWidget>
@@ -36,11 +37,11 @@ static void scanRecurse(QStringList &result, const QString &path, const bool abo
 
 Plugin::Plugin()
 {
+    warmup::ConstructionTimer construction(id());
     auto s = settings();
     commonInitialize(s);
 
-    fs_watcher.addPaths(appDirectories());
-    connect(&fs_watcher, &QFileSystemWatcher::directoryChanged, this, &Plugin::updateIndexItems);
+    fs_watch.setPaths(appDirectories());
 
     indexer.parallel = [this](const bool &abort)
     {
@@ -1,5 +1,7 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
+#include "applicationbase.h"
+#include "memoryreport.h"
 #include "pluginbase.h"
 #include "terminal.h"
 #include <QCheckBox>
@@ -133,6 +135,8 @@ void PluginBase::addBaseConfig(QFormLayout *l)
     ALBERT_PROPERTY_CONNECT_CHECKBOX(this, use_acronyms, cb);
 
     l->addRow(tr("Terminal"), createTerminalFormWidget());
+
+    l->addRow(memory::createWidget(id()));
 }
 
 vector<IndexItem> PluginBase::buildIndexItems() const
@@ -168,6 +172,17 @@ vector<IndexItem> PluginBase::buildIndexItems() const
         }
     }
 
+    size_t bytes = applications.capacity() * sizeof(decltype(applications)::value_type)
+                   + memory::estimateIndexItems(r);
+    for (const auto &iapp : applications)
+    {
+        auto app = static_pointer_cast<ApplicationBase>(iapp);
+        bytes += sizeof(ApplicationBase) + memory::estimate(app->id()) + memory::estimate(app->names())
+                 + memory::estimate(app->path()) + memory::estimate(app->subtext())
+                 + memory::estimate(app->iconUrls());
+    }
+    memory::publish(id(), applications.size(), bytes);
+
     return r;
 }
 
@@ -2,7 +2,7 @@
 
 #pragma once
 #include "applications.h"
-#include <QFileSystemWatcher>
+#include "filewatch.h"
 #include <QStringList>
 #include <albert/backgroundexecutor.h>
 #include <albert/extensionplugin.h>
@@ -38,7 +38,7 @@ protected:
     std::vector<albert::IndexItem> buildIndexItems() const;
     static QStringList camelCaseSplit(const QString &s);
 
-    QFileSystemWatcher fs_watcher;
+    filewatch::Subscription fs_watch{[this](const QStringList&){ indexer.run(); }};
     albert::BackgroundExecutor<std::vector<std::shared_ptr<applications::Application>>> indexer;
     std::vector<std::shared_ptr<applications::Application>> applications;
     std::vector<Terminal*> terminals;
@@ -3,6 +3,7 @@
 #include "application.h"
 #include "desktopentryparser.h"
 #include "plugin.h"
+#include "stringpool.h"
 #include <albert/util.h>
 using namespace std;
 using namespace albert;
@@ -99,7 +100,8 @@ Application::Application(const QString &id, const QString &path, ParseOptions po
 
     // Keywords - localestring(s)
     try {
-        auto keywords = p.getLocaleString(root_section, QStringLiteral("Keywords")).split(';', Qt::SkipEmptyParts);
+        auto keywords = stringpool::intern(
+            p.getLocaleString(root_section, QStringLiteral("Keywords")).split(';', Qt::SkipEmptyParts));
         if (description_.isEmpty())
             description_ = keywords.join(", ");
         if (po.use_keywords)
@@ -180,6 +182,52 @@ Application::Application(const QString &id, const QString &path, ParseOptions po
     names_.removeDuplicates();
 }
 
+static const QChar list_separator(0x1f);  // unit separator
+static const QChar field_separator(0x1e);  // record separator
+static const QChar action_separator(0x1d);  // group separator
+
+// Unlike QString::split an empty string yields no parts
+static QStringList split(const QString &s, QChar separator)
+{ return s.isEmpty() ? QStringList() : s.split(separator); }
+
+// Strings are copied out of the mapping, which is unmapped on the next index run
+Application::Application(const Record &r, const Cache &cache)
+{
+    id_ = cache.string(r.id);
+    path_ = cache.string(r.path);
+    names_ = split(cache.string(r.names), list_separator);
+    description_ = cache.string(r.description);
+    icon_ = cache.string(r.icon);
+    exec_ = split(cache.string(r.exec), list_separator);
+    working_dir_ = cache.string(r.working_dir);
+    term_ = r.term;
+    is_terminal_ = r.is_terminal;
+
+    for (const auto &action : split(cache.string(r.actions), action_separator))
+        if (auto fields = action.split(field_separator); fields.size() == 3)
+            desktop_actions_.emplace_back(*this, fields[0], fields[1], split(fields[2], list_separator));
+}
+
+Application::Record Application::toRecord(recordcache::Writer<Record> &cache) const
+{
+    QStringList actions;
+    for (const auto &a : desktop_actions_)
+        actions << QStringList{a.id_, a.name_, a.exec_.join(list_separator)}.join(field_separator);
+
+    return {
+        cache.string(id_),
+        cache.string(path_),
+        cache.string(names_.join(list_separator)),
+        cache.string(description_),
+        cache.string(icon_),
+        cache.string(exec_.join(list_separator)),
+        cache.string(working_dir_),
+        cache.string(actions.join(action_separator)),
+        term_,
+        is_terminal_
+    };
+}
+
 QString Application::subtext() const { return description_; }
 
 QStringList Application::iconUrls() const
@@ -2,9 +2,11 @@
 
 #pragma once
 #include "applicationbase.h"
+#include "recordcache.h"
 #include <QString>
 #include <QUrl>
 #include <albert/item.h>
+#include <memory>
 
 class Application : public ApplicationBase
 {
@@ -19,9 +21,30 @@ public:
         bool use_non_localized_name;
     };
 
+    /// Parsed fields, lists joined by unit separators, for the system cache
+    struct Record
+    {
+        recordcache::StringRef id;
+        recordcache::StringRef path;
+        recordcache::StringRef names;
+        recordcache::StringRef description;
+        recordcache::StringRef icon;
+        recordcache::StringRef exec;
+        recordcache::StringRef working_dir;
+        recordcache::StringRef actions;
+        quint32 term;
+        quint32 is_terminal;
+    };
+
+    using Cache = recordcache::Reader<Record>;
+
     Application(const QString &id, const QString &path, ParseOptions po);
     Application(const Application &) = default;
 
+    Application(const Record &record, const Cache &cache);
+
+    Record toRecord(recordcache::Writer<Record> &cache) const;
+
     QString subtext() const override final;
     QStringList iconUrls() const override final;
     void launch() const override final;
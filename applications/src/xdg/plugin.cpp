@@ -3,13 +3,20 @@
 #include "application.h"
 #include "plugin.h"
 #include "terminal.h"
+#include "trace.h"
 #include "ui_configwidget.h"
+#include "warmup.h"
+#include <QCryptographicHash>
 #include <QRegularExpression>
 #include <QStandardPaths>
 #include <QWidget>
+#include <set>
+#include <unistd.h>
 using namespace std;
 using namespace albert;
 
+static const quint32 SYSTEM_CACHE_VERSION = 1;
+
 static QString normalizedContainerCommand(const QStringList &Exec)
 {
     QString command;
@@ -110,16 +117,43 @@ const map<QString, QStringList> Plugin::exec_args  // command > ExecArg
 static QStringList appDirectories()
 { return QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation); }
 
+// To determine the ID of a desktop file, make its full path relative to
+// the $XDG_DATA_DIRS component in which the desktop file is installed,
+// remove the "applications/" prefix, and turn '/' into '-'. Chop off '.desktop'.
+static QString desktopId(const QString &path)
+{
+    static QRegularExpression re("^.*applications/");
+    return QString(path).remove(re).replace("/","-").chopped(8);
+}
+
+// Host wide, shared by all sessions. Writeable for the first session or a privileged helper.
+static QString sharedCacheDir()
+{ return qEnvironmentVariable("ALBERT_SHARED_CACHE_DIR", QStringLiteral("/var/cache/albert")); }
+
+// Parsing depends on the options, the locale and the desktop
+static QString systemCacheFileName(const Application::ParseOptions &po)
+{
+    auto key = QStringList{
+        QLocale().name(),
+        po.ignore_show_in_keys ? QString() : qEnvironmentVariable("XDG_CURRENT_DESKTOP"),
+        QString::number(po.ignore_show_in_keys),
+        QString::number(po.use_exec),
+        QString::number(po.use_generic_name),
+        QString::number(po.use_keywords),
+        QString::number(po.use_non_localized_name)
+    }.join(',');
+    return QStringLiteral("applications-%1.cache")
+        .arg(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex().left(16));
+}
+
 Plugin* plugin = nullptr;
 
 Plugin::Plugin()
 {
+    warmup::ConstructionTimer construction(id());
     qunsetenv("DESKTOP_AUTOSTART_ID");
     plugin = this;
 
-    fs_watcher.addPaths(appDirectories());
-    connect(&fs_watcher, &QFileSystemWatcher::directoryChanged, this, &Plugin::updateIndexItems);
-
 
     // Load settings
 
@@ -146,14 +180,16 @@ Plugin::Plugin()
             this, &Plugin::updateIndexItems);
 
 
-    // File watches
-
-    for (const auto &path : QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation))
-        for (auto dit = QDirIterator(path, QDir::Dirs|QDir::NoDotDot, QDirIterator::Subdirectories); dit.hasNext();)
-            fs_watcher.addPath(QFileInfo(dit.next()).canonicalFilePath());
+    // File watches, package updates touch many files at once. Deferred, walks the tree.
 
-    connect(&fs_watcher, &QFileSystemWatcher::directoryChanged,
-            this, [this](){ indexer.run(); });
+    warmup::schedule(this, id(), [this]
+    {
+        QStringList watch_paths;
+        for (const auto &path : appDirectories())
+            for (auto dit = QDirIterator(path, QDir::Dirs|QDir::NoDotDot, QDirIterator::Subdirectories); dit.hasNext();)
+                watch_paths << QFileInfo(dit.next()).canonicalFilePath();
+        fs_watch.setPaths(watch_paths);
+    });
 
 
     // Indexer
@@ -163,8 +199,11 @@ Plugin::Plugin()
         // Get a map of unique desktop entries according to the spec
 
         map<QString, QString> desktop_files;  // Desktop id > path
+        QStringList system_files;  // all but the user dir, including shadowed entries
+        const auto user_dir = QStandardPaths::writableLocation(QStandardPaths::ApplicationsLocation);
         for (const QString &dir : appDirectories())
         {
+            TRACE_SCOPE("apps", "scan");
             DEBG << "Scanning desktop entries in:" << dir;
 
             QDirIterator it(dir, QStringList("*.desktop"), QDir::Files,
@@ -173,12 +212,10 @@ Plugin::Plugin()
             while (it.hasNext())
             {
                 auto path = it.next();
+                auto id = desktopId(path);
 
-                // To determine the ID of a desktop file, make its full path relative to
-                // the $XDG_DATA_DIRS component in which the desktop file is installed,
-                // remove the "applications/" prefix, and turn '/' into '-'. Chop off '.desktop'.
-                static QRegularExpression re("^.*applications/");
-                QString id = QString(path).remove(re).replace("/","-").chopped(8);
+                if (dir != user_dir)
+                    system_files << path;
 
                 if (const auto &[dit, success] = desktop_files.emplace(id, path); !success)
                     DEBG << QString("Desktop file '%1' at '%2' will be skipped: Shadowed by '%3'")
@@ -194,13 +231,30 @@ Plugin::Plugin()
             .use_non_localized_name = use_non_localized_name()
         };
 
+        // System entries are read from the shared cache, the user overlay is parsed
+
+        system_files.sort();
+        auto cache = systemCache(system_files, po);
+        set<QString> system_paths(system_files.begin(), system_files.end());
+        map<QString, size_t> cached;  // path > record
+        for (size_t i = 0; cache && i < cache->size(); ++i)
+            cached.emplace(cache->string((*cache)[i].path), i);
+
         // Index the unique desktop files
+        TRACE_SCOPE("apps", "parse");
         vector<shared_ptr<applications::Application>> apps;
         for (const auto &[id, path] : desktop_files)
         {
             if (abort)
                 return apps;
 
+            if (cache && system_paths.count(path))
+            {
+                if (auto it = cached.find(path); it != cached.end())
+                    apps.emplace_back(make_shared<Application>((*cache)[it->second], *cache));
+                continue;  // else skipped while building the cache
+            }
+
             try
             {
                 apps.emplace_back(make_shared<Application>(id, path, po));
@@ -217,6 +271,7 @@ Plugin::Plugin()
 
     indexer.finish = [this](vector<shared_ptr<applications::Application>> &&result)
     {
+        TRACE_SCOPE("apps", "publish");
         applications = ::move(result);
 
         INFO << QStringLiteral("Indexed %1 applications [%2 ms]")
@@ -249,7 +304,10 @@ Plugin::Plugin()
 
         setUserTerminalFromConfig();
 
-        setIndexItems(buildIndexItems());
+        {
+            TRACE_SCOPE("apps", "setIndexItems");
+            setIndexItems(buildIndexItems());
+        }
 
         emit appsChanged();
     };
@@ -257,6 +315,62 @@ Plugin::Plugin()
 
 Plugin::~Plugin() = default;
 
+shared_ptr<const Application::Cache>
+Plugin::systemCache(const QStringList &system_files, Application::ParseOptions po) const
+{
+    TRACE_SCOPE("apps", "system cache");
+    const auto file_name = systemCacheFileName(po);
+    const auto shared_path = QDir(sharedCacheDir()).filePath(file_name);
+
+    // The shared cache is mapped only if written by root or this user, see recordcache.h
+    if (auto c = make_shared<const Application::Cache>(shared_path, SYSTEM_CACHE_VERSION, system_files);
+        c->isValid())
+        return c;
+
+    const auto private_dir = cacheLocation();
+    if (auto c = make_shared<const Application::Cache>(QDir(private_dir).filePath(file_name),
+                                                       SYSTEM_CACHE_VERSION, system_files);
+        c->isValid())
+        return c;
+
+    // First session or changed system entries, build it
+
+    auto stamps = recordcache::Stamp::of(system_files);  // before parsing, changes invalidate
+    recordcache::Writer<Application::Record> writer(SYSTEM_CACHE_VERSION);
+    for (const auto &path : system_files)
+        try {
+            writer.add(Application(desktopId(path), path, po).toRecord(writer));
+        } catch (const exception &) { }  // skipped, see parse
+
+    // Share it unless another user's cache is in the way, i.e. the dir may be
+    // writable but the file not replaceable (sticky dir) or not ours to replace
+    if (QFileInfo fi(shared_path); QFileInfo(sharedCacheDir()).isWritable()
+                                   && (!fi.exists() || fi.ownerId() == getuid()))
+    {
+        if (writer.write(shared_path, stamps, QFileDevice::ReadOwner | QFileDevice::WriteOwner
+                                              | QFileDevice::ReadGroup | QFileDevice::ReadOther))
+        {
+            INFO << "Wrote system application cache" << shared_path;
+            if (auto c = make_shared<const Application::Cache>(shared_path, SYSTEM_CACHE_VERSION, system_files);
+                c->isValid())
+                return c;
+        }
+        else
+            DEBG << "Failed writing shared system application cache" << shared_path;
+    }
+
+    const auto path = QDir(private_dir).filePath(file_name);
+    if (!QDir().mkpath(private_dir) || !writer.write(path, stamps))
+    {
+        WARN << "Failed writing system application cache" << path;
+        return nullptr;
+    }
+    INFO << "Wrote system application cache" << path;
+
+    auto c = make_shared<const Application::Cache>(path, SYSTEM_CACHE_VERSION, system_files);
+    return c->isValid() ? c : nullptr;
+}
+
 QWidget *Plugin::buildConfigWidget()
 {
     auto widget = new QWidget;
@@ -1,6 +1,7 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #pragma once
+#include "application.h"
 #include "pluginbase.h"
 #include <QStringList>
 #include <albert/telemetryprovider.h>
@@ -29,6 +30,9 @@ public:
 
 private:
 
+    std::shared_ptr<const Application::Cache>
+    systemCache(const QStringList &system_files, Application::ParseOptions po) const;
+
     ALBERT_PLUGIN_PROPERTY(bool, ignore_show_in_keys, true)
     ALBERT_PLUGIN_PROPERTY(bool, use_exec, false)
     ALBERT_PLUGIN_PROPERTY(bool, use_generic_name, false)
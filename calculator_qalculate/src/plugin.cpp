@@ -1,7 +1,9 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
 #include "plugin.h"
+#include "trace.h"
 #include "ui_configwidget.h"
+#include "warmup.h"
 #include <QSettings>
 #include <QThread>
 #include <albert/logging.h>
@@ -30,16 +32,22 @@ const QStringList Plugin::icon_urls = {"xdg:calc", ":qalculate"};
 
 Plugin::Plugin()
 {
+    warmup::ConstructionTimer construction(id());
     auto s = settings();
 
-    // init calculator
+    // init calculator, definitions are loaded deferred
     qalc.reset(new Calculator());
-    qalc->loadExchangeRates();
-    qalc->loadGlobalCurrencies();
-    qalc->loadGlobalDefinitions();
-    qalc->loadLocalDefinitions();
     qalc->setPrecision(s->value(CFG_PRECISION, DEF_PRECISION).toInt());
 
+    loader.parallel = [this](const bool &)
+    {
+        lock_guard locker(qalculate_mutex);
+        loadLocked();
+        return true;
+    };
+    loader.finish = [this](bool &&){ warmup::ready(id()); };
+    warmup::schedule(this, id(), [this]{ loader.run(); }, warmup::Ready::Reported);
+
     // evaluation options
     eo.auto_post_conversion = POST_CONVERSION_BEST;
     eo.structuring = STRUCTURING_SIMPLIFY;
@@ -148,9 +156,23 @@ shared_ptr<Item> Plugin::buildItem(const QString &query, const MathStructure &ms
     );
 }
 
+void Plugin::loadLocked()
+{
+    if (loaded)
+        return;
+
+    qalc->loadExchangeRates();
+    qalc->loadGlobalCurrencies();
+    qalc->loadGlobalDefinitions();
+    qalc->loadLocalDefinitions();
+    loaded = true;
+}
+
 std::variant<QStringList, MathStructure>
 Plugin::runQalculateLocked(const albert::Query *query, const EvaluationOptions &eo_)
 {
+    loadLocked();  // queries before the warm-up
+
     auto expression = qalc->unlocalizeExpression(query->string().toStdString(), eo.parse_options);
 
     qalc->startControl();
@@ -179,6 +201,7 @@ Plugin::runQalculateLocked(const albert::Query *query, const EvaluationOptions &
 
 vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 {
+    TRACE_SCOPE("query", "qalculate");
     vector<RankItem> results;
 
     auto trimmed = query->string().trimmed();
@@ -210,6 +233,7 @@ vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 
 void Plugin::handleTriggerQuery(Query *query)
 {
+    TRACE_SCOPE("query", "qalculate");
     auto trimmed = query->string().trimmed();
     if (trimmed.isEmpty())
         return;
@@ -1,6 +1,7 @@
 // Copyright (C) 2023-2024 Manuel Schneider
 
 #pragma once
+#include <albert/backgroundexecutor.h>
 #include <albert/globalqueryhandler.h>
 #include <albert/extensionplugin.h>
 #include <QObject>
@@ -24,6 +25,8 @@ public:
 
 private:
 
+    void loadLocked();
+
     std::variant<QStringList, MathStructure>
     runQalculateLocked(const albert::Query *query, const EvaluationOptions &eo) ;
 
@@ -34,6 +37,8 @@ private:
     EvaluationOptions eo;
     PrintOptions po;
     std::mutex qalculate_mutex;
+    bool loaded = false;  // definitions and exchange rates
+    albert::BackgroundExecutor<bool> loader;
     static const QStringList icon_urls;
 
 };
@@ -1,8 +1,13 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #include "bookmarkitem.h"
+#include "memoryreport.h"
 #include "plugin.h"
+#include "recordcache.h"
+#include "stringpool.h"
+#include "trace.h"
 #include "ui_configwidget.h"
+#include "warmup.h"
 #include <QDir>
 #include <QDirIterator>
 #include <QFileDialog>
@@ -19,6 +24,18 @@ using namespace std;
 static const char* CFG_BM_PATHS = "bookmarks_path";
 static const char* CFG_INDEX_HOSTNAME = "indexHostname";
 static const bool  DEF_INDEX_HOSTNAME = false;
+static const char *CACHE_FILE_NAME = "bookmarks.cache";
+static const quint32 CACHE_VERSION = 1;
+
+namespace {
+struct BookmarkRecord
+{
+    recordcache::StringRef id;
+    recordcache::StringRef name;
+    recordcache::StringRef folder;
+    recordcache::StringRef url;
+};
+}
 
 static const char *app_dirs[] = {
     "BraveSoftware",
@@ -44,7 +61,7 @@ static vector<shared_ptr<BookmarkItem>> parseBookmarks(const QStringList& paths,
             else if (type == "url")
                 items.emplace_back(make_shared<BookmarkItem>(json["guid"].toString(),
                                                              name,
-                                                             parent_name,
+                                                             stringpool::intern(parent_name),
                                                              json["url"].toString()));
         };
 
@@ -54,6 +71,7 @@ static vector<shared_ptr<BookmarkItem>> parseBookmarks(const QStringList& paths,
             return {};
         if (QFile f(path); f.open(QIODevice::ReadOnly))
         {
+            TRACE_SCOPE("chromium", "parse");
             for (const auto &root: QJsonDocument::fromJson(f.readAll()).object().value("roots").toObject())
                 if (root.isObject())
                     recursiveJsonTreeWalker({}, root.toObject(), results);
@@ -68,26 +86,36 @@ static vector<shared_ptr<BookmarkItem>> parseBookmarks(const QStringList& paths,
 
 Plugin::Plugin()
 {
+    warmup::ConstructionTimer construction(id());
     auto s = settings();
     index_hostname_ = s->value(CFG_INDEX_HOSTNAME, DEF_INDEX_HOSTNAME).toBool();
 
     paths_ = s->contains(CFG_BM_PATHS) ? s->value(CFG_BM_PATHS).toStringList() : defaultPaths();
     paths_.sort();
 
-    if (!paths_.isEmpty())
-        fs_watcher_.addPaths(paths_);
+    // Chromium replaces the file (inode change), the watch service rewatches
+    fs_watch_.setPaths(paths_);
 
-    connect(&fs_watcher_, &QFileSystemWatcher::fileChanged, this, [this]{
-        // Update watches. Chromium seems to mv the file (inode change).
-        if (!fs_watcher_.files().isEmpty())
-            fs_watcher_.removePaths(fs_watcher_.files());
-        fs_watcher_.addPaths(paths_);
-        indexer.run();
-    });
+    const auto cache_path = createOrThrow(cacheLocation()).filePath(CACHE_FILE_NAME);
 
-    indexer.parallel = [this](const bool &abort){ return parseBookmarks(paths_, abort); };
+    indexer.parallel = [this, cache_path](const bool &abort)
+    {
+        auto stamps = recordcache::Stamp::of(paths_);  // before parsing, changes invalidate
+        auto bookmarks = parseBookmarks(paths_, abort);
+        if (!abort)
+        {
+            recordcache::Writer<BookmarkRecord> cache(CACHE_VERSION);
+            for (const auto &b : bookmarks)
+                cache.add({cache.string(b->id_), cache.string(b->name_),
+                           cache.string(b->folder_), cache.string(b->url_)});
+            if (!cache.write(cache_path, stamps))
+                WARN << "Failed writing bookmark cache" << cache_path;
+        }
+        return bookmarks;
+    };
     indexer.finish = [this](vector<shared_ptr<BookmarkItem>> && res)
     {
+        TRACE_SCOPE("chromium", "publish");
         INFO << QStringLiteral("Indexed %1 bookmarks [%2 ms]")
                     .arg(res.size()).arg(indexer.runtime.count());
 
@@ -96,8 +124,23 @@ Plugin::Plugin()
         bookmarks_ = ::move(res);
 
         updateIndexItems();
+        warmup::ready(id());
     };
-    indexer.run();
+
+    // Warm start from the cache if the bookmark files did not change
+    if (recordcache::Reader<BookmarkRecord> cache(cache_path, CACHE_VERSION, paths_); cache.isValid())
+    {
+        for (size_t i = 0; i < cache.size(); ++i)
+            bookmarks_.emplace_back(make_shared<BookmarkItem>(cache.string(cache[i].id),
+                                                              cache.string(cache[i].name),
+                                                              stringpool::intern(cache.string(cache[i].folder)),
+                                                              cache.string(cache[i].url)));
+        DEBG << QStringLiteral("Loaded %1 bookmarks from cache").arg(bookmarks_.size());
+        emit statusChanged(tr("%n bookmarks indexed.", nullptr, bookmarks_.size()));
+        updateIndexItems();
+    }
+    else
+        warmup::schedule(this, id(), [this]{ indexer.run(); }, warmup::Ready::Reported);
 }
 
 void Plugin::setPaths(const QStringList& paths)
@@ -105,11 +148,7 @@ void Plugin::setPaths(const QStringList& paths)
     paths_ = paths;
     paths_.sort();
 
-    // Chromium seems to mv the file (inode change).
-    if (!fs_watcher_.files().isEmpty())
-        fs_watcher_.removePaths(fs_watcher_.files());
-    if(!paths_.isEmpty())
-        fs_watcher_.addPaths(paths_);
+    fs_watch_.setPaths(paths_);
 
     settings()->setValue(CFG_BM_PATHS, paths_);
 
@@ -132,12 +171,19 @@ void Plugin::resetPaths() { setPaths(defaultPaths()); }
 
 void Plugin::updateIndexItems()
 {
+    TRACE_SCOPE("chromium", "setIndexItems");
     vector<IndexItem> index_items;
+    size_t bytes = bookmarks_.capacity() * sizeof(decltype(bookmarks_)::value_type);
     for (const auto &bookmark : bookmarks_){
+        bytes += sizeof(BookmarkItem)
+                 + memory::estimate(bookmark->id_) + memory::estimate(bookmark->name_)
+                 + memory::estimate(bookmark->folder_) + memory::estimate(bookmark->url_);
         index_items.emplace_back(static_pointer_cast<Item>(bookmark), bookmark->name_);
         if (index_hostname_)
-            index_items.emplace_back(static_pointer_cast<Item>(bookmark), QUrl(bookmark->url_).host());
+            index_items.emplace_back(static_pointer_cast<Item>(bookmark),
+                                     stringpool::intern(QUrl(bookmark->url_).host()));
     }
+    memory::publish(id(), bookmarks_.size(), bytes + memory::estimateIndexItems(index_items));
     setIndexItems(::move(index_items));
 }
 
@@ -164,6 +210,8 @@ QWidget *Plugin::buildConfigWidget()
     connect(this, &Plugin::statusChanged,
             ui.label_status, &QLabel::setText);
 
+    ui.verticalLayout->addWidget(memory::createWidget(id(), w));
+
     connect(ui.pushButton_add, &QPushButton::clicked,
             this, [this, w, m = string_list_model]()
             {
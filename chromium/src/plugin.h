@@ -1,10 +1,10 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #pragma once
+#include "filewatch.h"
 #include <albert/indexqueryhandler.h>
 #include <albert/backgroundexecutor.h>
 #include <albert/extensionplugin.h>
-#include <QFileSystemWatcher>
 #include <memory>
 class BookmarkItem;
 
@@ -26,7 +26,7 @@ private:
     void resetPaths();
     void setPaths(const QStringList &paths);
 
-    QFileSystemWatcher fs_watcher_;
+    filewatch::Subscription fs_watch_{[this](const QStringList&){ indexer.run(); }};
     albert::BackgroundExecutor<std::vector<std::shared_ptr<BookmarkItem>>> indexer;
     QStringList paths_;
     bool index_hostname_;
@@ -1,6 +1,9 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
+#include "memoryreport.h"
 #include "plugin.h"
+#include "trace.h"
+#include "warmup.h"
 #include <QCheckBox>
 #include <QDir>
 #include <QFile>
@@ -15,7 +18,6 @@
 #include <QSpinBox>
 #include <albert/extensionregistry.h>
 #include <albert/logging.h>
-#include <albert/matcher.h>
 #include <albert/plugin/snippets.h>
 #include <albert/standarditem.h>
 #include <albert/util.h>
@@ -37,6 +39,8 @@ Plugin::Plugin():
     clipboard(QGuiApplication::clipboard()),
     snippets(registry(), "snippets")
 {
+    warmup::ConstructionTimer construction(id());
+
     // Load settings
 
     auto s = settings();
@@ -44,37 +48,25 @@ Plugin::Plugin():
     length = s->value(CFG_HISTORY_LENGTH, DEF_HISTORY_LENGTH).toUInt();
 
 
-    // Load history, if configured
-
-    if (persistent)
-    {
-        if (QFile file(QDir(dataLocation()).filePath(HISTORY_FILE_NAME));
-            file.open(QIODevice::ReadOnly | QIODevice::Text))
-        {
-            DEBG << "Reading clipboard history from" << file.fileName();
-            const auto arr = QJsonDocument::fromJson(file.readAll()).array();
-            for (const auto &value : arr)
-            {
-                const auto object = value.toObject();
-                history.emplace_back(object["text"].toString(),
-                                     QDateTime::fromSecsSinceEpoch(object["datetime"].toInt()));
-            }
-            file.close();
-        }
-        else
-            DEBG << "Failed reading from clipboard history.";
-    }
+    historyChanged();
 
 
-    // Init clipboard pull timer
+    // Load history and start the clipboard pull timer deferred
 
-    timer.start(500);
     connect(&timer, &QTimer::timeout, this, &Plugin::checkClipboard);
+    warmup::schedule(this, id(), [this]
+    {
+        {
+            unique_lock lock(mutex);
+            loadHistory();
+        }
+        timer.start(500);
+    });
 }
 
 Plugin::~Plugin()
 {
-    if (persistent)
+    if (persistent && history_loaded)
     {
         QJsonArray array;
         for (const auto &entry : history)
@@ -103,66 +95,119 @@ Plugin::~Plugin()
     }
 }
 
+void Plugin::loadHistory()
+{
+    history_loaded = true;
+    if (!persistent)
+        return;
+
+    if (QFile file(QDir(dataLocation()).filePath(HISTORY_FILE_NAME));
+        file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        DEBG << "Reading clipboard history from" << file.fileName();
+        const auto arr = QJsonDocument::fromJson(file.readAll()).array();
+        for (const auto &value : arr)
+        {
+            const auto object = value.toObject();
+            history.emplace_back(object["text"].toString(),
+                                 QDateTime::fromSecsSinceEpoch(object["datetime"].toInt()));
+        }
+        file.close();
+        historyChanged();
+    }
+    else
+        DEBG << "Failed reading from clipboard history.";
+}
+
 QString Plugin::defaultTrigger() const { return " "; }
 
 void Plugin::handleTriggerQuery(Query *query)
 {
+    TRACE_SCOPE("query", "clipboard");
     QLocale loc;
-    int rank = 0;
-    Matcher matcher(query->string());
+    batchmatch::BatchMatcher matcher(query->string());
 
     shared_lock l(mutex);
 
-    for (const auto &entry : history)
+    auto add = [&](int rank, const ClipboardEntry &entry)
     {
-        ++rank;
-        if (matcher.match(entry.text))
-        {
-            static const auto tr_cp = tr("Copy and paste");
-            static const auto tr_c = tr("Copy");
-            static const auto tr_r = tr("Remove");
+        static const auto tr_cp = tr("Copy and paste");
+        static const auto tr_c = tr("Copy");
+        static const auto tr_r = tr("Remove");
 
-            vector<Action> actions;
-
-            if(havePasteSupport())
-                actions.emplace_back(
-                    "c", tr_cp,
-                    [t=entry.text](){ setClipboardTextAndPaste(t); }
-                );
+        vector<Action> actions;
 
+        if(havePasteSupport())
             actions.emplace_back(
-                "cp", tr_c,
-                [t=entry.text](){ setClipboardText(t); }
+                "c", tr_cp,
+                [t=entry.text](){ setClipboardTextAndPaste(t); }
             );
 
+        actions.emplace_back(
+            "cp", tr_c,
+            [t=entry.text](){ setClipboardText(t); }
+        );
+
+        actions.emplace_back(
+            "r", tr_r,
+            [this, t=entry.text]()
+            {
+                lock_guard lock(mutex);
+                this->history.remove_if([t](const auto& ce){ return ce.text == t; });
+                historyChanged();
+            }
+        );
+
+        if (snippets)
             actions.emplace_back(
-                "r", tr_r,
+                "s", tr("Save as snippet"),
                 [this, t=entry.text]()
                 {
-                    lock_guard lock(mutex);
-                    this->history.remove_if([t](const auto& ce){ return ce.text == t; });
-                }
-            );
-
-            if (snippets)
-                actions.emplace_back(
-                    "s", tr("Save as snippet"),
-                    [this, t=entry.text]()
-                    {
-                        snippets->addSnippet(t);
-                    });
-
-            query->add(
-                StandardItem::make(
-                    id(),
-                    entry.text,
-                    QString("#%1 %2").arg(rank).arg(loc.toString(entry.datetime, QLocale::LongFormat)),
-                    {":clipboard"},
-                    ::move(actions)
-                )
-            );
+                    snippets->addSnippet(t);
+                });
+
+        query->add(
+            StandardItem::make(
+                id(),
+                entry.text,
+                QString("#%1 %2").arg(rank).arg(loc.toString(entry.datetime, QLocale::LongFormat)),
+                {":clipboard"},
+                ::move(actions)
+            )
+        );
+    };
+
+    // Typing mostly extends the previous query, verify its matches only
+    vector<pair<int, const ClipboardEntry*>> matches;
+    if (auto candidates = refinement_cache.candidates(query->string(), history_generation))
+    {
+        for (const auto &[rank, entry] : *candidates)
+        {
+            if (!query->isValid())
+                return;
+            if (matcher.match(history_candidates, rank - 1) >= 0)
+            {
+                matches.emplace_back(rank, entry);
+                add(rank, *entry);
+            }
         }
     }
+    else
+    {
+        bool valid = true;
+        matcher.matchAll(history_candidates, [&](size_t i, float)
+        {
+            if (!(valid = query->isValid()))
+                return false;
+            matches.emplace_back(i + 1, history_entries[i]);
+            add(i + 1, *history_entries[i]);
+            return true;
+        });
+        if (!valid)
+            return;
+    }
+
+    refinement_cache.store(query->string(), history_generation, ::move(matches));
 }
 
 QWidget *Plugin::buildConfigWidget()
@@ -189,8 +234,11 @@ QWidget *Plugin::buildConfigWidget()
                 lock_guard lock(mutex);
                 if (length < history.size())
                     history.resize(length);
+                historyChanged();
             });
 
+    l->addRow(memory::createWidget(id()));
+
     w->setLayout(l);
     return w;
 }
@@ -217,4 +265,25 @@ void Plugin::checkClipboard()
     // adjust lenght
     if (length < history.size())
         history.resize(length);
+
+    historyChanged();
+}
+
+void Plugin::historyChanged()
+{
+    ++history_generation;
+
+    history_candidates = {};
+    history_entries.clear();
+    for (const auto &entry : history)
+    {
+        history_candidates.add(entry.text);
+        history_entries.emplace_back(&entry);
+    }
+
+    // std::list node: two pointers and the entry
+    size_t bytes = history_candidates.bytes() + history_entries.capacity() * sizeof(void*);
+    for (const auto &entry : history)
+        bytes += 2 * sizeof(void*) + sizeof(ClipboardEntry) + memory::estimate(entry.text);
+    memory::publish(id(), history.size(), bytes);
 }
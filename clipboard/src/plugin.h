@@ -1,6 +1,8 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #pragma once
+#include "batchmatcher.h"
+#include "refinementcache.h"
 #include <QClipboard>
 #include <QDateTime>
 #include <QTimer>
@@ -38,13 +40,20 @@ public:
 
 private:
     void checkClipboard();
+    void loadHistory();  // requires mutex
+    void historyChanged();  // requires mutex
 
     QTimer timer;
     QClipboard * const clipboard;
     uint length;
     std::list<ClipboardEntry> history;
     bool persistent;
+    bool history_loaded = false;  // deferred to the warm-up, do not overwrite the file before
     std::shared_mutex mutex;
+    quint64 history_generation = 0;  // incremented on changes of history, guarded by mutex
+    RefinementCache<std::pair<int, const ClipboardEntry*>> refinement_cache;  // rank, entry
+    batchmatch::Candidates history_candidates;  // in history order, guarded by mutex
+    std::vector<const ClipboardEntry*> history_entries;  // same order, guarded by mutex
     // explicit current, such that users can delete recent ones
     QString clipboard_text;
     
@@ -0,0 +1,280 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+///
+/// Matching of one query against many candidate strings.
+///
+/// Candidates are case folded, stripped of diacritics and split into words once,
+/// when they are added. The folded words are stored contiguously, each preceded
+/// by a space. A query word matches if it is a prefix of a candidate word, i.e.
+/// if " <word>" occurs in the folded candidate. The query is folded once per
+/// query and the buffer is scanned with SIMD substring search (AVX2 or SSE2,
+/// selected at runtime, scalar elsewhere).
+///
+/// The semantics follow the default albert::Matcher (non fuzzy, case and
+/// diacritics insensitive, any word order, every query word a word prefix),
+/// except that several query words may match the same candidate word. Scores
+/// are in [0,1] like albert::Match scores and can be passed to RankItem. An
+/// empty query matches every candidate with score 0.
+///
+/// Candidates are immutable after construction and BatchMatcher is const, i.e.
+/// both can be shared across threads.
+///
+namespace batchmatch
+{
+
+namespace detail
+{
+
+static constexpr size_t npos = size_t(-1);
+
+// Finds needle (m > 0) in haystack starting at `from`
+inline size_t findScalar(const char16_t *h, size_t n, const char16_t *p, size_t m, size_t from)
+{
+    for (size_t i = from; i + m <= n; ++i)
+        if (h[i] == p[0] && std::memcmp(h + i + 1, p + 1, (m - 1) * sizeof(char16_t)) == 0)
+            return i;
+    return npos;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Compares first and last needle char at 8 positions per step, verifies candidates
+__attribute__((target("sse2")))
+inline size_t findSse2(const char16_t *h, size_t n, const char16_t *p, size_t m, size_t from)
+{
+    const __m128i first = _mm_set1_epi16((short)p[0]);
+    const __m128i last = _mm_set1_epi16((short)p[m - 1]);
+    size_t i = from;
+    for (; i + m - 1 + 8 <= n; i += 8)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(h + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(h + i + m - 1));
+        auto mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, first),
+                                                              _mm_cmpeq_epi16(b, last)));
+        while (mask)
+        {
+            const auto bit = (unsigned)__builtin_ctz(mask);
+            const auto pos = i + bit / 2;
+            if (std::memcmp(h + pos + 1, p + 1, (m - 1) * sizeof(char16_t)) == 0)
+                return pos;
+            mask &= ~(3u << bit);
+        }
+    }
+    return findScalar(h, n, p, m, i);
+}
+
+// Same as findSse2 with 16 positions per step
+__attribute__((target("avx2")))
+inline size_t findAvx2(const char16_t *h, size_t n, const char16_t *p, size_t m, size_t from)
+{
+    const __m256i first = _mm256_set1_epi16((short)p[0]);
+    const __m256i last = _mm256_set1_epi16((short)p[m - 1]);
+    size_t i = from;
+    for (; i + m - 1 + 16 <= n; i += 16)
+    {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(h + i));
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(h + i + m - 1));
+        auto mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi16(a, first),
+                                                                    _mm256_cmpeq_epi16(b, last)));
+        while (mask)
+        {
+            const auto bit = (unsigned)__builtin_ctz(mask);
+            const auto pos = i + bit / 2;
+            if (std::memcmp(h + pos + 1, p + 1, (m - 1) * sizeof(char16_t)) == 0)
+                return pos;
+            mask &= ~(3u << bit);
+        }
+    }
+    return findSse2(h, n, p, m, i);
+}
+
+#endif
+
+using FindFunction = size_t(*)(const char16_t*, size_t, const char16_t*, size_t, size_t);
+
+inline FindFunction findFunction()
+{
+    static const FindFunction f = []() -> FindFunction
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &findAvx2;
+        if (__builtin_cpu_supports("sse2"))
+            return &findSse2;
+#endif
+        return &findScalar;
+    }();
+    return f;
+}
+
+inline size_t find(const char16_t *h, size_t n, const char16_t *p, size_t m, size_t from)
+{ return m > n || from > n - m ? npos : findFunction()(h, n, p, m, from); }
+
+// Appends the folded words of s, each preceded by a space. Returns the number of word chars.
+inline size_t fold(const QString &s, std::vector<char16_t> &out)
+{
+    const bool ascii = std::all_of(s.begin(), s.end(), [](QChar c){ return c.unicode() < 0x80; });
+    const QString folded = ascii ? s.toLower() : s.normalized(QString::NormalizationForm_D).toCaseFolded();
+
+    size_t chars = 0;
+    bool in_word = false;
+    for (const QChar c : folded)
+    {
+        if (c.category() == QChar::Mark_NonSpacing)  // diacritics, decomposed above
+            continue;
+        if (c.isSpace() || c.isPunct() || c.isSymbol())
+        {
+            in_word = false;
+            continue;
+        }
+        if (!in_word)
+        {
+            out.push_back(u' ');
+            in_word = true;
+        }
+        out.push_back(c.unicode());
+        ++chars;
+    }
+    return chars;
+}
+
+}
+
+
+class Candidates
+{
+public:
+
+    /// Adds a candidate, returns its index
+    size_t add(const QString &s)
+    {
+        begin_.push_back((quint32)text_.size());
+        detail::fold(s, text_);
+        end_.push_back((quint32)text_.size());
+        length_.push_back((quint32)s.size());
+        return begin_.size() - 1;
+    }
+
+    void reserve(size_t count, size_t chars)
+    {
+        begin_.reserve(count);
+        end_.reserve(count);
+        length_.reserve(count);
+        text_.reserve(chars);
+    }
+
+    size_t size() const { return begin_.size(); }
+
+    /// Heap held, for memory reports
+    size_t bytes() const
+    {
+        return text_.capacity() * sizeof(char16_t)
+               + (begin_.capacity() + end_.capacity() + length_.capacity()) * sizeof(quint32);
+    }
+
+private:
+
+    friend class BatchMatcher;
+
+    std::vector<char16_t> text_;
+    std::vector<quint32> begin_;
+    std::vector<quint32> end_;
+    std::vector<quint32> length_;  // unfolded, for scores
+
+};
+
+
+class BatchMatcher
+{
+public:
+
+    explicit BatchMatcher(const QString &query)
+    {
+        std::vector<char16_t> folded;
+        query_chars_ = detail::fold(query, folded);
+
+        // " word" patterns, longest first since it is most selective
+        for (size_t i = 0; i < folded.size();)
+        {
+            auto j = std::find(folded.begin() + i + 1, folded.end(), u' ') - folded.begin();
+            words_.emplace_back(folded.begin() + i, folded.begin() + j);
+            i = j;
+        }
+        std::stable_sort(words_.begin(), words_.end(),
+                         [](const auto &a, const auto &b){ return a.size() > b.size(); });
+    }
+
+    /// Score of the candidate, negative if it does not match
+    float match(const Candidates &c, size_t i) const
+    {
+        for (const auto &w : words_)
+            if (detail::find(c.text_.data() + c.begin_[i], c.end_[i] - c.begin_[i],
+                             w.data(), w.size(), 0) == detail::npos)
+                return -1.f;
+        return score(c, i);
+    }
+
+    /// Score of a single string, folded on the fly. Negative if it does not match.
+    float match(const QString &s) const
+    {
+        Candidates c;
+        c.add(s);
+        return match(c, 0);
+    }
+
+    /// Calls `f(index, score)` for the matching candidates in index order until f returns false
+    template<class F>
+    void matchAll(const Candidates &c, F &&f) const
+    {
+        if (words_.empty())
+        {
+            for (size_t i = 0; i < c.size(); ++i)
+                if (!f(i, 0.f))
+                    return;
+            return;
+        }
+
+        // Scan the entire buffer for the most selective word, verify the others per candidate
+        const auto &w = words_.front();
+        const auto *text = c.text_.data();
+        const size_t n = c.text_.size();
+        size_t i = 0;
+        size_t pos = detail::find(text, n, w.data(), w.size(), 0);
+        while (pos != detail::npos)
+        {
+            while (c.end_[i] <= pos)
+                ++i;
+
+            bool matches = true;
+            for (size_t k = 1; matches && k < words_.size(); ++k)
+                matches = detail::find(text + c.begin_[i], c.end_[i] - c.begin_[i],
+                                       words_[k].data(), words_[k].size(), 0) != detail::npos;
+
+            if (matches && !f(i, score(c, i)))
+                return;
+
+            pos = detail::find(text, n, w.data(), w.size(), c.end_[i]);  // next candidate
+        }
+    }
+
+private:
+
+    float score(const Candidates &c, size_t i) const
+    { return c.length_[i] ? std::min(1.f, (float)query_chars_ / (float)c.length_[i]) : 0.f; }
+
+    std::vector<std::vector<char16_t>> words_;
+    size_t query_chars_;
+
+};
+
+}
@@ -0,0 +1,25 @@
+# Code shared by the plugins of this repository.
+#
+# Usage in a plugin CMakeLists.txt, after albert_plugin():
+#
+#   include(../common/common.cmake)
+#   albert_plugin_common(${PROJECT_NAME})
+
+option(ALBERT_PLUGINS_TRACING "Compile trace spans into the plugins (see common/trace.h)" OFF)
+
+set(ALBERT_PLUGINS_COMMON_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+# Built once, by the first plugin including this file
+if (NOT TARGET albert-plugins-common)
+    add_subdirectory(${ALBERT_PLUGINS_COMMON_DIR} ${CMAKE_BINARY_DIR}/albert-plugins-common)
+endif()
+
+function(albert_plugin_common target)
+    target_link_libraries(${target} PRIVATE albert-plugins-common)
+    # Plugins are installed to <libdir>/albert, the library to <libdir>
+    if (APPLE)
+        set_property(TARGET ${target} APPEND PROPERTY INSTALL_RPATH "@loader_path/..")
+    else()
+        set_property(TARGET ${target} APPEND PROPERTY INSTALL_RPATH "$ORIGIN/..")
+    endif()
+endfunction()
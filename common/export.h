@@ -0,0 +1,10 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QtGlobal>
+
+#if defined(ALBERT_PLUGINS_COMMON_LIBRARY)
+#define COMMON_EXPORT Q_DECL_EXPORT
+#else
+#define COMMON_EXPORT Q_DECL_IMPORT
+#endif
@@ -0,0 +1,77 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "filewatch.h"
+using namespace filewatch;
+using namespace std;
+
+Service &Service::instance()
+{
+    static Service s;
+    return s;
+}
+
+void Service::subscribe(Subscription *subscription, const QString &path)
+{
+    auto &subscribers = subscribers_[path];
+    if (subscribers.empty() && watcher() && QFileInfo::exists(path))
+        watcher()->addPath(path);  // non existing paths are armed by rearm()
+    subscribers.insert(subscription);
+}
+
+void Service::unsubscribe(Subscription *subscription, const QString &path)
+{
+    if (auto it = subscribers_.find(path); it != subscribers_.end())
+    {
+        it->second.erase(subscription);
+        if (it->second.empty())
+        {
+            subscribers_.erase(it);
+            if (watcher())
+                watcher()->removePath(path);
+        }
+    }
+}
+
+void Service::rearm(const QStringList &paths)
+{
+    if (!watcher())
+        return;
+    auto watched = watcher()->files() + watcher()->directories();
+    set<QString> lost;
+    for (const auto &path : paths)
+        if (subscribers_.count(path))
+            lost.insert(path);
+    for (const auto &path : watched)
+        lost.erase(path);
+    for (const auto &path : lost)
+        if (QFileInfo::exists(path))
+            watcher()->addPath(path);
+}
+
+// Deleted with the application, i.e. after the plugins
+QFileSystemWatcher *Service::watcher()
+{
+    if (!watcher_ && !watcher_created_ && QCoreApplication::instance())
+    {
+        watcher_created_ = true;
+        watcher_ = new QFileSystemWatcher(QCoreApplication::instance());
+        QObject::connect(watcher_, &QFileSystemWatcher::directoryChanged,
+                         watcher_, [this](const QString &path){ onChanged(path); });
+        QObject::connect(watcher_, &QFileSystemWatcher::fileChanged,
+                         watcher_, [this](const QString &path)
+        {
+            // Replaced files lose their watch
+            if (!watcher_->files().contains(path) && QFileInfo::exists(path))
+                watcher_->addPath(path);
+            onChanged(path);
+        });
+    }
+    return watcher_;
+}
+
+void Service::onChanged(const QString &path)
+{
+    if (auto it = subscribers_.find(path); it != subscribers_.end())
+        for (auto *subscription : it->second)
+            subscription->notify(path);
+}
@@ -0,0 +1,159 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "export.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QPointer>
+#include <QStringList>
+#include <QTimer>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <set>
+
+///
+/// File system watches shared by all plugins of the process.
+///
+/// A single QFileSystemWatcher (i.e. a single inotify instance on Linux) is
+/// multiplexed across all subscriptions. Paths watched by several subscriptions
+/// are watched once. Change events are collected per subscription and delivered
+/// as one batch of changed paths once no further event arrived for `debounce`,
+/// but at the latest `max_delay` after the first event of the batch.
+///
+/// Watched files that are replaced atomically (rename over the original, as
+/// browsers and editors do) are watched again automatically.
+///
+/// Subscriptions have to be created, used and destroyed in the main thread.
+/// The service is defined in the albert-plugins-common library, hence shared by
+/// all plugins.
+///
+namespace filewatch
+{
+
+class Subscription;
+
+class COMMON_EXPORT Service
+{
+public:
+
+    static Service &instance();
+
+    void subscribe(Subscription *subscription, const QString &path);
+
+    void unsubscribe(Subscription *subscription, const QString &path);
+
+    /// Watches paths again whose watch got lost, i.e. deleted and recreated paths
+    void rearm(const QStringList &paths);
+
+    /// Count of distinct watched paths
+    size_t size() const { return subscribers_.size(); }
+
+private:
+
+    Service() = default;
+
+    QFileSystemWatcher *watcher();
+    void onChanged(const QString &path);
+
+    QPointer<QFileSystemWatcher> watcher_;
+    bool watcher_created_ = false;
+    std::map<QString, std::set<Subscription*>> subscribers_;
+
+};
+
+
+class Subscription
+{
+public:
+
+    using Callback = std::function<void(const QStringList &changed_paths)>;
+
+    explicit Subscription(Callback callback,
+                          std::chrono::milliseconds debounce = std::chrono::milliseconds(500),
+                          std::chrono::milliseconds max_delay = std::chrono::seconds(5)):
+        callback_(std::move(callback)), debounce_(debounce), max_delay_(max_delay)
+    {
+        timer_.setSingleShot(true);
+        QObject::connect(&timer_, &QTimer::timeout, &timer_, [this]{ flush(); });
+    }
+
+    ~Subscription() { setPaths({}); }
+
+    Subscription(const Subscription&) = delete;
+    Subscription &operator=(const Subscription&) = delete;
+
+    const QStringList &paths() const { return paths_; }
+
+    void setPaths(const QStringList &paths)
+    {
+        std::set<QString> next(paths.begin(), paths.end());
+        for (const auto &path : paths_)
+            if (!next.count(path))
+                Service::instance().unsubscribe(this, path);
+        std::set<QString> current(paths_.begin(), paths_.end());
+        for (const auto &path : next)
+            if (!current.count(path))
+                Service::instance().subscribe(this, path);
+        paths_ = QStringList(next.begin(), next.end());
+        Service::instance().rearm(paths_);
+
+        // Drop pending events of paths no longer watched
+        for (auto it = pending_.begin(); it != pending_.end();)
+            it = next.count(*it) ? std::next(it) : pending_.erase(it);
+        if (pending_.empty())
+            cancel();
+    }
+
+    void addPaths(const QStringList &paths) { setPaths(paths_ + paths); }
+
+    void addPath(const QString &path) { setPaths(paths_ + QStringList{path}); }
+
+    /// Delivers pending changes now
+    void flush()
+    {
+        timer_.stop();
+        batch_age_.invalidate();
+        if (pending_.empty())
+            return;
+        QStringList changed(pending_.begin(), pending_.end());
+        pending_.clear();
+        callback_(changed);
+    }
+
+    /// Drops pending changes
+    void cancel()
+    {
+        timer_.stop();
+        batch_age_.invalidate();
+        pending_.clear();
+    }
+
+private:
+
+    void notify(const QString &path)
+    {
+        pending_.insert(path);
+        if (!batch_age_.isValid())
+            batch_age_.start();
+
+        using namespace std::chrono;
+        auto remaining = max_delay_ - milliseconds(batch_age_.elapsed());
+        timer_.start(std::max(milliseconds(0), std::min(debounce_, remaining)));
+    }
+
+    friend class Service;
+
+    const Callback callback_;
+    const std::chrono::milliseconds debounce_;
+    const std::chrono::milliseconds max_delay_;
+    QStringList paths_;
+    std::set<QString> pending_;
+    QElapsedTimer batch_age_;
+    QTimer timer_;
+
+};
+
+}
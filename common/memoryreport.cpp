@@ -0,0 +1,9 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "memoryreport.h"
+
+memory::State &memory::state()
+{
+    static State s;
+    return s;
+}
@@ -0,0 +1,118 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "export.h"
+#include <QLabel>
+#include <QLocale>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <albert/logging.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+///
+/// Estimates of the resident index memory of the plugins.
+///
+/// Indexing plugins publish the item count and an estimate of the bytes held by
+/// their index (items, strings, auxiliary structures) whenever they publish new
+/// index items. The estimates are heap payload sizes. Allocator overhead and
+/// albert's internal index are not accounted.
+///
+/// Exceeding the soft budget logs a warning. The budget is set by the debug
+/// plugin or the environment variable ALBERT_MEMORY_BUDGET_MB. Zero disables it.
+///
+/// The state is defined in the albert-plugins-common library, hence shared by
+/// all plugins of the process.
+///
+namespace memory
+{
+
+struct Report
+{
+    size_t items = 0;
+    size_t bytes = 0;
+};
+
+struct State
+{
+    std::mutex mutex;
+    std::map<QString, Report> reports;
+    std::atomic<size_t> budget = qEnvironmentVariableIntValue("ALBERT_MEMORY_BUDGET_MB") * 1024ull * 1024ull;
+};
+
+COMMON_EXPORT State &state();
+
+/// Heap payload of a string, zero for static data. Implicitly shared data is
+/// counted for every copy, i.e. the estimate errs on the large side.
+inline size_t estimate(const QString &s)
+{ return s.capacity() ? size_t(s.capacity()) * sizeof(QChar) + 16 : 0; }
+
+inline size_t estimate(const QStringList &l)
+{
+    size_t bytes = size_t(l.capacity()) * sizeof(QString);
+    for (const auto &s : l)
+        bytes += estimate(s);
+    return bytes;
+}
+
+/// Vector and strings of albert::IndexItems, excluding the items
+template<class IndexItems>
+inline size_t estimateIndexItems(const IndexItems &index_items)
+{
+    size_t bytes = index_items.capacity() * sizeof(typename IndexItems::value_type);
+    for (const auto &index_item : index_items)
+        bytes += estimate(index_item.string);
+    return bytes;
+}
+
+inline QString formatBytes(size_t bytes)
+{ return QLocale().formattedDataSize(qint64(bytes)); }
+
+inline void setBudget(size_t bytes) { state().budget = bytes; }
+
+inline size_t budget() { return state().budget; }
+
+inline void publish(const QString &plugin_id, size_t items, size_t bytes)
+{
+    auto &s = state();
+    {
+        std::lock_guard lock(s.mutex);
+        s.reports[plugin_id] = {items, bytes};
+    }
+
+    if (auto b = budget(); b && bytes > b)
+        WARN << QStringLiteral("Index memory of '%1' exceeds the soft budget: %2 > %3 (%4 items)")
+                    .arg(plugin_id, formatBytes(bytes), formatBytes(b)).arg(items);
+}
+
+inline std::map<QString, Report> reports()
+{
+    auto &s = state();
+    std::lock_guard lock(s.mutex);
+    return s.reports;
+}
+
+inline QString text(const QString &plugin_id)
+{
+    auto r = reports();
+    if (auto it = r.find(plugin_id); it != r.end())
+        return QStringLiteral("%1 items, ~%2 index memory")
+            .arg(it->second.items).arg(formatBytes(it->second.bytes));
+    return {};
+}
+
+/// Label showing the report of `plugin_id`, for config widgets
+inline QLabel *createWidget(const QString &plugin_id, QWidget *parent = nullptr)
+{
+    auto *label = new QLabel(text(plugin_id), parent);
+    label->setEnabled(false);  // secondary information
+    auto *timer = new QTimer(label);
+    QObject::connect(timer, &QTimer::timeout, label,
+                     [label, plugin_id]{ label->setText(text(plugin_id)); });
+    timer->start(1000);
+    return label;
+}
+
+}
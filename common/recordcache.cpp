@@ -0,0 +1,156 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "recordcache.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace recordcache;
+using namespace recordcache::detail;
+using namespace std;
+
+static constexpr char magic[8] = {'A','L','B','R','C','A','C','H'};
+static constexpr quint32 format_version = 1;
+
+namespace
+{
+
+struct FileStamp
+{
+    StringRef path;
+    qint64 mtime;
+    qint64 size;
+};
+
+static_assert(sizeof(Header) % 8 == 0);
+static_assert(sizeof(FileStamp) % 8 == 0);
+
+quint64 fnv1a(const uchar *data, size_t size, quint64 hash = 0xcbf29ce484222325ull)
+{
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+size_t padded(size_t size) { return (size + 7) & ~size_t(7); }
+
+}
+
+
+Stamp Stamp::of(const QString &path)
+{
+    QFileInfo fi(path);
+    return {path,
+            fi.exists() ? fi.lastModified().toMSecsSinceEpoch() : -1,
+            fi.exists() ? fi.size() : -1};
+}
+
+vector<Stamp> Stamp::of(const QStringList &paths)
+{
+    vector<Stamp> stamps;
+    for (const auto &path : paths)
+        stamps.emplace_back(of(path));
+    return stamps;
+}
+
+
+bool detail::write(const QString &path, quint32 record_version, quint32 record_size,
+                   const vector<StringRef> &stamp_paths, const vector<Stamp> &stamps,
+                   const void *records, size_t record_count,
+                   const vector<char16_t> &pool,
+                   QFileDevice::Permissions permissions)
+{
+    vector<FileStamp> file_stamps;
+    for (size_t i = 0; i < stamps.size(); ++i)
+        file_stamps.push_back({stamp_paths[i], stamps[i].mtime, stamps[i].size});
+
+    QByteArray body;
+    body.reserve(qsizetype(file_stamps.size() * sizeof(FileStamp)
+                           + padded(record_count * record_size)
+                           + pool.size() * sizeof(char16_t)));
+    body.append((const char*)file_stamps.data(), qsizetype(file_stamps.size() * sizeof(FileStamp)));
+    body.append((const char*)records, qsizetype(record_count * record_size));
+    body.append(qsizetype(padded(body.size()) - body.size()), '\0');
+    body.append((const char*)pool.data(), qsizetype(pool.size() * sizeof(char16_t)));
+
+    Header header;
+    memcpy(header.magic, magic, sizeof(magic));
+    header.format_version = format_version;
+    header.record_version = record_version;
+    header.record_size = record_size;
+    header.stamp_count = (quint32)file_stamps.size();
+    header.record_count = record_count;
+    header.pool_size = pool.size();
+    header.checksum = fnv1a((const uchar*)body.constData(), body.size());
+
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly)
+           && file.setPermissions(permissions)  // the temporary file, replaces the target on commit
+           && file.write((const char*)&header, sizeof(header)) == sizeof(header)
+           && file.write(body) == body.size()
+           && file.commit();
+}
+
+
+Mapping::Mapping(const QString &path, quint32 record_version, quint32 record_size,
+                 const QStringList &sources) : file_(path)
+{
+    if (!file_.open(QIODevice::ReadOnly) || file_.size() < (qint64)sizeof(Header))
+        return;
+
+#ifdef Q_OS_UNIX
+    // On the descriptor that is mapped, the path may have been replaced meanwhile
+    if (struct stat st; fstat(file_.handle(), &st) != 0
+                        || (st.st_uid != 0 && st.st_uid != getuid())
+                        || (st.st_mode & (S_IWGRP | S_IWOTH)))
+        return;
+#endif
+
+    data_ = file_.map(0, file_.size());
+    if (!data_)
+        return;
+
+    const auto size = (size_t)file_.size();
+    memcpy(&header_, data_, sizeof(Header));
+    if (memcmp(header_.magic, magic, sizeof(magic)) != 0
+        || header_.format_version != format_version
+        || header_.record_version != record_version
+        || header_.record_size != record_size)
+        return;
+
+    const size_t stamps_offset = sizeof(Header);
+    records_offset_ = stamps_offset + header_.stamp_count * sizeof(FileStamp);
+    pool_offset_ = padded(records_offset_ + header_.record_count * record_size);
+    if (header_.record_count > size / record_size
+        || header_.pool_size > size / sizeof(char16_t)
+        || pool_offset_ + header_.pool_size * sizeof(char16_t) != size)
+        return;
+
+    if (fnv1a(data_ + sizeof(Header), size - sizeof(Header)) != header_.checksum)
+        return;
+
+    // Sources
+    auto *file_stamps = (const FileStamp*)(data_ + stamps_offset);
+    if (header_.stamp_count != (quint32)sources.size())
+        return;
+    for (quint32 i = 0; i < header_.stamp_count; ++i)
+    {
+        const auto &fs = file_stamps[i];
+        if (!inPool(fs.path) || !(Stamp{string(fs.path), fs.mtime, fs.size} == Stamp::of(sources[i])))
+            return;
+    }
+
+    valid_ = true;
+}
+
+QString Mapping::string(StringRef ref) const
+{
+    if (!inPool(ref))
+        return {};
+    auto *pool = (const char16_t*)(data_ + pool_offset_);
+    return QString((const QChar*)pool + ref.offset, ref.length);
+}
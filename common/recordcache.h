@@ -0,0 +1,185 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "export.h"
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <type_traits>
+#include <vector>
+
+///
+/// Versioned, checksummed, memory mapped record files for index caches.
+///
+/// A cache file holds an array of fixed size, trivially copyable records, a
+/// UTF-16 string pool referenced by the records and the stamps (path, mtime,
+/// size) of the sources the records were built from. A cache is valid only if
+/// magic, container format, record version and record size match, the checksum
+/// is correct and all source stamps are unchanged. Invalid caches are ignored,
+/// i.e. the plugin falls back to a regular index run.
+///
+/// Layout (native endianness, the cache is host local):
+///
+///     Header | Stamp[stamp_count] | Record[record_count] | char16_t[pool_size]
+///
+/// Files are written atomically using QSaveFile. Readers map the file read-only,
+/// i.e. processes mapping the same cache share its pages. On Unix a file is
+/// mapped only if it is owned by root or the current user and not writable by
+/// group or others. This is checked on the opened file, not the path.
+///
+/// The container format is implemented once in the albert-plugins-common
+/// library. Writer and Reader are typed views for the record struct of a plugin.
+///
+namespace recordcache
+{
+
+/// Reference into the string pool
+struct StringRef
+{
+    quint32 offset;
+    quint32 length;
+};
+
+/// Source state the records were built from
+struct COMMON_EXPORT Stamp
+{
+    QString path;
+    qint64 mtime;  // ms since epoch, -1 if the file does not exist
+    qint64 size;
+
+    static Stamp of(const QString &path);
+
+    static std::vector<Stamp> of(const QStringList &paths);
+
+    bool operator==(const Stamp &o) const
+    { return path == o.path && mtime == o.mtime && size == o.size; }
+};
+
+namespace detail
+{
+
+struct Header
+{
+    char magic[8];
+    quint32 format_version;
+    quint32 record_version;
+    quint32 record_size;
+    quint32 stamp_count;
+    quint64 record_count;
+    quint64 pool_size;  // char16_t
+    quint64 checksum;  // FNV-1a of everything after the header
+};
+
+/// Writes a cache file atomically. Returns false on failure.
+COMMON_EXPORT bool write(const QString &path, quint32 record_version, quint32 record_size,
+                         const std::vector<StringRef> &stamp_paths, const std::vector<Stamp> &stamps,
+                         const void *records, size_t record_count,
+                         const std::vector<char16_t> &pool,
+                         QFileDevice::Permissions permissions);
+
+/// A mapped and validated cache file
+class COMMON_EXPORT Mapping
+{
+public:
+
+    Mapping(const QString &path, quint32 record_version, quint32 record_size,
+            const QStringList &sources);
+
+    bool isValid() const { return valid_; }
+    size_t size() const { return valid_ ? header_.record_count : 0; }
+    const uchar *records() const { return data_ + records_offset_; }
+    QString string(StringRef ref) const;
+
+private:
+
+    bool inPool(StringRef ref) const
+    { return (quint64)ref.offset + ref.length <= header_.pool_size; }
+
+    QFile file_;
+    uchar *data_ = nullptr;
+    Header header_{};
+    size_t records_offset_ = 0;
+    size_t pool_offset_ = 0;
+    bool valid_ = false;
+
+};
+
+}
+
+
+template<class Record>
+class Writer
+{
+    static_assert(std::is_trivially_copyable_v<Record>);
+
+public:
+
+    explicit Writer(quint32 record_version) : record_version_(record_version) {}
+
+    /// Adds a string to the pool. Equal strings are stored once.
+    StringRef string(const QString &s)
+    {
+        if (auto it = offsets_.constFind(s); it != offsets_.constEnd())
+            return {*it, (quint32)s.size()};
+
+        StringRef ref{(quint32)pool_.size(), (quint32)s.size()};
+        pool_.insert(pool_.end(), (const char16_t*)s.utf16(), (const char16_t*)s.utf16() + s.size());
+        offsets_.insert(s, ref.offset);
+        return ref;
+    }
+
+    void add(const Record &record) { records_.emplace_back(record); }
+
+    /// Writes the cache atomically. Returns false on failure. Private to the
+    /// user by default, caches shared with other users pass read permissions.
+    bool write(const QString &path, const std::vector<Stamp> &stamps,
+               QFileDevice::Permissions permissions = QFileDevice::ReadOwner | QFileDevice::WriteOwner)
+    {
+        std::vector<StringRef> stamp_paths;
+        for (const auto &s : stamps)
+            stamp_paths.emplace_back(string(s.path));
+        return detail::write(path, record_version_, sizeof(Record), stamp_paths, stamps,
+                             records_.data(), records_.size(), pool_, permissions);
+    }
+
+private:
+
+    const quint32 record_version_;
+    std::vector<Record> records_;
+    std::vector<char16_t> pool_;
+    QHash<QString, quint32> offsets_;
+
+};
+
+
+template<class Record>
+class Reader
+{
+    static_assert(std::is_trivially_copyable_v<Record>);
+
+public:
+
+    /// Maps and validates the cache at `path` against the current stamps of
+    /// `sources`. Check isValid() before use.
+    Reader(const QString &path, quint32 record_version, const QStringList &sources):
+        mapping_(path, record_version, sizeof(Record), sources) {}
+
+    bool isValid() const { return mapping_.isValid(); }
+
+    size_t size() const { return mapping_.size(); }
+
+    /// Records are mapped, do not keep pointers beyond the lifetime of the reader
+    const Record &operator[](size_t i) const
+    { return ((const Record*)mapping_.records())[i]; }
+
+    /// Copies a string out of the pool, null if the reference is corrupt
+    QString string(StringRef ref) const { return mapping_.string(ref); }
+
+private:
+
+    detail::Mapping mapping_;
+
+};
+
+}
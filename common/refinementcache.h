@@ -0,0 +1,73 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+///
+/// Remembers the matches of the last query of a trigger query handler.
+///
+/// Typing extends the query string character by character. If the new string
+/// starts with the previous one, the matches of the new query are a subset of
+/// the previous matches and only those have to be verified again. Otherwise
+/// the handler falls back to a full scan.
+///
+/// This holds only if extending the query never adds matches. Matching by
+/// substring or word prefixes (non fuzzy `Matcher`) is fine, fuzzy matching
+/// is not, since the error tolerance grows with the query length.
+///
+/// `generation` identifies the state of the searched data. Handlers increment
+/// it whenever their data changes, which invalidates the cached matches.
+/// Candidate sets larger than `max_size` are not stored to bound memory.
+///
+/// Thread-safe.
+///
+template<class T>
+class RefinementCache
+{
+public:
+
+    explicit RefinementCache(size_t max_size = 10000) : max_size_(max_size) {}
+
+    /// The candidates for `query` or nullopt if a full scan is required.
+    std::optional<std::vector<T>> candidates(const QString &query, quint64 generation) const
+    {
+        std::lock_guard lock(mutex_);
+        if (valid_ && generation == generation_ && query.startsWith(query_))
+            return matches_;
+        return std::nullopt;
+    }
+
+    /// Stores the matches of `query`.
+    void store(const QString &query, quint64 generation, std::vector<T> matches)
+    {
+        std::lock_guard lock(mutex_);
+        valid_ = matches.size() <= max_size_;
+        query_ = query;
+        generation_ = generation;
+        if (valid_)
+            matches_ = std::move(matches);
+        else
+            matches_ = {};
+    }
+
+    void clear()
+    {
+        std::lock_guard lock(mutex_);
+        valid_ = false;
+        query_.clear();
+        matches_ = {};
+    }
+
+private:
+
+    const size_t max_size_;
+    mutable std::mutex mutex_;
+    bool valid_ = false;
+    QString query_;
+    quint64 generation_ = 0;
+    std::vector<T> matches_;
+
+};
@@ -0,0 +1,9 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "stringpool.h"
+
+stringpool::State &stringpool::state()
+{
+    static State s;
+    return s;
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "export.h"
+#include "memoryreport.h"
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <atomic>
+#include <mutex>
+
+///
+/// Process wide interning of immutable strings.
+///
+/// intern() returns an implicitly shared copy of an equal string interned
+/// before, such that repeated strings (mime types, docset entry types, bookmark
+/// folders, hostnames, keywords…) are stored once across all items and plugins.
+/// Intern only strings that are likely to repeat. Unique strings cost a pool
+/// entry without saving anything.
+///
+/// The pool holds a reference to every string. purge() drops the strings that
+/// are referenced by the pool only. The pool is sharded by hash to keep the lock
+/// contention of parallel indexers low.
+///
+/// The state is defined in the albert-plugins-common library, hence shared by
+/// all plugins of the process. Thread-safe.
+///
+namespace stringpool
+{
+
+struct Stats
+{
+    size_t strings = 0;  // unique strings in the pool
+    size_t bytes = 0;  // estimated heap of the pool strings
+    size_t hits = 0;  // intern calls that returned a pooled string
+    size_t saved_bytes = 0;  // estimated heap of the duplicates replaced by hits, cumulative
+};
+
+struct Shard
+{
+    std::mutex mutex;
+    QSet<QString> strings;
+};
+
+struct State
+{
+    std::array<Shard, 16> shards;
+    std::atomic<size_t> hits = 0;
+    std::atomic<size_t> saved_bytes = 0;
+};
+
+COMMON_EXPORT State &state();
+
+inline QString intern(const QString &s)
+{
+    if (s.isEmpty())
+        return s;
+
+    auto &st = state();
+    auto &shard = st.shards[qHash(s) % st.shards.size()];
+    std::lock_guard lock(shard.mutex);
+    if (auto it = shard.strings.constFind(s); it != shard.strings.constEnd())
+    {
+        st.hits.fetch_add(1, std::memory_order_relaxed);
+        if (it->constData() != s.constData())  // not shared yet
+            st.saved_bytes.fetch_add(memory::estimate(s), std::memory_order_relaxed);
+        return *it;
+    }
+    return *shard.strings.insert(s);
+}
+
+inline QStringList intern(QStringList l)
+{
+    for (auto &s : l)
+        s = intern(s);
+    return l;
+}
+
+/// Drops strings referenced by the pool only. Returns the number dropped.
+inline size_t purge()
+{
+    size_t count = 0;
+    for (auto &shard : state().shards)
+    {
+        std::lock_guard lock(shard.mutex);
+        for (auto it = shard.strings.begin(); it != shard.strings.end();)
+            if (it->isDetached())
+            {
+                it = shard.strings.erase(it);
+                ++count;
+            }
+            else
+                ++it;
+    }
+    return count;
+}
+
+inline Stats stats()
+{
+    Stats r;
+    auto &st = state();
+    for (auto &shard : st.shards)
+    {
+        std::lock_guard lock(shard.mutex);
+        r.strings += shard.strings.size();
+        for (const auto &s : shard.strings)
+            r.bytes += memory::estimate(s);
+    }
+    r.hits = st.hits;
+    r.saved_bytes = st.saved_bytes;
+    return r;
+}
+
+}
@@ -0,0 +1,22 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "trace.h"
+#if defined(ALBERT_PLUGINS_TRACING)
+#include <QThread>
+
+trace::State trace::state_;
+
+trace::ThreadBuffer &trace::threadBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer = []
+    {
+        static std::atomic<qint64> next_tid = 1;
+        auto b = std::make_shared<ThreadBuffer>(next_tid++, QThread::currentThread()->objectName());
+        std::lock_guard lock(state_.mutex);
+        state_.buffers.emplace_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+#endif
@@ -0,0 +1,244 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "export.h"
+#include <QByteArray>
+#include <QString>
+
+///
+/// Lightweight scoped tracing, exportable as Chrome trace-event JSON.
+///
+/// Spans are compiled in only if ALBERT_PLUGINS_TRACING is defined (CMake option
+/// ALBERT_PLUGINS_TRACING). Otherwise the macros expand to nothing. Compiled in
+/// but disabled at runtime, a span costs one relaxed atomic load and a branch.
+/// Tracing is enabled at startup if the environment variable ALBERT_TRACE is set,
+/// or at runtime using `debug trace`.
+///
+/// Every thread appends to its own chunked buffer. The global lock is taken only
+/// to add a chunk. Events of a full buffer (ThreadBuffer::max_chunks) are dropped
+/// and counted until the next clear(). Export may run concurrently.
+///
+/// The state is defined in the albert-plugins-common library, such that all
+/// plugins of the process share one tracer.
+///
+/// Load the export in chrome://tracing or https://ui.perfetto.dev.
+///
+#if defined(ALBERT_PLUGINS_TRACING)
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+
+namespace trace
+{
+
+struct Event
+{
+    char name[48];
+    const char *category;
+    qint64 begin;  // µs, steady clock
+    qint64 duration;  // µs
+};
+
+struct Chunk
+{
+    static constexpr size_t capacity = 1024;
+    Event events[capacity];
+    std::atomic<size_t> size = 0;
+};
+
+struct ThreadBuffer
+{
+    static constexpr size_t max_chunks = 64;
+
+    ThreadBuffer(qint64 tid, QString name) : tid(tid), name(std::move(name)) {}
+
+    const qint64 tid;
+    const QString name;
+    std::vector<std::shared_ptr<Chunk>> chunks;  // guarded by State::mutex
+    Chunk *current = nullptr;  // writer only
+    uint full_generation = 0;  // writer only, generation in which the buffer ran full
+    std::atomic<size_t> dropped = 0;
+};
+
+struct State
+{
+    std::atomic<bool> enabled = qEnvironmentVariableIsSet("ALBERT_TRACE");
+    std::atomic<uint> generation = 1;  // incremented by clear()
+    std::atomic<qint64> epoch = 0;  // events before are cleared
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;  // outlive their threads
+};
+
+// A variable rather than an accessor to keep disabled spans free of calls
+COMMON_EXPORT extern State state_;
+
+inline State &state() { return state_; }
+
+inline qint64 now()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/// The buffer of the calling thread, created on first use
+COMMON_EXPORT ThreadBuffer &threadBuffer();
+
+// Lock free unless a new chunk is required, i.e. once every Chunk::capacity events
+inline void append(const Event &e)
+{
+    auto &b = threadBuffer();
+    auto &s = state();
+
+    if (!b.current || b.current->size.load(std::memory_order_relaxed) == Chunk::capacity)
+    {
+        if (b.full_generation == s.generation.load(std::memory_order_relaxed))
+        {
+            b.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        std::lock_guard lock(s.mutex);
+        if (b.chunks.size() < ThreadBuffer::max_chunks)
+            b.current = b.chunks.emplace_back(std::make_shared<Chunk>()).get();
+        else
+        {
+            b.full_generation = s.generation;
+            b.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    const auto n = b.current->size.load(std::memory_order_relaxed);
+    b.current->events[n] = e;
+    b.current->size.store(n + 1, std::memory_order_release);
+}
+
+inline bool enabled() { return state().enabled.load(std::memory_order_relaxed); }
+
+inline void setEnabled(bool enabled) { state().enabled = enabled; }
+
+/// Drops all events recorded so far
+inline void clear()
+{
+    auto &s = state();
+    std::lock_guard lock(s.mutex);
+    s.epoch = now();
+    ++s.generation;
+    for (auto &b : s.buffers)  // the last chunk may be in use by the writer
+        if (b->chunks.size() > 1)
+            b->chunks.erase(b->chunks.begin(), b->chunks.end() - 1);
+}
+
+class Span
+{
+public:
+
+    Span(const char *category, const char *name) : category_(category)
+    {
+        if (enabled())
+        {
+            std::strncpy(name_, name, sizeof(name_) - 1);
+            name_[sizeof(name_) - 1] = '\0';
+            begin_ = now();
+        }
+    }
+
+    Span(const char *category, const QString &name) : category_(category)
+    {
+        if (enabled())
+        {
+            auto utf8 = name.toUtf8();
+            std::strncpy(name_, utf8.constData(), sizeof(name_) - 1);
+            name_[sizeof(name_) - 1] = '\0';
+            begin_ = now();
+        }
+    }
+
+    ~Span()
+    {
+        if (begin_ >= 0)
+        {
+            Event e;
+            std::memcpy(e.name, name_, sizeof(name_));
+            e.category = category_;
+            e.begin = begin_;
+            e.duration = now() - begin_;
+            append(e);
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span &operator=(const Span&) = delete;
+
+private:
+
+    const char *category_;
+    char name_[sizeof(Event::name)];
+    qint64 begin_ = -1;
+
+};
+
+/// Chrome trace-event JSON of all threads, complete ("X") events
+inline QByteArray toChromeJson()
+{
+    auto &s = state();
+    const auto epoch = s.epoch.load();
+    const auto pid = (qint64)getpid();
+
+    QJsonArray events;
+    std::lock_guard lock(s.mutex);
+    for (const auto &b : s.buffers)
+    {
+        events.append(QJsonObject{
+            {"ph", "M"}, {"name", "thread_name"}, {"pid", pid}, {"tid", b->tid},
+            {"args", QJsonObject{{"name", b->name.isEmpty() ? QString::number(b->tid) : b->name}}}
+        });
+
+        for (const auto &chunk : b->chunks)
+        {
+            const auto n = chunk->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; ++i)
+                if (const auto &e = chunk->events[i]; e.begin >= epoch)
+                    events.append(QJsonObject{
+                        {"ph", "X"},
+                        {"name", QString::fromUtf8(e.name)},
+                        {"cat", e.category},
+                        {"ts", e.begin},
+                        {"dur", e.duration},
+                        {"pid", pid},
+                        {"tid", b->tid}
+                    });
+        }
+
+        if (auto d = b->dropped.load(); d > 0)
+            events.append(QJsonObject{
+                {"ph", "i"}, {"s", "t"}, {"name", QStringLiteral("dropped %1 events").arg(d)},
+                {"ts", trace::now()}, {"pid", pid}, {"tid", b->tid}
+            });
+    }
+
+    return QJsonDocument(QJsonObject{{"traceEvents", events},
+                                     {"displayTimeUnit", "ms"}}).toJson(QJsonDocument::Compact);
+}
+
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/// Traces the enclosing scope. `name` is a string literal or a QString.
+#define TRACE_SCOPE(category, name) ::trace::Span TRACE_CONCAT(trace_span_, __LINE__)(category, name)
+
+#else
+
+#define TRACE_SCOPE(category, name)
+
+#endif
@@ -0,0 +1,72 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "warmup.h"
+#include <QTimer>
+#include <albert/logging.h>
+#include <algorithm>
+ALBERT_LOGGING_CATEGORY("warmup")
+using namespace std;
+using namespace warmup;
+
+State &warmup::state()
+{
+    static State s;
+    return s;
+}
+
+// Defined here, i.e. the pending timer never calls into an unloaded plugin
+static void runNext()
+{
+    auto &s = state();
+    if (s.queue.empty())
+    {
+        s.running = false;
+        for (const auto &line : text())
+            INFO << "Startup" << line;
+        return;
+    }
+
+    auto task = ::move(s.queue.front());
+    s.queue.pop_front();
+
+    if (task.context)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        task.function();
+
+        lock_guard lock(s.mutex);
+        auto &e = entry(s, task.plugin_id);
+        e.warmup_ms = max(0., e.warmup_ms) + elapsed(timer);
+        if (task.ready == Ready::AfterTask && !e.awaiting_ready)
+            e.ready_ms = elapsed(s.clock);
+    }
+
+    QTimer::singleShot(0, qApp, &runNext);
+}
+
+void warmup::schedule(QObject *context, const QString &plugin_id,
+                      function<void()> task, Ready ready)
+{
+    auto &s = state();
+    {
+        lock_guard lock(s.mutex);
+        if (ready == Ready::Reported)
+            entry(s, plugin_id).awaiting_ready = true;
+    }
+
+    s.queue.push_back({context, context, plugin_id, ::move(task), ready});
+    QObject::connect(context, &QObject::destroyed, qApp, [](QObject *o)
+    {
+        auto &q = state().queue;
+        q.erase(remove_if(q.begin(), q.end(), [o](const Task &t){ return t.owner == o; }), q.end());
+    });
+
+    if (!s.running)
+    {
+        s.running = true;
+        bool ok;
+        auto delay = qEnvironmentVariableIntValue("ALBERT_WARMUP_DELAY", &ok);
+        QTimer::singleShot(ok ? delay : 250, qApp, &runNext);
+    }
+}
@@ -0,0 +1,146 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "export.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+///
+/// Deferred plugin initialization and the startup timeline.
+///
+/// Plugin constructors are on the critical path of the launcher start. Work not
+/// needed to construct a consistent plugin (loading definitions, starting
+/// indexers, network fetches, process spawns) is scheduled as warm-up task
+/// instead. Warm-up tasks run in the main thread in schedule order, one per
+/// event loop iteration, starting ALBERT_WARMUP_DELAY ms (default 250) after the
+/// event loop started, i.e. after all plugins are loaded and the frontend is up.
+/// Tasks of destroyed contexts are dropped, i.e. the context has to be the plugin
+/// (or an object of it) to not keep tasks of unloaded plugins.
+///
+/// Plugins whose warm-up continues asynchronously (e.g. starts an indexer) pass
+/// Ready::Reported and call ready() when done, such that the timeline shows when
+/// the plugin became fully usable.
+///
+/// The timeline lists per plugin the constructor duration, the duration of its
+/// warm-up tasks and the time until it was ready, relative to the first plugin
+/// construction. It is logged once all warm-up tasks ran.
+///
+/// The state and the task queue are defined in the albert-plugins-common
+/// library, hence shared by all plugins of the process.
+///
+namespace warmup
+{
+
+enum class Ready { AfterTask, Reported };
+
+struct Entry
+{
+    QString plugin_id;
+    double construction_ms = -1;
+    double warmup_ms = -1;  // main thread, sum of the tasks
+    double ready_ms = -1;  // since the start of the timeline
+    bool awaiting_ready = false;
+};
+
+struct Task
+{
+    const QObject *owner;
+    QPointer<QObject> context;
+    QString plugin_id;
+    std::function<void()> function;
+    Ready ready;
+};
+
+struct State
+{
+    std::mutex mutex;
+    QElapsedTimer clock = []{ QElapsedTimer t; t.start(); return t; }();
+    std::vector<Entry> timeline;  // construction order
+    std::deque<Task> queue;  // main thread only
+    bool running = false;
+};
+
+COMMON_EXPORT State &state();
+
+inline double elapsed(const QElapsedTimer &t) { return t.nsecsElapsed() / 1e6; }
+
+// Expects the lock to be held
+inline Entry &entry(State &s, const QString &plugin_id)
+{
+    for (auto &e : s.timeline)
+        if (e.plugin_id == plugin_id)
+            return e;
+    return s.timeline.emplace_back(Entry{plugin_id});
+}
+
+/// Records the lifetime of the object as constructor duration of the plugin.
+/// Declare it first thing in the constructor.
+class ConstructionTimer
+{
+public:
+
+    explicit ConstructionTimer(const QString &plugin_id) : plugin_id_(plugin_id)
+    {
+        state();  // starts the clock
+        timer_.start();
+    }
+
+    ~ConstructionTimer()
+    {
+        auto &s = state();
+        std::lock_guard lock(s.mutex);
+        entry(s, plugin_id_).construction_ms = elapsed(timer_);
+    }
+
+private:
+
+    const QString plugin_id_;
+    QElapsedTimer timer_;
+
+};
+
+/// Marks a plugin scheduled with Ready::Reported ready. Thread-safe.
+inline void ready(const QString &plugin_id)
+{
+    auto &s = state();
+    std::lock_guard lock(s.mutex);
+    if (auto &e = entry(s, plugin_id); e.awaiting_ready)
+    {
+        e.awaiting_ready = false;
+        e.ready_ms = elapsed(s.clock);
+    }
+}
+
+inline std::vector<Entry> timeline()
+{
+    auto &s = state();
+    std::lock_guard lock(s.mutex);
+    return s.timeline;
+}
+
+inline QStringList text()
+{
+    QStringList lines;
+    for (const auto &e : timeline())
+        lines << QStringLiteral("%1: constructor %2 ms, warm-up %3 ms, ready %4")
+                     .arg(e.plugin_id)
+                     .arg(e.construction_ms, 0, 'f', 1)
+                     .arg(e.warmup_ms < 0 ? 0 : e.warmup_ms, 0, 'f', 1)
+                     .arg(e.ready_ms < 0 ? (e.awaiting_ready ? QStringLiteral("pending")
+                                                             : QStringLiteral("at construction"))
+                                         : QStringLiteral("after %1 ms").arg(e.ready_ms, 0, 'f', 0));
+    return lines;
+}
+
+/// Schedules `task` as warm-up of `plugin_id`. Call from the main thread.
+COMMON_EXPORT void schedule(QObject *context, const QString &plugin_id,
+                            std::function<void()> task, Ready ready = Ready::AfterTask);
+
+}
@@ -0,0 +1,446 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "bench.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSet>
+#include <albert/globalqueryhandler.h>
+#include <albert/item.h>
+#include <albert/query.h>
+#include <albert/triggerqueryhandler.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+using namespace albert;
+using namespace std;
+using namespace std::chrono;
+using Clock = steady_clock;
+
+namespace {
+
+class BenchQuery : public Query
+{
+public:
+
+    BenchQuery(const QString &trigger, const QString &string):
+        trigger_(trigger), string_(string) {}
+
+    QString synopsis() const override { return {}; }
+    QString trigger() const override { return trigger_; }
+    QString string() const override { return string_; }
+    const bool &isValid() const override { return valid_; }
+
+    void add(const shared_ptr<Item> &item) override
+    { lock_guard l(mutex_); items_.emplace_back(item); }
+
+    void add(shared_ptr<Item> &&item) override
+    { lock_guard l(mutex_); items_.emplace_back(::move(item)); }
+
+    void add(const vector<shared_ptr<Item>> &items) override
+    { lock_guard l(mutex_); items_.insert(items_.end(), items.begin(), items.end()); }
+
+    void add(vector<shared_ptr<Item>> &&items) override
+    {
+        lock_guard l(mutex_);
+        items_.insert(items_.end(), make_move_iterator(items.begin()), make_move_iterator(items.end()));
+    }
+
+    void invalidate() { valid_ = false; }
+
+    size_t count() const { lock_guard l(mutex_); return items_.size(); }
+
+private:
+
+    const QString trigger_;
+    const QString string_;
+    bool valid_ = true;  // plain bool, handlers poll a const bool&, as in the frontend
+    mutable mutex mutex_;
+    vector<shared_ptr<Item>> items_;
+
+};
+
+// Process wide, meaningful only if nothing else allocates concurrently
+static qint64 heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return (qint64)mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+    return (qint64)(unsigned)mallinfo().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// Runs the handler on the query, returns the result count
+static size_t handle(const Bench::Handler &h, BenchQuery &q, bool global)
+{
+    if (global)
+        return h.global_handler->handleGlobalQuery(&q).size();
+
+    h.trigger_handler->handleTriggerQuery(&q);
+    return q.count();
+}
+
+static size_t handle(const Bench::Handler &h, BenchQuery &q)
+{ return handle(h, q, h.global_handler != nullptr); }
+
+static double ms(Clock::duration d) { return duration<double, milli>(d).count(); }
+
+static QJsonObject percentiles(vector<double> v)
+{
+    if (v.empty())
+        return {};
+
+    sort(v.begin(), v.end());
+    auto p = [&](double q){ return v[min(v.size() - 1, size_t(q * v.size()))]; };
+    return {
+        {"count", (qint64)v.size()},
+        {"p50", p(0.50)},
+        {"p90", p(0.90)},
+        {"p99", p(0.99)},
+        {"max", v.back()}
+    };
+}
+
+struct Stats
+{
+    vector<double> latency;  // ms, completed queries
+    vector<double> cancel_latency;  // ms, invalidation to return
+    size_t results = 0;
+    qint64 result_heap = 0;  // bytes retained by results, isolated pass only
+};
+
+// Queries of one replayed keystroke
+struct ReplayStep
+{
+    struct Run
+    {
+        size_t handler;
+        bool global;
+        unique_ptr<BenchQuery> query;
+        Clock::time_point end;
+        size_t count = 0;
+        atomic<bool> done = false;
+        thread worker;
+    };
+
+    Clock::time_point start;
+    vector<unique_ptr<Run>> runs;
+};
+
+}
+
+Bench::Bench(Config config, vector<Handler> handlers):
+    config_(::move(config)), handlers_(::move(handlers)) {}
+
+QJsonObject Bench::run(const bool &abort)
+{
+    vector<Stats> isolated(handlers_.size());
+    vector<Stats> typing(handlers_.size());
+    mutex typing_mutex;
+
+    // Isolated pass
+
+    for (uint r = 0; r < config_.repeat; ++r)
+        for (size_t h = 0; h < handlers_.size(); ++h)
+            for (const auto &string : config_.queries)
+            {
+                if (abort)
+                    return {};
+
+                auto heap = heapInUse();
+                BenchQuery q(handlers_[h].id, string);
+                auto start = Clock::now();
+                auto count = handle(handlers_[h], q);
+                isolated[h].latency.emplace_back(ms(Clock::now() - start));
+                isolated[h].results += count;
+                isolated[h].result_heap = max(isolated[h].result_heap, heapInUse() - heap);
+            }
+
+    // Typing pass
+
+    auto session = [&]
+    {
+        for (uint r = 0; r < config_.repeat; ++r)
+            for (const auto &string : config_.queries)
+                for (qsizetype len = 1; len <= string.size(); ++len)
+                {
+                    if (abort)
+                        return;
+
+                    vector<unique_ptr<BenchQuery>> queries;
+                    vector<atomic<bool>> done(handlers_.size());
+                    for (auto &d : done)
+                        d = false;
+                    vector<Clock::time_point> start(handlers_.size());
+                    vector<Clock::time_point> end(handlers_.size());
+                    vector<size_t> counts(handlers_.size());
+                    vector<thread> threads;
+
+                    for (size_t h = 0; h < handlers_.size(); ++h)
+                    {
+                        auto &q = *queries.emplace_back(make_unique<BenchQuery>(handlers_[h].id, string.left(len)));
+                        threads.emplace_back([&, h]{
+                            start[h] = Clock::now();
+                            counts[h] = handle(handlers_[h], q);
+                            end[h] = Clock::now();
+                            done[h] = true;
+                        });
+                    }
+
+                    // Next keystroke
+                    this_thread::sleep_for(milliseconds(config_.interval));
+                    auto invalidation = Clock::now();
+                    vector<bool> cancelled(handlers_.size());
+                    for (size_t h = 0; h < handlers_.size(); ++h)
+                        if (!done[h])
+                        {
+                            cancelled[h] = true;
+                            queries[h]->invalidate();
+                        }
+
+                    for (size_t h = 0; h < threads.size(); ++h)
+                    {
+                        threads[h].join();
+
+                        lock_guard lock(typing_mutex);
+                        if (cancelled[h])
+                            typing[h].cancel_latency.emplace_back(ms(max(end[h] - invalidation, Clock::duration::zero())));
+                        else
+                        {
+                            typing[h].latency.emplace_back(ms(end[h] - start[h]));
+                            typing[h].results += counts[h];
+                        }
+                    }
+                }
+    };
+
+    vector<thread> sessions;
+    for (uint s = 0; s < config_.sessions; ++s)
+        sessions.emplace_back(session);
+    for (auto &s : sessions)
+        s.join();
+
+    if (abort)
+        return {};
+
+    // Report
+
+    QJsonArray handlers;
+    for (size_t h = 0; h < handlers_.size(); ++h)
+        handlers.append(QJsonObject{
+            {"id", handlers_[h].id},
+            {"type", handlers_[h].global_handler ? "global" : "trigger"},
+            {"isolated", QJsonObject{
+                 {"latency_ms", percentiles(isolated[h].latency)},
+                 {"results", (qint64)isolated[h].results},
+                 {"max_result_heap_bytes", isolated[h].result_heap}
+             }},
+            {"typing", QJsonObject{
+                 {"latency_ms", percentiles(typing[h].latency)},
+                 {"results", (qint64)typing[h].results},
+                 {"cancelled", (qint64)typing[h].cancel_latency.size()},
+                 {"cancel_latency_ms", percentiles(typing[h].cancel_latency)}
+             }}
+        });
+
+    return {
+        {"application_version", QCoreApplication::applicationVersion()},
+        {"date", QDateTime::currentDateTime().toString(Qt::ISODate)},
+        {"config", QJsonObject{
+             {"queries", QJsonArray::fromStringList(config_.queries)},
+             {"sessions", (int)config_.sessions},
+             {"interval_ms", (int)config_.interval},
+             {"repeat", (int)config_.repeat}
+         }},
+        {"handlers", handlers}
+    };
+}
+
+QJsonObject Bench::replay(const Trace &trace, const bool &abort)
+{
+    vector<Stats> stats(handlers_.size());
+    vector<double> end_to_end;  // ms, keystroke to last handler return, completed keystrokes
+    size_t cancelled_keystrokes = 0;
+
+    // Longest matching trigger wins, global handlers otherwise, as in the frontend
+    auto route = [this](ReplayStep &k, const QString &string)
+    {
+        size_t trigger_handler = handlers_.size();
+        for (size_t h = 0; h < handlers_.size(); ++h)
+            if (const auto &t = handlers_[h].trigger; !t.isEmpty() && string.startsWith(t)
+                && (trigger_handler == handlers_.size() || t.size() > handlers_[trigger_handler].trigger.size()))
+                trigger_handler = h;
+
+        if (trigger_handler < handlers_.size())
+        {
+            const auto &t = handlers_[trigger_handler].trigger;
+            auto &r = *k.runs.emplace_back(make_unique<ReplayStep::Run>());
+            r.handler = trigger_handler;
+            r.global = false;
+            r.query = make_unique<BenchQuery>(t, string.mid(t.size()));
+        }
+        else
+            for (size_t h = 0; h < handlers_.size(); ++h)
+                if (handlers_[h].global_handler)
+                {
+                    auto &r = *k.runs.emplace_back(make_unique<ReplayStep::Run>());
+                    r.handler = h;
+                    r.global = true;
+                    r.query = make_unique<BenchQuery>(QString(), string);
+                }
+    };
+
+    // Invalidates the unfinished queries of the keystroke and collects its stats
+    auto finish = [&](ReplayStep &k, bool invalidate)
+    {
+        auto invalidation = Clock::now();
+        for (auto &r : k.runs)
+            if (invalidate && !r->done)
+                r->query->invalidate();
+
+        bool cancelled = false;
+        Clock::time_point last = k.start;
+        for (auto &r : k.runs)
+        {
+            r->worker.join();
+            auto &s = stats[r->handler];
+            if (r->query->isValid())
+            {
+                s.latency.emplace_back(ms(r->end - k.start));
+                last = max(last, r->end);
+            }
+            else
+            {
+                s.cancel_latency.emplace_back(ms(max(r->end - invalidation, Clock::duration::zero())));
+                cancelled = true;
+            }
+        }
+
+        if (cancelled)
+            ++cancelled_keystrokes;
+        else
+            end_to_end.emplace_back(ms(last - k.start));
+    };
+
+    unique_ptr<ReplayStep> current;
+    const auto trace_start = Clock::now();
+    for (const auto &keystroke : trace)
+    {
+        this_thread::sleep_until(trace_start + milliseconds(keystroke.time));
+        if (current)
+            finish(*current, true);
+        if (abort)
+            return {};
+
+        current = make_unique<ReplayStep>();
+        route(*current, keystroke.string);
+        current->start = Clock::now();
+        for (auto &r : current->runs)
+            r->worker = thread([this, &run = *r]{
+                run.count = handle(handlers_[run.handler], *run.query, run.global);
+                run.end = Clock::now();
+                run.done = true;
+            });
+    }
+    if (current)
+        finish(*current, false);
+
+    // Result counts of every distinct input, sequentially, since cancellations depend on timing
+
+    QSet<QString> strings;
+    for (const auto &keystroke : trace)
+        if (!strings.contains(keystroke.string))
+        {
+            if (abort)
+                return {};
+            strings.insert(keystroke.string);
+            ReplayStep k;
+            route(k, keystroke.string);
+            for (auto &r : k.runs)
+                stats[r->handler].results += handle(handlers_[r->handler], *r->query, r->global);
+        }
+
+    // Report
+
+    QJsonArray handlers;
+    for (size_t h = 0; h < handlers_.size(); ++h)
+        if (!stats[h].latency.empty() || !stats[h].cancel_latency.empty())
+            handlers.append(QJsonObject{
+                {"id", handlers_[h].id},
+                {"latency_ms", percentiles(stats[h].latency)},
+                {"results", (qint64)stats[h].results},
+                {"cancelled", (qint64)stats[h].cancel_latency.size()},
+                {"cancel_latency_ms", percentiles(stats[h].cancel_latency)}
+            });
+
+    return {
+        {"application_version", QCoreApplication::applicationVersion()},
+        {"date", QDateTime::currentDateTime().toString(Qt::ISODate)},
+        {"trace", QJsonObject{
+             {"keystrokes", (qint64)trace.size()},
+             {"duration_ms", trace.empty() ? 0 : trace.back().time}
+         }},
+        {"end_to_end_ms", percentiles(end_to_end)},
+        {"cancelled_keystrokes", (qint64)cancelled_keystrokes},
+        {"handlers", handlers}
+    };
+}
+
+Bench::Config Bench::parseConfig(const QString &args, QStringList queries)
+{
+    Config c;
+    c.queries = ::move(queries);
+    for (const auto &arg : args.split(' ', Qt::SkipEmptyParts))
+    {
+        auto key = arg.section('=', 0, 0);
+        bool ok;
+        auto value = arg.section('=', 1).toUInt(&ok);
+        if (!ok)
+            continue;
+        else if (key == QStringLiteral("sessions"))
+            c.sessions = max(1u, value);
+        else if (key == QStringLiteral("interval"))
+            c.interval = value;
+        else if (key == QStringLiteral("repeat"))
+            c.repeat = max(1u, value);
+    }
+    return c;
+}
+
+QStringList Bench::syntheticQueries()
+{
+    return {
+        QStringLiteral("firefox"),
+        QStringLiteral("terminal"),
+        QStringLiteral("system settings"),
+        QStringLiteral("doc"),
+        QStringLiteral("music"),
+        QStringLiteral("network manager"),
+        QStringLiteral("pdf"),
+        QStringLiteral("2+3*4"),
+        QStringLiteral("example.com"),
+        QStringLiteral("~/Documents"),
+        QStringLiteral("xyzzy"),
+        QStringLiteral("a")
+    };
+}
+
+Bench::Trace Bench::parseTrace(const QByteArray &json_lines)
+{
+    Trace trace;
+    for (const auto &line : json_lines.split('\n'))
+        if (auto o = QJsonDocument::fromJson(line).object(); o.contains("t") && o.contains("q"))
+            trace.push_back({(qint64)o.value("t").toDouble(), o.value("q").toString()});
+
+    stable_sort(trace.begin(), trace.end(),
+                [](const auto &a, const auto &b){ return a.time < b.time; });
+    return trace;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <vector>
+namespace albert {
+class GlobalQueryHandler;
+class TriggerQueryHandler;
+}
+
+///
+/// Load generator and latency lab for query handlers.
+///
+/// Runs two passes over the registered handlers:
+///
+/// - *isolated*: every handler alone, every query to completion. Yields latency
+///   percentiles, result counts and the heap retained by the results.
+/// - *typing*: `sessions` concurrent users type each query keystroke by keystroke,
+///   `interval` ms apart, and all handlers run concurrently per keystroke as in the
+///   frontend. The next keystroke invalidates the running queries. Yields latency
+///   of completed queries and the cancellation latency, i.e. the time from
+///   invalidation to handler return.
+///
+/// replay() runs a recorded keystroke trace with its original timing instead.
+/// Every keystroke is routed as in the frontend: to the trigger handler whose
+/// trigger prefixes the string, otherwise to all global handlers. A keystroke
+/// invalidates the queries of the previous one. Yields per handler latency and
+/// cancellation latency and the end-to-end latency of the keystrokes, i.e. the
+/// time until the last handler returned. Result counts are collected in a second,
+/// sequential pass over the distinct inputs. They are deterministic for a fixed
+/// data set and make reports of two builds diffable for correctness.
+///
+/// Handlers must not be unloaded while a benchmark is running.
+///
+class Bench
+{
+public:
+
+    struct Config
+    {
+        QStringList queries;
+        uint sessions = 1;
+        uint interval = 50;  // ms between keystrokes
+        uint repeat = 1;
+    };
+
+    struct Handler
+    {
+        QString id;
+        QString trigger;  // used by replay()
+        albert::TriggerQueryHandler *trigger_handler;  // used if global_handler is null
+        albert::GlobalQueryHandler *global_handler;
+    };
+
+    struct Keystroke
+    {
+        qint64 time;  // ms since the start of the trace
+        QString string;  // the input line after the keystroke
+    };
+
+    using Trace = std::vector<Keystroke>;
+
+    Bench(Config config, std::vector<Handler> handlers);
+
+    /// Runs the benchmark. Returns the report, see toJson.
+    QJsonObject run(const bool &abort);
+
+    /// Replays the trace. Returns the report or an empty object if aborted.
+    QJsonObject replay(const Trace &trace, const bool &abort);
+
+    /// Parses "key=value" arguments of the bench query. Unknown keys are ignored.
+    static Config parseConfig(const QString &args, QStringList queries);
+
+    /// Synthetic queries used if no recorded queries exist
+    static QStringList syntheticQueries();
+
+    /// Parses JSON lines of the form {"t": ms, "q": "input"}. Invalid lines are skipped.
+    static Trace parseTrace(const QByteArray &json_lines);
+
+private:
+
+    const Config config_;
+    const std::vector<Handler> handlers_;
+
+};
@@ -1,6 +1,20 @@
 // Copyright (c) 2023 Manuel Schneider
 
+#include "bench.h"
+#include "memoryreport.h"
 #include "plugin.h"
+#include "stringpool.h"
+#include "trace.h"
+#include "warmup.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QTimer>
+#include <albert/extensionregistry.h>
+#include <albert/globalqueryhandler.h>
 #include <albert/logging.h>
 #include <albert/notification.h>
 #include <albert/standarditem.h>
@@ -12,8 +26,59 @@ using namespace albert;
 using namespace std;
 
 static auto icon = {QStringLiteral("qsp:SP_MessageBoxWarning")};
+static const char *CFG_MEMORY_BUDGET = "memory_budget_mb";
 
-Plugin::Plugin() { DEBG << "'Debug' created."; }
+Plugin::Plugin()
+{
+    DEBG << "'Debug' created.";
+
+    if (auto s = settings(); s->contains(CFG_MEMORY_BUDGET))
+        memory::setBudget(s->value(CFG_MEMORY_BUDGET).toUInt() * 1024ull * 1024ull);
+
+    bench_runner.parallel = [this](const bool &abort){ return bench_job(abort); };
+    bench_runner.finish = [this](QJsonObject &&report)
+    {
+        bench.reset();
+        if (bench_quit)
+            QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+        if (report.isEmpty())
+            return;
+
+        QFile file(bench_report_path);
+        if (bench_report_path.isEmpty())
+            file.setFileName(QDir(createOrThrow(cacheLocation())).filePath(
+                QStringLiteral("%1-%2.json")
+                    .arg(report.contains("trace") ? "replay" : "bench",
+                         QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"))));
+        if (file.open(QIODevice::WriteOnly))
+        {
+            file.write(QJsonDocument(report).toJson());
+            INFO << "Benchmark report written to" << file.fileName();
+            bench_notification.setText(file.fileName());
+        }
+        else
+        {
+            WARN << "Failed writing benchmark report" << file.fileName();
+            bench_notification.setText(QStringLiteral("Failed writing report."));
+        }
+
+        bench_notification.setTitle(QStringLiteral("Benchmark finished [%1 s]")
+                                        .arg(bench_runner.runtime.count() / 1000.));
+        bench_notification.send();
+    };
+
+    // Headless replay, e.g. QT_QPA_PLATFORM=offscreen ALBERT_REPLAY=trace.jsonl ALBERT_REPLAY_QUIT=1 albert
+    // The delay gives the indexers time to finish
+    if (auto trace = qEnvironmentVariable("ALBERT_REPLAY"); !trace.isEmpty())
+    {
+        bool ok;
+        auto delay = qEnvironmentVariableIntValue("ALBERT_REPLAY_DELAY", &ok);
+        QTimer::singleShot(ok ? delay : 5000, this, [this, trace]{
+            runReplay(trace, qEnvironmentVariable("ALBERT_REPLAY_REPORT"),
+                      qEnvironmentVariableIsSet("ALBERT_REPLAY_QUIT"));
+        });
+    }
+}
 
 Plugin::~Plugin() { DEBG << "'Debug' destroyed."; }
 
@@ -21,8 +86,173 @@ QString Plugin::synopsis() const { return "debug-debug-debug-debug"; }
 
 bool Plugin::allowTriggerRemap() const { return false; }
 
+vector<Bench::Handler> Plugin::benchHandlers()
+{
+    vector<Bench::Handler> handlers;
+    for (const auto &[id, handler] : registry().extensions<TriggerQueryHandler>())
+        if (handler != this)
+            handlers.push_back({id, handler->defaultTrigger(), handler,
+                                dynamic_cast<GlobalQueryHandler*>(handler)});
+    return handlers;
+}
+
+void Plugin::runBench(const QString &args)
+{
+    if (bench)  // running
+        return;
+
+    // Recorded queries, one per line, typed keystroke by keystroke
+    QStringList queries;
+    if (QFile file(QDir(configLocation()).filePath("bench_queries.txt"));
+        file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QTextStream in(&file);
+        while (!in.atEnd())
+            if (auto line = in.readLine(); !line.trimmed().isEmpty())
+                queries << line;
+    }
+    if (queries.isEmpty())
+        queries = Bench::syntheticQueries();
+
+    bench = make_unique<Bench>(Bench::parseConfig(args, queries), benchHandlers());
+    bench_job = [this](const bool &abort){ return bench->run(abort); };
+    bench_report_path.clear();
+    bench_quit = false;
+    bench_runner.run();
+}
+
+void Plugin::runReplay(const QString &trace_path, const QString &report_path, bool quit)
+{
+    if (bench)  // running
+        return;
+
+    QFile file(trace_path);
+    Bench::Trace trace;
+    if (file.open(QIODevice::ReadOnly))
+        trace = Bench::parseTrace(file.readAll());
+    if (trace.empty())
+    {
+        WARN << "No keystrokes in replay trace" << trace_path;
+        if (quit)
+            QCoreApplication::exit(1);
+        return;
+    }
+
+    INFO << "Replaying" << trace.size() << "keystrokes of" << trace_path;
+    bench = make_unique<Bench>(Bench::Config{}, benchHandlers());
+    bench_job = [this, trace](const bool &abort){ return bench->replay(trace, abort); };
+    bench_report_path = report_path;
+    bench_quit = quit;
+    bench_runner.run();
+}
+
 void Plugin::handleTriggerQuery(albert::Query *query)
 {
+    if (auto s = query->string(); s.startsWith(QStringLiteral("bench replay")))
+    {
+        auto path = s.mid(12).trimmed();
+        if (path.isEmpty())
+            path = QDir(configLocation()).filePath("replay_trace.jsonl");
+        query->add(albert::StandardItem::make(
+            {}, "bench replay", QString("Replay keystroke trace [%1]").arg(path),
+            "debug bench replay ", icon,
+            {
+                {
+                    "run", "Run",
+                    [this, path](){ runReplay(path); }
+                }
+            }
+        ));
+        return;
+    }
+
+    if (auto s = query->string(); s.startsWith(QStringLiteral("bench")))
+    {
+        auto args = s.mid(5).trimmed();
+        query->add(albert::StandardItem::make(
+            {}, "bench", QString("Run handler benchmark [%1]")
+                             .arg(args.isEmpty() ? "sessions=1 interval=50 repeat=1" : args),
+            "debug bench", icon,
+            {
+                {
+                    "run", "Run",
+                    [this, args](){ runBench(args); }
+                }
+            }
+        ));
+        return;
+    }
+
+    if (auto s = query->string(); s.startsWith(QStringLiteral("memory")))
+    {
+        auto args = s.mid(6).trimmed();
+        if (args.startsWith(QStringLiteral("budget")))
+        {
+            bool ok;
+            auto mb = args.mid(6).trimmed().toUInt(&ok);
+            if (ok)
+                query->add(albert::StandardItem::make(
+                    {}, "memory budget",
+                    mb ? QString("Set the soft index memory budget to %1 MB").arg(mb)
+                       : QString("Disable the soft index memory budget"),
+                    "debug memory budget ", icon,
+                    {
+                        {
+                            "set", "Set",
+                            [this, mb](){
+                                settings()->setValue(CFG_MEMORY_BUDGET, mb);
+                                memory::setBudget(mb * 1024ull * 1024ull);
+                            }
+                        }
+                    }
+                ));
+            return;
+        }
+
+        size_t total = 0;
+        for (const auto &[plugin_id, report] : memory::reports())
+        {
+            total += report.bytes;
+            query->add(albert::StandardItem::make(
+                {}, plugin_id,
+                QString("%1 items, ~%2").arg(report.items).arg(memory::formatBytes(report.bytes)),
+                "debug memory", icon, {}));
+        }
+
+        auto pool = stringpool::stats();
+        query->add(albert::StandardItem::make(
+            {}, "string pool",
+            QString("%1 strings, ~%2. %3 hits replaced ~%4 of duplicates.")
+                .arg(pool.strings).arg(memory::formatBytes(pool.bytes))
+                .arg(pool.hits).arg(memory::formatBytes(pool.saved_bytes)),
+            "debug memory", icon,
+            {
+                {
+                    "purge", "Purge unreferenced strings",
+                    [](){ INFO << "Purged" << stringpool::purge() << "strings from the pool"; }
+                }
+            }
+        ));
+
+        auto budget = memory::budget();
+        query->add(albert::StandardItem::make(
+            {}, QString("Total ~%1").arg(memory::formatBytes(total)),
+            budget ? QString("Soft budget per plugin: %1. Use 'memory budget <MB>' to change.")
+                         .arg(memory::formatBytes(budget))
+                   : QString("No soft budget. Use 'memory budget <MB>' to set one."),
+            "debug memory budget ", icon, {}));
+        return;
+    }
+
+    if (auto s = query->string(); s.size() > 1 && QStringLiteral("startup").startsWith(s))
+    {
+        for (const auto &line : warmup::text())
+            query->add(albert::StandardItem::make(
+                {}, line.section(QStringLiteral(": "), 0, 0), line.section(QStringLiteral(": "), 1),
+                "debug startup", icon, {}));
+        return;
+    }
+
     if (query->string() == QStringLiteral("busy"))
     {
         for(int i = 0; query->isValid() && i < 3; ++i)
@@ -62,6 +292,59 @@ void Plugin::handleTriggerQuery(albert::Query *query)
         ));
     }
 
+    if (QStringLiteral("trace").startsWith(query->string()))
+    {
+#if defined(ALBERT_PLUGINS_TRACING)
+        query->add(albert::StandardItem::make(
+            {}, "trace", QString("Tracing is %1").arg(trace::enabled() ? "enabled" : "disabled"),
+            "debug trace", icon,
+            {
+                {
+                    "toggle", trace::enabled() ? "Disable" : "Enable",
+                    [](){ trace::setEnabled(!trace::enabled()); }
+                },
+                {
+                    "save", "Save as Chrome trace JSON",
+                    [this](){
+                        auto file_name = QStringLiteral("trace-%1.json")
+                                             .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+                        QFile file(QDir(createOrThrow(cacheLocation())).filePath(file_name));
+                        if (file.open(QIODevice::WriteOnly))
+                        {
+                            file.write(trace::toChromeJson());
+                            INFO << "Trace written to" << file.fileName();
+                        }
+                        else
+                            WARN << "Failed writing trace" << file.fileName();
+                    }
+                },
+                {
+                    "clear", "Clear",
+                    [](){ trace::clear(); }
+                }
+            }
+        ));
+#else
+        query->add(albert::StandardItem::make(
+            {}, "trace", "Tracing is not compiled in. Configure with -DALBERT_PLUGINS_TRACING=ON.",
+            "debug trace", icon, {}));
+#endif
+    }
+
+    if (QStringLiteral("memory").startsWith(query->string()))
+    {
+        query->add(albert::StandardItem::make(
+                   {}, "memory", "Estimated index memory of the plugins",
+                   "debug memory", icon, {}));
+    }
+
+    if (QStringLiteral("bench").startsWith(query->string()))
+    {
+        query->add(albert::StandardItem::make(
+                   {}, "bench", "Benchmark query handlers. Args: sessions=N interval=ms repeat=N",
+                   "debug bench ", icon, {}));
+    }
+
     if (QStringLiteral("busy").startsWith(query->string()))
     {
         query->add(albert::StandardItem::make(
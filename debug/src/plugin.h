@@ -1,7 +1,13 @@
 // Copyright (c) 2022 Manuel Schneider
 #pragma once
+#include "bench.h"
+#include <QJsonObject>
+#include <albert/backgroundexecutor.h>
 #include <albert/extensionplugin.h>
+#include <albert/notification.h>
 #include <albert/triggerqueryhandler.h>
+#include <functional>
+#include <memory>
 
 class Plugin : public albert::ExtensionPlugin,
                public albert::TriggerQueryHandler
@@ -14,4 +20,16 @@ public:
     bool allowTriggerRemap() const override;
     QString synopsis() const override;
     void handleTriggerQuery(albert::Query*) override;
+
+private:
+    std::vector<Bench::Handler> benchHandlers();  // all but this, default triggers
+    void runBench(const QString &args);
+    void runReplay(const QString &trace_path, const QString &report_path = {}, bool quit = false);
+
+    std::unique_ptr<Bench> bench;
+    std::function<QJsonObject(const bool &abort)> bench_job;
+    QString bench_report_path;  // default cacheLocation()/<kind>-<date>.json if empty
+    bool bench_quit = false;  // headless replay
+    albert::BackgroundExecutor<QJsonObject> bench_runner;
+    albert::Notification bench_notification;
 };
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 Manuel Schneider
+
+"""
+Compares two replay reports of the debug plugin.
+
+Prints the end-to-end and per handler latency percentiles of both reports and
+their relative change. Differing result counts are flagged, since on a fixed
+data set they indicate a behavior change rather than noise.
+
+Exits with status 1 if a result count differs or a p90 latency regressed by
+more than the threshold (default 20 %).
+
+Usage: compare_replay.py <baseline report> <report> [threshold percent]
+"""
+
+import json
+import sys
+
+PERCENTILES = ['p50', 'p90', 'p99']
+
+
+def change(a, b):
+    return '%+7.1f %%' % (100 * (b - a) / a) if a else '      - '
+
+
+def row(label, a, b):
+    cells = []
+    for p in PERCENTILES:
+        x, y = a.get(p, 0), b.get(p, 0)
+        cells.append('%8.2f %8.2f %s' % (x, y, change(x, y)))
+    return '%-32s %s' % (label, '   '.join(cells))
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+
+    with open(sys.argv[1]) as f:
+        base = json.load(f)
+    with open(sys.argv[2]) as f:
+        new = json.load(f)
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 20.0
+
+    failed = False
+
+    if base.get('trace') != new.get('trace'):
+        print('warning: the reports were recorded with different traces')
+
+    print('%-32s %s' % ('latency ms', '   '.join('%-26s' % (p + ' base/new/change') for p in PERCENTILES)))
+    print(row('end to end', base.get('end_to_end_ms', {}), new.get('end_to_end_ms', {})))
+    print('%-32s %d -> %d' % ('cancelled keystrokes', base.get('cancelled_keystrokes', 0),
+                              new.get('cancelled_keystrokes', 0)))
+
+    base_handlers = {h['id']: h for h in base.get('handlers', [])}
+    new_handlers = {h['id']: h for h in new.get('handlers', [])}
+    for id in sorted(base_handlers.keys() | new_handlers.keys()):
+        a, b = base_handlers.get(id), new_handlers.get(id)
+        if not a or not b:
+            print('%-32s only in %s' % (id, 'baseline' if a else 'report'))
+            continue
+
+        print(row(id, a['latency_ms'], b['latency_ms']))
+
+        if a['results'] != b['results']:
+            print('%-32s results differ: %d -> %d' % ('', a['results'], b['results']))
+            failed = True
+
+        x, y = a['latency_ms'].get('p90', 0), b['latency_ms'].get('p90', 0)
+        if x and 100 * (y - x) / x > threshold:
+            print('%-32s p90 regressed by more than %g %%' % ('', threshold))
+            failed = True
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 Manuel Schneider
+
+"""
+Generates a fixed data set and a keystroke trace for headless query replays.
+
+The data set is deterministic for a given seed: a home tree for the files
+plugin, desktop entries for the applications plugin, a Chromium bookmarks file,
+a docset with its cached docset list for the docs plugin and a clipboard
+history. The plugin data is placed in albert's <XDG dir>/albert/<plugin id>
+layout. The albert config enables the plugins and configures them to load the
+data, i.e. the home tree as index path of the files plugin and a persistent
+clipboard history.
+
+The trace is a JSON lines file {"t": ms, "q": "input line"} of users typing
+queries keystroke by keystroke, including backspaces and pauses.
+
+Usage: make_replay_fixture.py <output dir> [seed]
+
+Prints the environment to run albert on the fixture, e.g.
+
+    eval $(make_replay_fixture.py /tmp/fixture)
+    QT_QPA_PLATFORM=offscreen ALBERT_REPLAY_QUIT=1 albert
+
+Run the replay twice against two builds and compare the reports with
+compare_replay.py.
+"""
+
+import json
+import os
+import random
+import sys
+
+WORDS = ['alpha', 'beta', 'gamma', 'delta', 'report', 'invoice', 'photo', 'music',
+         'project', 'notes', 'draft', 'final', 'backup', 'config', 'server', 'client',
+         'kernel', 'network', 'manager', 'terminal', 'editor', 'browser', 'player',
+         'settings', 'system', 'document', 'archive', 'summer', 'winter', 'budget']
+EXTENSIONS = ['txt', 'pdf', 'png', 'jpg', 'md', 'cpp', 'h', 'py', 'odt', 'mp3']
+TYPES = ['Class', 'Function', 'Method', 'Type', 'Variable', 'Guide', 'Module']
+
+QUERIES = ['firefox', 'terminal', 'system settings', 'report final', 'music player',
+           'network manager', 'photo', 'budget 2', 'kernel', 'xyzzy', 'edit', 'a']
+
+
+def name(rnd, words=2):
+    return ' '.join(rnd.choice(WORDS) for _ in range(words))
+
+
+def write(path, data):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write(data)
+
+
+def make_home(rnd, home, files=5000):
+    dirs = [home]
+    for _ in range(files // 20):
+        dirs.append(os.path.join(rnd.choice(dirs), rnd.choice(WORDS).capitalize()))
+    for i in range(files):
+        file_name = '%s %d.%s' % (name(rnd).replace(' ', '_'), i, rnd.choice(EXTENSIONS))
+        write(os.path.join(rnd.choice(dirs), file_name), '%d\n' % i)
+
+
+def make_applications(rnd, data_home, count=300):
+    for i in range(count):
+        app = name(rnd, rnd.randint(1, 3)).title()
+        write(os.path.join(data_home, 'applications', 'fixture-%d.desktop' % i),
+              '[Desktop Entry]\nType=Application\nName=%s\nGenericName=%s\n'
+              'Comment=%s\nExec=true\nKeywords=%s;\n'
+              % (app, name(rnd).title(), name(rnd, 5), ';'.join(rnd.sample(WORDS, 3))))
+    for app in ['Firefox', 'Terminal', 'System Settings']:
+        write(os.path.join(data_home, 'applications', '%s.desktop' % app.lower().replace(' ', '-')),
+              '[Desktop Entry]\nType=Application\nName=%s\nExec=true\n' % app)
+
+
+def make_bookmarks(rnd, config_home, count=2000):
+    def node(depth):
+        children = []
+        for i in range(rnd.randint(5, 40)):
+            if depth < 3 and rnd.random() < 0.1:
+                children.append(dict(type='folder', name=name(rnd, 1).title(), children=node(depth + 1)))
+            else:
+                children.append(dict(type='url', name=name(rnd, 3).title(),
+                                     url='https://%s.example.com/%s' % (rnd.choice(WORDS), rnd.choice(WORDS))))
+        return children
+
+    roots = dict(bookmark_bar=dict(type='folder', name='Bookmarks bar', children=[]))
+    while sum(1 for _ in iterate(roots['bookmark_bar'])) < count:
+        roots['bookmark_bar']['children'].extend(node(0))
+    write(os.path.join(config_home, 'chromium', 'Default', 'Bookmarks'),
+          json.dumps(dict(roots=roots, version=1), indent=1))
+
+
+def iterate(folder):
+    for child in folder['children']:
+        if child['type'] == 'folder':
+            yield from iterate(child)
+        else:
+            yield child
+
+
+def make_docset(rnd, cache_home, data_home, count=5000):
+    write(os.path.join(cache_home, 'albert', 'docs', 'zeal_docset_list.json'),
+          json.dumps([dict(name='Fixture', title='Fixture', sourceId='com.kapeli', icon2x='')]))
+    tokens = ['<?xml version="1.0" encoding="UTF-8"?>', '<Tokens version="1.0">']
+    for i in range(count):
+        symbol = '%s%d' % (name(rnd).title().replace(' ', ''), i)
+        tokens.append('<Token><TokenIdentifier><Name>%s</Name><Type>%s</Type></TokenIdentifier>'
+                      '<Path>%s.html</Path><Anchor>%s</Anchor></Token>'
+                      % (symbol, rnd.choice(TYPES), rnd.choice(WORDS), symbol))
+    tokens.append('</Tokens>')
+    write(os.path.join(data_home, 'albert', 'docs', 'docsets', 'Fixture.docset',
+                       'Contents', 'Resources', 'Tokens.xml'), '\n'.join(tokens))
+
+
+def make_clipboard(rnd, data_home, count=200):
+    history = [dict(text=name(rnd, rnd.randint(1, 12)), datetime=1700000000 + 60 * i) for i in range(count)]
+    write(os.path.join(data_home, 'albert', 'clipboard', 'clipboard_history'), json.dumps(history))
+
+
+PLUGINS = ['applications', 'chromium', 'clipboard', 'debug', 'docs', 'files']
+
+
+def ini_key(key):
+    """A key as QSettings writes it to ini files, groups separated by backslashes"""
+    result = ''
+    for c in key:
+        if c == '/':
+            result += '\\'
+        elif c.isascii() and (c.isalnum() or c in '_-.'):
+            result += c
+        elif ord(c) <= 0xff:
+            result += '%%%02X' % ord(c)
+        else:
+            result += '%%U%04X' % ord(c)
+    return result
+
+
+def make_config(config_home, home):
+    sections = {plugin: {'enabled': 'true'} for plugin in PLUGINS}
+    sections['clipboard']['persistent'] = 'true'
+    sections['files']['paths'] = '"%s"' % home
+    sections['files'][ini_key(home.strip('/') + '/mimeFilters')] = '*'
+    write(os.path.join(config_home, 'albert', 'config'),
+          ''.join('[%s]\n%s\n' % (section, ''.join('%s=%s\n' % kv for kv in keys.items()))
+                  for section, keys in sorted(sections.items())))
+
+
+def make_trace(rnd, path, sessions=3):
+    t = 0
+    lines = []
+    for _ in range(sessions):
+        for query in QUERIES:
+            typed = ''
+            for c in query:
+                typed += c
+                t += rnd.randint(40, 180)
+                lines.append(dict(t=t, q=typed))
+                if len(typed) > 2 and rnd.random() < 0.05:  # typo, corrected
+                    t += rnd.randint(80, 200)
+                    lines.append(dict(t=t, q=typed[:-1]))
+                    t += rnd.randint(80, 200)
+                    lines.append(dict(t=t, q=typed))
+            t += rnd.randint(800, 2000)  # reading the results
+            for n in range(len(typed) - 1, 0, -1):  # clear
+                t += 30
+                lines.append(dict(t=t, q=typed[:n]))
+    write(path, ''.join(json.dumps(line) + '\n' for line in lines))
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+
+    out = os.path.abspath(sys.argv[1])
+    rnd = random.Random(int(sys.argv[2]) if len(sys.argv) > 2 else 0)
+
+    home = os.path.join(out, 'home')
+    config_home = os.path.join(home, '.config')
+    data_home = os.path.join(home, '.local', 'share')
+    cache_home = os.path.join(home, '.cache')
+
+    make_home(rnd, home)
+    make_applications(rnd, data_home)
+    make_bookmarks(rnd, config_home)
+    make_docset(rnd, cache_home, data_home)
+    make_clipboard(rnd, data_home)
+    make_config(config_home, home)
+    make_trace(rnd, os.path.join(out, 'trace.jsonl'))
+
+    print('export HOME=%s' % home)
+    print('export XDG_CONFIG_HOME=%s  # albert/config enables and configures the plugins' % config_home)
+    print('export XDG_DATA_HOME=%s' % data_home)
+    print('export XDG_CACHE_HOME=%s' % cache_home)
+    print('export XDG_DATA_DIRS=%s' % data_home)
+    print('export ALBERT_REPLAY=%s' % os.path.join(out, 'trace.jsonl'))
+    print('export ALBERT_REPLAY_REPORT=%s' % os.path.join(out, 'report.json'))
+
+
+if __name__ == '__main__':
+    main()
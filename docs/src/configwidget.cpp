@@ -1,6 +1,7 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #include "configwidget.h"
+#include "memoryreport.h"
 #include "plugin.h"
 #include <QAbstractListModel>
 #include <QMessageBox>
@@ -13,6 +14,8 @@ ConfigWidget::ConfigWidget()
 
     ui.list_view->setModel(&model);
 
+    layout()->addWidget(memory::createWidget(Plugin::instance()->id(), this));
+
     connect(ui.update_button, &QPushButton::pressed,
             Plugin::instance(), &Plugin::updateDocsetList);
 
@@ -3,6 +3,7 @@
 #include "docitem.h"
 #include "docset.h"
 #include "plugin.h"
+#include "stringpool.h"
 #include <QRegularExpression>
 #include <QSqlDatabase>
 #include <QSqlDriver>
@@ -31,7 +32,7 @@ void Docset::createIndexItems(vector<IndexItem> &results) const
         void add(const QString &t, const QString &n, QString p, const QString &a)
         {
             auto item = make_shared<DocItem>(docset,
-                                             shared(t),
+                                             stringpool::intern(t),  // shared across docsets
                                              shared(n),
                                              shared(QString(p).remove(dashEntryRegExp)),
                                              shared(a.section("/", -1)));
@@ -1,7 +1,11 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #include "configwidget.h"
+#include "docitem.h"
+#include "memoryreport.h"
 #include "plugin.h"
+#include "trace.h"
+#include "warmup.h"
 #include <QDirIterator>
 #include <QImageWriter>
 #include <QJsonArray>
@@ -87,6 +91,7 @@ static void saveBase64ImageToFile(const QByteArray& base64Data, const QString& f
 
 Plugin::Plugin()
 {
+    warmup::ConstructionTimer construction(id());
     instance_ = this;
 
     if(!QSqlDatabase::isDriverAvailable("QSQLITE"))
@@ -102,7 +107,7 @@ Plugin::Plugin()
 
     connect(this, &Plugin::docsetsChanged, this, &Plugin::updateIndexItems);
 
-    updateDocsetList();
+    warmup::schedule(this, id(), [this]{ updateDocsetList(); }, warmup::Ready::Reported);
 }
 
 Plugin::~Plugin()
@@ -121,9 +126,19 @@ void Plugin::updateIndexItems()
         if (!docset.path.isNull())
             docset.createIndexItems(items);
 
+    // Item strings are shared per docset, the index strings are the item names
+    memory::publish(id(), items.size(),
+                    items.size() * sizeof(DocItem) + memory::estimateIndexItems(items));
+
     setIndexItems(::move(items));
 }
 
+vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
+{
+    TRACE_SCOPE("query", "docs");
+    return IndexQueryHandler::handleGlobalQuery(query);
+}
+
 QWidget *Plugin::buildConfigWidget() { return new ConfigWidget; }
 
 const vector<Docset> &Plugin::docsets() const { return docsets_; }
@@ -143,6 +158,7 @@ void Plugin::updateDocsetList()
     connect(reply, &QNetworkReply::finished, this, [this, reply]
     {
         reply->deleteLater();
+        warmup::ready(id());
 
         QByteArray replyData;
         QFile cachedDocsetListFile(QDir(cacheLocation()).filePath("zeal_docset_list.json"));
@@ -174,8 +190,8 @@ void Plugin::updateDocsetList()
                 auto title = obj[QStringLiteral("title")].toString();
                 auto source = obj[QStringLiteral("sourceId")].toString();
                 auto icon_path = QDir(cacheLocation()).filePath(QString("icons/%1.png").arg(name));
-                auto rawBase64 = obj[QStringLiteral("icon2x")].toString().toLocal8Bit();
-                saveBase64ImageToFile(rawBase64, icon_path);
+                if (!QFile::exists(icon_path))  // decoded on every list update otherwise
+                    saveBase64ImageToFile(obj[QStringLiteral("icon2x")].toString().toLocal8Bit(), icon_path);
 
                 docsets_.emplace_back(name, title, source, icon_path);
 
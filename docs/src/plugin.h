@@ -18,6 +18,7 @@ public:
     ~Plugin();
 
     void updateIndexItems() override;
+    std::vector<albert::RankItem> handleGlobalQuery(const albert::Query*) override;
     QWidget* buildConfigWidget() override;
 
     void updateDocsetList();
@@ -0,0 +1,316 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "fileitems.h"
+#include "indexerprotocol.h"
+#include "indexerservice.h"
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <albert/logging.h>
+#include <algorithm>
+using namespace indexer_protocol;
+using namespace std;
+
+static const char *CONFIG_FILE_NAME = "config.json";
+static const char *INDEX_FILE_NAME = "file_index.json";
+static const int probe_timeout = 200;  // ms, the service is local
+
+IndexerService::IndexerService(const QString &socket_path, const QString &cache_dir):
+    socket_path_(socket_path),
+    cache_dir_(cache_dir),
+    snapshot_(make_shared<Snapshot>())
+{
+    QDir().mkpath(cache_dir_);
+
+    connect(&fs_index_, &FsIndex::status, this, [](const QString &s){ DEBG << s; });
+    connect(&fs_index_, &FsIndex::updatedFinished, this, [this]{
+        updateSnapshot();
+        storeIndex();
+    });
+
+    server_.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&server_, &QLocalServer::newConnection, this, &IndexerService::onNewConnection);
+
+    load();
+}
+
+IndexerService::~IndexerService()
+{
+    server_.close();
+    for (auto &[socket, connection] : connections_)
+        for (auto &[id, abort] : connection.queries)
+            *abort = true;
+    QThreadPool::globalInstance()->waitForDone();
+
+    fs_index_.disconnect();
+    storeIndex();
+}
+
+bool IndexerService::listen()
+{
+    // Remove the socket of a crashed instance only, never the one of a running instance
+    QLocalSocket probe;
+    probe.connectToServer(socket_path_);
+    if (probe.waitForConnected(probe_timeout))
+    {
+        CRIT << "Another instance is listening on" << socket_path_;
+        return false;
+    }
+    QLocalServer::removeServer(socket_path_);
+    if (!server_.listen(socket_path_))
+    {
+        CRIT << "Failed to listen on" << socket_path_ << server_.errorString();
+        return false;
+    }
+    INFO << "Listening on" << socket_path_;
+    return true;
+}
+
+void IndexerService::onNewConnection()
+{
+    while (auto *socket = server_.nextPendingConnection())
+    {
+        connections_.emplace(socket, Connection{});
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]{ onReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]{ onDisconnected(socket); });
+    }
+}
+
+void IndexerService::onReadyRead(QLocalSocket *socket)
+{
+    auto &buffer = connections_[socket].buffer;
+    buffer.append(socket->readAll());
+
+    QByteArray payload;
+    while (takeFrame(buffer, payload))
+        handle(socket, payload);
+}
+
+void IndexerService::onDisconnected(QLocalSocket *socket)
+{
+    if (auto it = connections_.find(socket); it != connections_.end())
+    {
+        for (auto &[id, abort] : it->second.queries)
+            *abort = true;
+        connections_.erase(it);
+    }
+    socket->deleteLater();
+}
+
+void IndexerService::handle(QLocalSocket *socket, const QByteArray &payload)
+{
+    QDataStream s(payload);
+    s.setVersion(stream_version);
+    quint8 type;
+    quint32 id;
+    s >> type >> id;
+
+    switch ((Message)type)
+    {
+    case Message::Configure:
+    {
+        QByteArray json;
+        s >> json;
+        configure(QJsonDocument::fromJson(json).object());
+        sendStatus(socket, id, QStringLiteral("Indexing %1 paths").arg(fs_index_.indexPaths().size()));
+        break;
+    }
+    case Message::Query:
+    {
+        QString string;
+        bool match_paths;
+        quint32 max_results;
+        s >> string >> match_paths >> max_results;
+        if (s.status() == QDataStream::Ok)
+            query(socket, id, string, match_paths, max_results);
+        break;
+    }
+    case Message::Cancel:
+    {
+        auto &queries = connections_[socket].queries;
+        if (auto it = queries.find(id); it != queries.end())
+        {
+            *it->second = true;
+            queries.erase(it);
+        }
+        break;
+    }
+    case Message::Rescan:
+        fs_index_.update();
+        sendStatus(socket, id, QStringLiteral("Rescanning %1 paths").arg(fs_index_.indexPaths().size()));
+        break;
+    default:
+        WARN << "Invalid message type" << type;
+        socket->disconnectFromServer();
+    }
+}
+
+void IndexerService::configure(const QJsonObject &config)
+{
+    vector<QString> removed;
+    for (const auto &[path, fsp] : fs_index_.indexPaths())
+        if (!config.contains(path))
+            removed.emplace_back(path);
+    for (const auto &path : removed)
+    {
+        INFO << "Removing index path" << path;
+        fs_index_.removePath(path);
+    }
+
+    for (auto it = config.begin(); it != config.end(); ++it)
+    {
+        if (auto pit = fs_index_.indexPaths().find(it.key()); pit != fs_index_.indexPaths().end())
+            pit->second->setSettings(it.value().toObject());  // updates itself if required
+        else
+        {
+            INFO << "Adding index path" << it.key();
+            auto fsp = make_unique<FsIndexPath>(it.key());
+            fsp->setSettings(it.value().toObject());
+            fs_index_.addPath(::move(fsp));
+        }
+    }
+
+    if (!removed.empty())
+        updateSnapshot();
+
+    storeConfig();
+}
+
+void IndexerService::query(QLocalSocket *socket, quint32 id, const QString &string,
+                           bool match_paths, quint32 max_results)
+{
+    auto abort = make_shared<atomic<bool>>(false);
+    connections_[socket].queries[id] = abort;
+
+    auto run = [this, socket = QPointer<QLocalSocket>(socket), id, string,
+                match_paths, max_results, abort, snapshot = snapshot_]
+    {
+        batchmatch::BatchMatcher matcher(string);
+        vector<pair<float, quint32>> matches;  // score, item index
+        auto collect = [&](size_t i, float score)
+        {
+            matches.emplace_back(score, (quint32)i);
+            return !*abort;
+        };
+        matcher.matchAll(snapshot->names, collect);
+        if (match_paths)
+            matcher.matchAll(snapshot->paths, collect);
+        if (*abort)
+            return;
+
+        // Deduplicate name and path matches, keep the best score
+        sort(matches.begin(), matches.end(),
+             [](const auto &a, const auto &b){ return a.second < b.second || (a.second == b.second && a.first > b.first); });
+        matches.erase(unique(matches.begin(), matches.end(),
+                             [](const auto &a, const auto &b){ return a.second == b.second; }),
+                      matches.end());
+
+        const auto count = min<size_t>(max_results, matches.size());
+        partial_sort(matches.begin(), matches.begin() + count, matches.end(),
+                     [](const auto &a, const auto &b){ return a.first > b.first; });
+
+        QByteArray payload;
+        QDataStream s(&payload, QIODevice::WriteOnly);
+        s.setVersion(stream_version);
+        s << (quint8)Message::Results << id << (quint32)count;
+        for (size_t i = 0; i < count && !*abort; ++i)
+        {
+            const auto &item = snapshot->items[matches[i].second];
+            s << item->filePath() << item->mimeType().name() << matches[i].first;
+        }
+
+        QMetaObject::invokeMethod(this, [this, socket, id, abort, payload]
+        {
+            if (!socket || *abort)
+                return;
+            writeFrame(*socket, payload);
+            if (auto it = connections_.find(socket); it != connections_.end())
+                it->second.queries.erase(id);
+        }, Qt::QueuedConnection);
+    };
+
+    QThreadPool::globalInstance()->start(run);
+}
+
+void IndexerService::sendStatus(QLocalSocket *socket, quint32 id, const QString &text)
+{
+    QByteArray payload;
+    QDataStream s(&payload, QIODevice::WriteOnly);
+    s.setVersion(stream_version);
+    s << (quint8)Message::Status << id << text;
+    writeFrame(*socket, payload);
+}
+
+void IndexerService::updateSnapshot()
+{
+    auto snapshot = make_shared<Snapshot>();
+    for (const auto &[path, fsp] : fs_index_.indexPaths())
+        fsp->items(snapshot->items);
+
+    snapshot->names.reserve(snapshot->items.size(), snapshot->items.size() * 24);
+    snapshot->paths.reserve(snapshot->items.size(), snapshot->items.size() * 64);
+    for (const auto &item : snapshot->items)
+    {
+        snapshot->names.add(item->name());
+        snapshot->paths.add(item->filePath());
+    }
+
+    INFO << "Serving" << snapshot->items.size() << "files";
+    snapshot_ = ::move(snapshot);  // running queries keep the previous one alive
+}
+
+void IndexerService::load()
+{
+    QJsonObject config, index;
+    if (QFile file(QDir(cache_dir_).filePath(CONFIG_FILE_NAME)); file.open(QIODevice::ReadOnly))
+        config = QJsonDocument::fromJson(file.readAll()).object();
+    if (QFile file(QDir(cache_dir_).filePath(INDEX_FILE_NAME)); file.open(QIODevice::ReadOnly))
+        index = QJsonDocument::fromJson(file.readAll()).object();
+
+    // Restore the index, then apply the settings like the plugin does
+    for (auto it = config.begin(); it != config.end(); ++it)
+    {
+        auto fsp = make_unique<FsIndexPath>(it.key());
+        if (auto iit = index.find(it.key()); iit != index.end())
+            fsp->deserialize(iit.value().toObject());
+        fsp->setSettings(it.value().toObject());
+        fs_index_.addPath(::move(fsp));
+    }
+
+    updateSnapshot();  // serve the persisted index while scanning
+}
+
+void IndexerService::storeConfig() const
+{
+    QJsonObject config;
+    for (const auto &[path, fsp] : fs_index_.indexPaths())
+        config.insert(path, fsp->settings());
+
+    if (QSaveFile file(QDir(cache_dir_).filePath(CONFIG_FILE_NAME)); file.open(QIODevice::WriteOnly))
+    {
+        file.write(QJsonDocument(config).toJson());
+        file.commit();
+    }
+    else
+        WARN << "Couldn't write to file:" << file.fileName();
+}
+
+void IndexerService::storeIndex() const
+{
+    QJsonObject index;
+    for (const auto &[path, fsp] : fs_index_.indexPaths())
+        index.insert(path, fsp->serialize());
+
+    if (QSaveFile file(QDir(cache_dir_).filePath(INDEX_FILE_NAME)); file.open(QIODevice::WriteOnly))
+    {
+        DEBG << "Storing file index to" << file.fileName();
+        file.write(QJsonDocument(index).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+    else
+        WARN << "Couldn't write to file:" << file.fileName();
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "batchmatcher.h"
+#include "fsindex.h"
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QString>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+class FileItem;
+class QLocalSocket;
+
+///
+/// The albert-files-indexer service.
+///
+/// Owns the file index, keeps it up to date and answers queries of the files
+/// plugin over a local socket, see indexerprotocol.h. Queries run on the
+/// global thread pool against an immutable snapshot of the index, which is
+/// replaced after every index update. Configuration and index are persisted in
+/// the cache dir and loaded at start, i.e. the index survives launcher restarts
+/// as well as service restarts.
+///
+class IndexerService : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    IndexerService(const QString &socket_path, const QString &cache_dir);
+    ~IndexerService();
+
+    bool listen();
+
+private:
+
+    struct Snapshot
+    {
+        std::vector<std::shared_ptr<FileItem>> items;
+        batchmatch::Candidates names;
+        batchmatch::Candidates paths;
+    };
+
+    struct Connection
+    {
+        QByteArray buffer;
+        std::map<quint32, std::shared_ptr<std::atomic<bool>>> queries;  // running, by id
+    };
+
+    void onNewConnection();
+    void onReadyRead(QLocalSocket *socket);
+    void onDisconnected(QLocalSocket *socket);
+    void handle(QLocalSocket *socket, const QByteArray &payload);
+
+    void configure(const QJsonObject &config);
+    void query(QLocalSocket *socket, quint32 id, const QString &string,
+               bool match_paths, quint32 max_results);
+    void sendStatus(QLocalSocket *socket, quint32 id, const QString &text);
+
+    void updateSnapshot();
+    void load();
+    void storeConfig() const;
+    void storeIndex() const;
+
+    const QString socket_path_;
+    const QString cache_dir_;
+    FsIndex fs_index_;
+    QLocalServer server_;
+    std::map<QLocalSocket*, Connection> connections_;
+    std::shared_ptr<const Snapshot> snapshot_;  // main thread, copied by the queries
+
+};
@@ -0,0 +1,59 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "indexerprotocol.h"
+#include "indexerservice.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <csignal>
+#include <unistd.h>
+
+static int signal_pipe[2];
+
+// Async-signal-safe, the event loop reads the pipe and quits
+static void onSignal(int)
+{
+    const char c = 0;
+    [[maybe_unused]] auto n = write(signal_pipe[1], &c, 1);
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("albert-files-indexer"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("File indexer service of the albert files plugin."));
+    parser.addHelpOption();
+    QCommandLineOption socket_option(
+        QStringLiteral("socket"), QStringLiteral("Path of the local socket."), QStringLiteral("path"),
+        indexer_protocol::socketPath());
+    QCommandLineOption cache_option(
+        QStringLiteral("cache-dir"), QStringLiteral("Directory of the persisted config and index."), QStringLiteral("path"),
+        QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation))
+            .filePath(QStringLiteral("albert/files-indexer")));
+    parser.addOption(socket_option);
+    parser.addOption(cache_option);
+    parser.process(app);
+
+    // Quit cleanly to persist the index
+    if (pipe(signal_pipe) != 0)
+        return 1;
+    QSocketNotifier signal_notifier(signal_pipe[0], QSocketNotifier::Read);
+    QObject::connect(&signal_notifier, &QSocketNotifier::activated, &app, [&]
+    {
+        char c;
+        [[maybe_unused]] auto n = read(signal_pipe[0], &c, 1);
+        app.quit();
+    });
+    for (auto sig : {SIGINT, SIGTERM})
+        std::signal(sig, onSignal);
+
+    IndexerService service(parser.value(socket_option), parser.value(cache_option));
+    if (!service.listen())
+        return 1;
+
+    return app.exec();
+}
@@ -1,6 +1,7 @@
 // Copyright (c) 2022-2023 Manuel Schneider
 
 #include "configwidget.h"
+#include "memoryreport.h"
 #include "mimefilterdialog.h"
 #include "namefilterdialog.h"
 #include "plugin.h"
@@ -37,6 +38,18 @@ ConfigWidget::ConfigWidget(Plugin *plu, QWidget *par) : QWidget(par), plugin(plu
     ALBERT_PROPERTY_CONNECT_CHECKBOX(plugin, index_file_path,
                                      ui.indexFilePathCheckBox)
 
+    ALBERT_PROPERTY_CONNECT_CHECKBOX(plugin, infix_matching,
+                                     ui.infixMatchingCheckBox)
+
+    ALBERT_PROPERTY_CONNECT_CHECKBOX(plugin, use_indexer_service,
+                                     ui.useIndexerServiceCheckBox)
+
+    ALBERT_PROPERTY_CONNECT_CHECKBOX(plugin, show_thumbnails,
+                                     ui.showThumbnailsCheckBox)
+
+    ALBERT_PROPERTY_CONNECT_CHECKBOX(plugin, generate_thumbnails,
+                                     ui.generateThumbnailsCheckBox)
+
     auto &index_paths = plu->fsIndex().indexPaths();
     paths_model.setStringList(getPaths(index_paths));
     ui.listView_paths->setModel(&paths_model);
@@ -98,10 +111,32 @@ ConfigWidget::ConfigWidget(Plugin *plu, QWidget *par) : QWidget(par), plugin(plu
                     ui.spinBox_depth->setValue(static_cast<int>(fsp->maxDepth()));
                     ui.spinBox_interval->setValue(static_cast<int>(fsp->scanInterval()));
                     ui.checkBox_fswatch->setChecked(fsp->watchFileSystem());
+                    ui.checkBox_locate->setChecked(fsp->useLocateDb());
                     adjustMimeCheckboxes();
+                    updateHotSpots();
                 }
             });
 
+    connect(&plugin->fsIndex(), &FsIndex::updatedFinished, this, [this]{
+        if (!current_path.isEmpty() && plugin->fsIndex().indexPaths().count(current_path))
+            updateHotSpots();
+    });
+
+    connect(ui.treeWidget_hotspots, &QTreeWidget::currentItemChanged, this,
+            [this](QTreeWidgetItem *current){ ui.pushButton_exclude->setEnabled(current); });
+
+    connect(ui.pushButton_exclude, &QPushButton::clicked, this, [this]() {
+        if (auto *item = ui.treeWidget_hotspots->currentItem())
+        {
+            auto &fsp = plugin->fsIndex().indexPaths().at(current_path);
+            auto filters = fsp->nameFilters();
+            filters << QString("^%1$").arg(QRegularExpression::escape(item->text(0)));
+            filters.removeDuplicates();
+            fsp->setNameFilters(filters);
+            delete item;
+        }
+    });
+
     connect(ui.pushButton_namefilters, &QPushButton::clicked, this, [this]() {
         auto &fsp = plugin->fsIndex().indexPaths().at(current_path);
         NameFilterDialog dialog(fsp->nameFilters(), this);
@@ -132,6 +167,9 @@ ConfigWidget::ConfigWidget(Plugin *plu, QWidget *par) : QWidget(par), plugin(plu
     connect(ui.checkBox_followSymlinks, &QCheckBox::clicked, this,
             [this](bool value){ plugin->fsIndex().indexPaths().at(current_path)->setFollowSymlinks(value); });
 
+    connect(ui.checkBox_locate, &QCheckBox::clicked, this,
+            [this](bool value){ plugin->fsIndex().indexPaths().at(current_path)->setUseLocateDb(value); });
+
     connect(ui.spinBox_interval, &QSpinBox::editingFinished, this,
             [this](){ plugin->fsIndex().indexPaths().at(current_path)->setScanInterval(ui.spinBox_interval->value()); });
 
@@ -178,6 +216,24 @@ ConfigWidget::ConfigWidget(Plugin *plu, QWidget *par) : QWidget(par), plugin(plu
             ui.listView_paths->contentsMargins().bottom() +
             ui.listView_paths->contentsMargins().top() +
             paths_model.rowCount()*ui.listView_paths->sizeHintForRow(0));
+
+    ui.verticalLayout_2->addWidget(memory::createWidget(plugin->id(), this));
+}
+
+void ConfigWidget::updateHotSpots()
+{
+    ui.treeWidget_hotspots->clear();
+    for (const auto &[path, stats] : plugin->fsIndex().indexPaths().at(current_path)->hotSpots())
+    {
+        auto *item = new QTreeWidgetItem(ui.treeWidget_hotspots);
+        item->setText(0, path);
+        item->setData(1, Qt::DisplayRole, stats.items);
+        item->setData(2, Qt::DisplayRole, stats.dirs);
+        item->setData(3, Qt::DisplayRole, (qint64)(stats.nsecs / 1000000));
+        item->setData(4, Qt::DisplayRole, stats.mime_reads);
+    }
+    ui.treeWidget_hotspots->sortByColumn(1, Qt::DescendingOrder);
+    ui.treeWidget_hotspots->resizeColumnToContents(0);
 }
 
 void ConfigWidget::adjustMimeCheckboxes()
@@ -16,6 +16,7 @@ public:
     Ui::ConfigWidget ui;
 private:
     void adjustMimeCheckboxes();
+    void updateHotSpots();
     QStringListModel paths_model;
     QString current_path;
     Plugin *plugin;
@@ -0,0 +1,380 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "contentsearch.h"
+#include "fileitems.h"
+#include "trace.h"
+#include <QFile>
+#include <QHash>
+#include <QThread>
+#include <albert/logging.h>
+#include <albert/query.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace albert;
+using namespace std;
+
+static const size_t max_file_size = 64 << 20;
+static const size_t mmap_threshold = 256 << 10;  // reading is cheaper for small files
+static const size_t binary_probe_size = 8 << 10;
+static const size_t max_line_length = 256;
+static const uint max_results = 250;
+
+
+ContentMatcher::ContentMatcher(const QString &pattern)
+{
+    if (pattern.size() > 2 && pattern.startsWith('/') && pattern.endsWith('/'))
+    {
+        const auto re = pattern.mid(1, pattern.size() - 2);
+        regex_.emplace(re, QRegularExpression::UseUnicodePropertiesOption);
+        regex_->optimize();
+
+        // The prefilter may yield false positives, i.e. ignore the case
+        literal_ = requiredLiteral(re).toLower().toUtf8();
+        case_sensitive_ = false;
+    }
+    else
+    {
+        case_sensitive_ = pattern != pattern.toLower();
+        literal_ = (case_sensitive_ ? pattern : pattern.toLower()).toUtf8();
+
+        // Byte wise case folding works for ASCII only
+        if (!case_sensitive_ && any_of(literal_.begin(), literal_.end(), [](char c){ return c & 0x80; }))
+        {
+            regex_.emplace(QRegularExpression::escape(pattern),
+                           QRegularExpression::CaseInsensitiveOption | QRegularExpression::UseUnicodePropertiesOption);
+            literal_.clear();
+        }
+    }
+}
+
+bool ContentMatcher::isValid() const
+{ return regex_ ? regex_->isValid() && !regex_->pattern().isEmpty() : !literal_.isEmpty(); }
+
+QString ContentMatcher::requiredLiteral(const QString &re)
+{
+    if (re.contains('|') || re.contains("(?"))  // alternations, options like extended
+        return {};
+
+    QString best, run;
+    auto flush = [&]
+    {
+        if (run.size() > best.size())
+            best = run;
+        run.clear();
+    };
+
+    int depth = 0;  // of groups, their contents may be optional
+    for (qsizetype i = 0; i < re.size(); ++i)
+    {
+        const auto c = re[i];
+        const auto next = i + 1 < re.size() ? re[i + 1] : QChar();
+
+        if (c == '\\')
+        {
+            flush();
+            ++i;
+        }
+        else if (c == '[')
+        {
+            flush();
+            ++i;
+            if (i < re.size() && re[i] == '^')
+                ++i;
+            if (i < re.size() && re[i] == ']')  // literal if first
+                ++i;
+            while (i < re.size() && re[i] != ']')
+                i += re[i] == '\\' ? 2 : 1;
+        }
+        else if (c == '{')  // quantifier
+        {
+            flush();
+            while (i < re.size() && re[i] != '}')
+                ++i;
+        }
+        else if (c == '(')
+        {
+            flush();
+            ++depth;
+        }
+        else if (c == ')')
+        {
+            flush();
+            --depth;
+        }
+        else if (depth || c.unicode() >= 0x80 || QStringView(u".^$+?*}]").contains(c)
+                 || next == '?' || next == '*' || next == '{')  // optional
+            flush();
+        else
+        {
+            run += c;
+            if (next == '+')
+                flush();
+        }
+    }
+    flush();
+    return best;
+}
+
+const char *ContentMatcher::findLiteral(const char *begin, const char *end) const
+{
+    const auto m = (size_t)literal_.size();
+    if ((size_t)(end - begin) < m)
+        return nullptr;
+
+    if (case_sensitive_)
+        return (const char*)memmem(begin, (size_t)(end - begin), literal_.constData(), m);
+
+    // Candidates are the positions of either case of the first char
+    const char *last = end - m + 1;
+    auto next = [last](const char *from, char c)
+    {
+        auto *p = (const char*)memchr(from, c, (size_t)(last - from));
+        return p ? p : last;
+    };
+    const char lower = literal_[0];
+    const char upper = (char)toupper((unsigned char)lower);
+    const char *l = next(begin, lower);
+    const char *u = lower == upper ? last : next(begin, upper);
+    for (;;)
+    {
+        const char *c = min(l, u);
+        if (c == last)
+            return nullptr;
+        if (strncasecmp(c + 1, literal_.constData() + 1, m - 1) == 0)
+            return c;
+        if (c == l)
+            l = next(l + 1, lower);
+        else
+            u = next(u + 1, upper);
+    }
+}
+
+optional<ContentMatcher::Line> ContentMatcher::firstMatch(const char *data, size_t size) const
+{
+    const char *end = data + size;
+    auto lineBegin = [data](const char *p)
+    {
+        while (p > data && p[-1] != '\n')
+            --p;
+        return p;
+    };
+    auto lineEnd = [end](const char *p)
+    {
+        auto *e = (const char*)memchr(p, '\n', (size_t)(end - p));
+        return e ? e : end;
+    };
+    auto line = [&](const char *b, const char *e)
+    {
+        uint number = 1;
+        for (const char *p = data; (p = (const char*)memchr(p, '\n', (size_t)(b - p))); ++p)
+            ++number;
+        return Line{number, QString::fromUtf8(b, min<qsizetype>(e - b, max_line_length)).trimmed()};
+    };
+
+    for (const char *p = data; p < end;)
+    {
+        // Next line containing the literal
+        const char *b = p;
+        if (!literal_.isEmpty())
+        {
+            const char *hit = findLiteral(p, end);
+            if (!hit)
+                return {};
+            b = lineBegin(hit);
+        }
+        const char *e = lineEnd(b);
+
+        if (!regex_ || regex_->match(QString::fromUtf8(b, e - b)).hasMatch())
+            return line(b, e);
+
+        p = e + 1;
+    }
+    return {};
+}
+
+
+// -------------------------------------------------------------------------------------------------
+
+namespace
+{
+
+class ContentItem : public StandardFile
+{
+public:
+    ContentItem(const FileItem &file, ContentMatcher::Line line):
+        StandardFile(file.filePath(), file.mimeType()), line_(::move(line)) {}
+
+    QString subtext() const override
+    { return QString("%1:%2 %3").arg(filePath()).arg(line_.number).arg(line_.text); }
+
+private:
+    const ContentMatcher::Line line_;
+};
+
+shared_ptr<Item> grep(const FileItem &file, const ContentMatcher &matcher, vector<char> &buffer)
+{
+    const int fd = open(QFile::encodeName(file.filePath()).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+
+    struct stat st;
+    const char *data = nullptr;
+    size_t size = 0;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && (size_t)st.st_size <= max_file_size)
+    {
+        size = (size_t)st.st_size;
+        if (size < mmap_threshold)
+        {
+            buffer.resize(size);
+            ssize_t n = 0;
+            for (size_t read_size = 0; read_size < size; read_size += (size_t)n)
+                if ((n = read(fd, buffer.data() + read_size, size - read_size)) <= 0)
+                {
+                    size = read_size;
+                    break;
+                }
+            data = buffer.data();
+        }
+        else if ((map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+        {
+            madvise(map, size, MADV_SEQUENTIAL);
+            data = (const char*)map;
+        }
+    }
+    close(fd);
+
+    shared_ptr<Item> item;
+    if (data && !memchr(data, 0, min(size, binary_probe_size)))
+        if (auto line = matcher.firstMatch(data, size))
+            item = make_shared<ContentItem>(file, ::move(*line));
+
+    if (map != MAP_FAILED)
+        munmap(map, size);
+    return item;
+}
+
+}
+
+
+ContentSearch::ContentSearch()
+{ pool_.setMaxThreadCount(clamp(QThread::idealThreadCount(), 1, 8)); }
+
+ContentSearch::~ContentSearch() { pool_.waitForDone(); }
+
+QString ContentSearch::id() const { return "grep"; }
+
+QString ContentSearch::name() const { return tr("Content search"); }
+
+QString ContentSearch::description() const { return tr("Search the contents of indexed text files"); }
+
+QString ContentSearch::synopsis() const { return tr("[*.ext] <text>|/<regex>/"); }
+
+QString ContentSearch::defaultTrigger() const { return "grep "; }
+
+void ContentSearch::setFiles(const vector<shared_ptr<FileItem>> &files)
+{
+    QHash<QString, bool> is_text;  // by mime type
+    auto text_files = make_shared<vector<shared_ptr<FileItem>>>();
+    for (const auto &file : files)
+    {
+        const auto &mime_type = file->mimeType();
+        auto it = is_text.find(mime_type.name());
+        if (it == is_text.end())
+            it = is_text.insert(mime_type.name(), mime_type.inherits("text/plain"));
+        if (*it)
+            text_files->emplace_back(file);
+    }
+    text_files->shrink_to_fit();
+
+    lock_guard lock(files_mutex_);
+    files_ = ::move(text_files);
+}
+
+void ContentSearch::handleTriggerQuery(Query *query)
+{
+    TRACE_SCOPE("query", "files content");
+    // Optional file name filter, e.g. *.cpp
+    auto pattern = query->string().trimmed();
+    optional<QRegularExpression> name_filter;
+    if (pattern.startsWith("*."))
+    {
+        const auto space = pattern.indexOf(' ');
+        name_filter.emplace(QRegularExpression::fromWildcard(pattern.left(space), Qt::CaseInsensitive));
+        pattern = space < 0 ? QString() : pattern.mid(space + 1).trimmed();
+    }
+
+    const ContentMatcher matcher(pattern);
+    if (!matcher.isValid())
+        return;
+
+    shared_ptr<const vector<shared_ptr<FileItem>>> files;
+    {
+        lock_guard lock(files_mutex_);
+        files = files_;
+    }
+    if (!files)
+        return;
+
+    atomic<size_t> next(0);
+    atomic<bool> stop(false);
+    mutex mutex;
+    condition_variable found_cv;
+    vector<shared_ptr<Item>> found;  // not yet added
+    uint found_count = 0;
+    int running = pool_.maxThreadCount();
+
+    for (int t = running; t > 0; --t)
+        pool_.start([&]
+        {
+            vector<char> buffer;
+            for (size_t i; !stop && (i = next++) < files->size();)
+            {
+                const auto &file = *(*files)[i];
+                if (name_filter && !name_filter->match(file.name()).hasMatch())
+                    continue;
+                if (auto item = grep(file, matcher, buffer))
+                {
+                    lock_guard lock(mutex);
+                    found.emplace_back(::move(item));
+                    if (++found_count == max_results)
+                        stop = true;
+                    found_cv.notify_one();
+                }
+            }
+            lock_guard lock(mutex);
+            --running;
+            found_cv.notify_one();
+        });
+
+    // Stream the hits, stop on invalidation
+    unique_lock lock(mutex);
+    for (;;)
+    {
+        found_cv.wait_for(lock, 20ms, [&]{ return !found.empty() || !running; });
+
+        if (!found.empty())
+        {
+            auto items = ::move(found);
+            found.clear();
+            lock.unlock();
+            query->add(::move(items));
+            lock.lock();
+        }
+
+        if (!query->isValid())
+            stop = true;
+
+        if (!running && found.empty())
+            break;
+    }
+
+    DEBG << "Content search found" << found_count << "of" << files->size() << "files"
+         << (stop ? "(stopped)" : "");
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QCoreApplication>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <albert/triggerqueryhandler.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+class FileItem;
+
+///
+/// Finds the first line of a text matching a pattern.
+///
+/// Patterns enclosed in slashes are regular expressions, others are literals.
+/// Literals are matched case insensitive unless they contain upper case
+/// letters. Literals are searched using memmem respectively memchr, which
+/// libc implements using SIMD. Regular expressions are matched line wise, on
+/// the lines containing the longest literal every match requires, if any.
+///
+class ContentMatcher
+{
+public:
+
+    explicit ContentMatcher(const QString &pattern);
+
+    bool isValid() const;
+
+    struct Line
+    {
+        uint number;  // 1-based
+        QString text;
+    };
+
+    std::optional<Line> firstMatch(const char *data, size_t size) const;
+
+    /// The longest literal contained in every match of `regex`. Empty if
+    /// there is none or the expression is too complex to tell.
+    static QString requiredLiteral(const QString &regex);
+
+private:
+
+    const char *findLiteral(const char *begin, const char *end) const;
+
+    QByteArray literal_;  // UTF-8, lower case if case insensitive
+    bool case_sensitive_;
+    std::optional<QRegularExpression> regex_;
+
+};
+
+
+///
+/// Searches the contents of the indexed text files.
+///
+/// The files are searched in parallel on a thread pool. Small files are read,
+/// larger ones mapped. Files containing null bytes are considered binary and
+/// skipped. Hits are added to the query as they are found, the search stops as
+/// soon as the query is invalidated.
+///
+class ContentSearch : public albert::TriggerQueryHandler
+{
+    Q_DECLARE_TR_FUNCTIONS(ContentSearch)
+public:
+
+    ContentSearch();
+    ~ContentSearch();
+
+    QString id() const override;
+    QString name() const override;
+    QString description() const override;
+    QString synopsis() const override;
+    QString defaultTrigger() const override;
+    void handleTriggerQuery(albert::Query *) override;
+
+    /// The candidates, keeps the ones of text mime types
+    void setFiles(const std::vector<std::shared_ptr<FileItem>> &files);
+
+private:
+
+    std::mutex files_mutex_;
+    std::shared_ptr<const std::vector<std::shared_ptr<FileItem>>> files_;
+    QThreadPool pool_;
+
+};
@@ -2,6 +2,7 @@
 
 #include "filebrowsers.h"
 #include "fileitems.h"
+#include "trace.h"
 #include <albert/logging.h>
 #include <QCoreApplication>
 #include <QDir>
@@ -23,6 +24,7 @@ bool FilePathBrowser::allowTriggerRemap() const { return false; }
 
 void FilePathBrowser::handle_(Query &query, const QString &query_string) const
 {
+    TRACE_SCOPE("query", "files browser");
     vector<shared_ptr<Item>> results;
     QFileInfo query_file_info(query_string);
     QDir dir(query_file_info.path());
@@ -2,6 +2,7 @@
 
 #include "fileitems.h"
 #include "fsindexnodes.h"
+#include "thumbnailcache.h"
 #include <QClipboard>
 #include <QDir>
 #include <QFileInfo>
@@ -45,6 +46,9 @@ QStringList FileItem::iconUrls() const
     }
 
     QStringList urls;
+    if (auto *thumbnails = thumbnailCache(); thumbnails && ThumbnailCache::hasThumbnails(mimeType()))
+        if (auto thumbnail = thumbnails->find(filePath()); thumbnail && !thumbnail->isEmpty())
+            urls << QString("file:%1").arg(*thumbnail);
 #if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
     urls << QString("xdg:%1").arg(mimeType().iconName());
     urls << QString("xdg:%1").arg(mimeType().genericIconName());
@@ -4,6 +4,10 @@
 #include <QMimeType>
 #include <albert/item.h>
 class DirNode;
+class ThumbnailCache;
+
+/// The thumbnail cache of the item icons, null if thumbnails are disabled
+ThumbnailCache *thumbnailCache();
 
 
 class FileItem : public albert::Item
@@ -1,6 +1,7 @@
 // Copyright (c) 2022 Manuel Schneider
 
 #include "fsindex.h"
+#include "trace.h"
 #include <QtConcurrent>
 #include <albert/logging.h>
 using namespace std;
@@ -8,6 +9,8 @@ using namespace std;
 FsIndex::FsIndex(): abort(false)
 {
     QObject::connect(&future_watcher, &QFutureWatcher<void>::finished, this, [this](){
+        if (updating)  // watch new directories
+            updating->updateWatches();
         updating = nullptr;
         if (queue.empty())
             emit updatedFinished();
@@ -47,6 +50,7 @@ void FsIndex::removePath(const QString &path)
         if (fsp.get() == updating){
             abort = true;
             future_watcher.waitForFinished();
+            updating = nullptr;
         }
         index_paths_.erase(path);
     } catch (const out_of_range&) {
@@ -54,10 +58,22 @@ void FsIndex::removePath(const QString &path)
     }
 }
 
-void FsIndex::updateThreaded(FsIndexPath *p)
+void FsIndex::setIndexingEnabled(bool enabled) { indexing_enabled = enabled; }
+
+void FsIndex::updateThreaded(FsIndexPath *p, bool scheduled)
 {
-    queue.insert(p);
-    if (updating == p)
+    if (!indexing_enabled)
+    {
+        emit updateRequested();
+        return;
+    }
+
+    // Merged requests verify the due dirs only if all of them are scheduled
+    if (auto [it, inserted] = queue.emplace(p, scheduled); !inserted)
+        it->second = it->second && scheduled;
+
+    // Scheduled passes do not interrupt, they are queued behind the running update
+    if (updating == p && !scheduled)
         abort = true;
     runIndexer();
 }
@@ -65,12 +81,15 @@ void FsIndex::updateThreaded(FsIndexPath *p)
 void FsIndex::runIndexer()
 {
     if (!future_watcher.isRunning() && !queue.empty()){
-        updating = *queue.begin();
+        updating = queue.begin()->first;
+        const bool scheduled = queue.begin()->second;
         queue.erase(queue.begin());
         INFO << "Indexing" << updating->path();
-        future_watcher.setFuture(QtConcurrent::run([this, fsp=updating](){
+        // The tick is taken here, the scan interval timer runs on this thread
+        future_watcher.setFuture(QtConcurrent::run([this, fsp=updating, scheduled, tick=updating->scanTick()](){
             try{
-                fsp->update(abort, [this](const QString &s){ emit status(s);});
+                TRACE_SCOPE("files", "scan");
+                fsp->update(abort, [this](const QString &s){ emit status(s);}, scheduled, tick);
             } catch(const exception &e){
                 CRIT << "Indexer crashed" << e.what();
             }
@@ -6,7 +6,6 @@
 #include <QString>
 #include <map>
 #include <memory>
-#include <set>
 
 class FsIndex : public QObject
 {
@@ -22,18 +21,24 @@ public:
 
     void update(FsIndexPath *p = nullptr);
 
+    /// If disabled, updates are not run but signaled by updateRequested, e.g.
+    /// to delegate them to the indexer service
+    void setIndexingEnabled(bool enabled);
+
 private:
-    void updateThreaded(FsIndexPath *p);
+    void updateThreaded(FsIndexPath *p, bool scheduled = false);
     void runIndexer();
     QFutureWatcher<void> future_watcher;
     FsIndexPath *updating;
-    std::set<FsIndexPath*> queue;
+    std::map<FsIndexPath*, bool> queue;  // scheduled, i.e. due dirs only
     bool abort;
+    bool indexing_enabled = true;
     std::map<QString, std::unique_ptr<FsIndexPath>> index_paths_;  // DO NOT JUST REMOVE
 
 signals:
     void status(const QString&);
     void updatedFinished();
+    void updateRequested();
 };
 
 
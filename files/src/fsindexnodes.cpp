@@ -3,11 +3,14 @@
 #include "fileitems.h"
 #include "fsindexnodes.h"
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QMimeDatabase>
 #include <QRegularExpression>
 #include <QString>
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <utility>
@@ -19,11 +22,30 @@ static const char *JK_PATH = "path";
 static const char *JK_MDATE = "mdate";
 static const char *JK_CHILDREN = "children";
 static const char *JK_ITEMS = "items";
+static const char *JK_LEVEL = "level";
+
+// Verification intervals of 1 << level scan ticks
+static const uint8_t default_interval_level = 2;  // the scan interval
+static const uint8_t max_interval_level = 6;
 
 // https://code.qt.io/cgit/qt/qtbase.git/tree/src/corelib/mimetypes/qmimedatabase.cpp?h=dev
 static QMimeDatabase mdb;
 static QMimeType dirmimetype = mdb.mimeTypeForName(QStringLiteral("inode/directory"));
 
+// Same result as mdb.mimeTypeForFile(fi). Regular files with exactly one glob
+// match are resolved by name, like Qt does, the others fall back to Qt, which
+// reads the content of files. Counts these reads.
+static QMimeType mimeTypeForFile(const QFileInfo &fi, uint32_t &content_reads)
+{
+    if (fi.isFile())
+    {
+        if (const auto by_name = mdb.mimeTypesForFileName(fi.fileName()); by_name.size() == 1)
+            return by_name.front();
+        ++content_reads;
+    }
+    return mdb.mimeTypeForFile(fi);
+}
+
 
 NameFilter::NameFilter(QRegularExpression re, PatternType t) : regex(std::move(re)), type(t) {}
 
@@ -36,7 +58,8 @@ NameFilter::NameFilter(const QString &pattern) : regex(pattern), type(PatternTyp
 
 
 DirNode::DirNode(QString name, const std::shared_ptr<DirNode>& parent, uint64_t mdate):
-        parent_(parent), name_(std::move(name)), mdate_(mdate) { name_.shrink_to_fit(); }
+        parent_(parent), name_(std::move(name)), mdate_(mdate),
+        due_tick_(0), interval_level_(default_interval_level) { name_.shrink_to_fit(); }
 
 DirNode::~DirNode() = default;
 
@@ -49,6 +72,7 @@ shared_ptr<DirNode> DirNode::fromJson(const QJsonObject &json, const std::shared
 {
     // need a factory since shared_from_this is not available in ctor
     shared_ptr<DirNode> d(new DirNode(json[JK_NAME].toString(), parent, json[JK_MDATE].toVariant().toULongLong()));
+    d->interval_level_ = (uint8_t)min(json[JK_LEVEL].toInt(default_interval_level), (int)max_interval_level);
 
     for (const auto &json_value : json[JK_CHILDREN].toArray())
         d->children_.emplace_back(fromJson(json_value.toObject(), d));
@@ -69,6 +93,8 @@ QJsonObject DirNode::toJson() const
     QJsonObject json;
     json.insert(JK_NAME, name_);
     json.insert(JK_MDATE, (qint64)mdate_);
+    if (interval_level_ != default_interval_level)
+        json.insert(JK_LEVEL, interval_level_);
 
     QJsonArray json_children;
     for (const auto &child : children_)
@@ -94,6 +120,13 @@ void DirNode::removeChildren()
     children_.clear();
 }
 
+void DirNode::clear()
+{
+    removeChildren();
+    items_.clear();
+    mdate_ = 0;
+}
+
 void DirNode::update(const std::shared_ptr<DirNode>& shared_this,
                      const bool &abort,
                      std::function<void(const QString&)> &status,
@@ -104,6 +137,32 @@ void DirNode::update(const std::shared_ptr<DirNode>& shared_this,
     if (abort)
         return;
 
+    if (settings.mtimes && mdate_ != 0)  // not new
+    {
+        const auto it = settings.mtimes->find(this);
+
+        // Not due yet, the children may be
+        if (it == settings.mtimes->end() && settings.scheduled)
+        {
+            for (auto &child : children_)
+                child->update(child, abort, status, settings, indexed_dirs, depth+1);
+            return;
+        }
+
+        // Unchanged according to the batched stat. Skips the stat and the
+        // resolution of the canonical path, which stats every path component.
+        // Loops are possible via followed links only, in that case resolve.
+        if (it != settings.mtimes->end() && !settings.follow_symlinks
+            && it->second >= 0 && (uint64_t)it->second <= mdate_)
+        {
+            verified(false, settings.tick);
+            if (indexed_dirs.emplace(filePath()).second)
+                for (auto &child : children_)
+                    child->update(child, abort, status, settings, indexed_dirs, depth+1);
+            return;
+        }
+    }
+
     const QFileInfo fileInfo(filePath());
 
     // Skip if this dir has already been indexed (loop detection)
@@ -112,9 +171,19 @@ void DirNode::update(const std::shared_ptr<DirNode>& shared_this,
 
     auto mdate = (uint64_t)fileInfo.lastModified().toSecsSinceEpoch();
 
+    if (settings.forced || mdate_ == 0)
+        due_tick_ = settings.tick + (1 << interval_level_);
+    else
+        verified(mdate_ < mdate, settings.tick);
+
     if (settings.forced || mdate_ < mdate) {
         mdate_ = mdate;
 
+        DirStats stats;
+        QElapsedTimer timer, subdir_timer;
+        int64_t subdir_nsecs = 0;
+        timer.start();
+
         QString absFilePath = fileInfo.absoluteFilePath();
         status(QString("Indexing %1").arg(fileInfo.filePath()));
 
@@ -125,6 +194,7 @@ void DirNode::update(const std::shared_ptr<DirNode>& shared_this,
         auto cit = children_.begin();
         auto iit = items_.begin();
         for (const auto &fi : QDir(absFilePath).entryInfoList(filters, QDir::Name)) {
+            ++stats.entries;
 
             // Erase children and items which do not exists anymore (until this lexicographic point)
             while (cit != children_.end() && (*cit)->name_ < fi.fileName())
@@ -151,13 +221,15 @@ void DirNode::update(const std::shared_ptr<DirNode>& shared_this,
                 } else {
                     if (!is_indexed)
                         cit = children_.emplace(cit, DirNode::make(fi.fileName(), shared_this));
+                    subdir_timer.start();
                     (*cit)->update(*cit, abort, status, settings, indexed_dirs, depth+1);  // UPDATE new directories always
+                    subdir_nsecs += subdir_timer.nsecsElapsed();
                     ++cit;
                 }
             }
 
             // Items
-            auto mime_type = mdb.mimeTypeForFile(fi);
+            auto mime_type = mimeTypeForFile(fi, stats.mime_reads);
             exclude = none_of(settings.mime_filters.begin(), settings.mime_filters.end(),
                                [mt = mime_type.name()](const QRegularExpression &re) {
                                    return re.match(mt).hasMatch();
@@ -183,6 +255,12 @@ void DirNode::update(const std::shared_ptr<DirNode>& shared_this,
         children_.shrink_to_fit();
         items_.shrink_to_fit();
 
+        if (settings.stats)
+        {
+            stats.nsecs = timer.nsecsElapsed() - subdir_nsecs;
+            (*settings.stats)[this] = stats;
+        }
+
     } else {
         // Not dirty or forced
         // Check children anyway because mdates dont propagate upwards
@@ -191,6 +269,50 @@ void DirNode::update(const std::shared_ptr<DirNode>& shared_this,
     }
 }
 
+int DirNode::overdue(uint16_t tick) const { return (int16_t)(tick - due_tick_); }
+
+void DirNode::verified(bool changed, uint16_t tick)
+{
+    if (changed)
+        interval_level_ = 0;
+    else if (interval_level_ < max_interval_level)
+        ++interval_level_;
+    due_tick_ = tick + (1 << interval_level_);
+}
+
+SubtreeStats DirNode::subtreeStats(const unordered_map<const DirNode*, DirStats> &stats,
+                                   vector<pair<const DirNode*, SubtreeStats>> &hot_spots) const
+{
+    SubtreeStats total, max_child;
+    total.dirs = 1;
+    total.items = (uint32_t)items_.size();
+    if (auto it = stats.find(this); it != stats.end())
+    {
+        total.entries = it->second.entries;
+        total.mime_reads = it->second.mime_reads;
+        total.nsecs = it->second.nsecs;
+    }
+
+    for (const auto &child : children_)
+    {
+        const auto s = child->subtreeStats(stats, hot_spots);
+        total.dirs += s.dirs;
+        total.items += s.items;
+        total.entries += s.entries;
+        total.mime_reads += s.mime_reads;
+        total.nsecs += s.nsecs;
+        max_child.items = max(max_child.items, s.items);
+        max_child.nsecs = max(max_child.nsecs, s.nsecs);
+    }
+
+    // A subdir holding 90 % of the items and the time is the more precise hot spot
+    if ((total.items || total.nsecs)
+        && (max_child.items < total.items * 9 / 10 || max_child.nsecs < total.nsecs * 9 / 10))
+        hot_spots.emplace_back(this, total);
+
+    return total;
+}
+
 QString DirNode::path() const { return parent_->filePath(); }
 
 QString DirNode::filePath() const { return parent_->filePath().append("/").append(name_); }
@@ -238,6 +360,7 @@ std::shared_ptr<RootNode> RootNode::fromJson(const QJsonObject &json)
     auto n = make(json[JK_NAME].toString());
     n->path_ = json[JK_PATH].toString();
     n->mdate_ = json[JK_MDATE].toVariant().toULongLong();
+    n->interval_level_ = (uint8_t)min(json[JK_LEVEL].toInt(default_interval_level), (int)max_interval_level);
 
     for (const auto &json_value : json[JK_CHILDREN].toArray())
         n->children_.emplace_back(DirNode::fromJson(json_value.toObject(), n));
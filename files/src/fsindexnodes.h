@@ -6,7 +6,9 @@
 #include <QRegularExpression>
 #include <QTimer>
 #include <set>
+#include <unordered_map>
 
+class DirNode;
 class IndexFileItem;
 class FileItem;
 class QMimeType;
@@ -23,6 +25,26 @@ struct NameFilter {
 };
 
 
+/// Cost of the last enumeration of a dir
+struct DirStats
+{
+    uint32_t entries = 0;
+    uint32_t mime_reads = 0;  // files typed by content, i.e. read
+    int64_t nsecs = 0;  // enumerating and classifying, excluding subdirs
+};
+
+
+/// Accumulated over a subtree, see DirNode::subtreeStats
+struct SubtreeStats
+{
+    uint32_t dirs = 0;
+    uint32_t items = 0;
+    uint32_t entries = 0;
+    uint32_t mime_reads = 0;
+    int64_t nsecs = 0;
+};
+
+
 struct IndexSettings
 {
     QString root_path;
@@ -35,6 +57,13 @@ struct IndexSettings
     // uninformed update (scan)
     // traverse the entire tree anyway, because child dirs may have been modified
     bool scan_mode = true; // Todo use this for future filesystem watches(false)
+    // mtimes of the dirs to verify from a batched stat, unforced updates only
+    const std::unordered_map<const DirNode*, int64_t> *mtimes = nullptr;
+    // verify only the dirs in mtimes, the others are not due yet
+    bool scheduled = false;
+    uint16_t tick = 0;  // of the scan schedule, see DirNode::overdue
+    // receives the stats of the enumerated dirs
+    std::unordered_map<const DirNode*, DirStats> *stats = nullptr;
 };
 
 
@@ -50,6 +79,7 @@ public:
     QJsonObject toJson() const;
 
     void removeChildren();
+    void clear();  // children and items
     void update(const std::shared_ptr<DirNode>& shared_this,
                 const bool &abort,
                 std::function<void(const QString&)> &status,
@@ -65,6 +95,17 @@ public:
     void nodes(std::vector<std::shared_ptr<DirNode>>&) const;
     std::shared_ptr<DirNode> node(const QString &relative_path) const;
 
+    /// Ticks since this dir is due for verification, negative if not due yet.
+    /// Dirs that changed recently are due every tick, the interval doubles
+    /// with every verification that finds the dir unchanged (up to 64 ticks).
+    int overdue(uint16_t tick) const;
+
+    /// Stats of this subtree given the `stats` of its dirs. Appends the
+    /// subtrees worth reporting, i.e. the ones not dominated by a single
+    /// subdir, to `hot_spots`.
+    SubtreeStats subtreeStats(const std::unordered_map<const DirNode*, DirStats> &stats,
+                              std::vector<std::pair<const DirNode*, SubtreeStats>> &hot_spots) const;
+
     static QMimeType dirMimeType();
 
 protected:
@@ -74,9 +115,13 @@ protected:
     DirNode &operator=(DirNode&&) = delete;
     DirNode &operator=(const DirNode&) = delete;
 
+    void verified(bool changed, uint16_t tick);
+
     const std::shared_ptr<DirNode> parent_;
     QString name_;
     uint32_t mdate_;
+    uint16_t due_tick_;
+    uint8_t interval_level_;  // log2 of the verification interval in ticks
     std::vector<std::shared_ptr<DirNode>> children_;
     std::vector<std::shared_ptr<IndexFileItem>> items_;
 };
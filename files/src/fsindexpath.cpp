@@ -3,17 +3,20 @@
 #include "fileitems.h"
 #include "fsindexnodes.h"
 #include "fsindexpath.h"
+#include "statbatch.h"
 #include <QFileInfo>
+#include <QJsonArray>
 #include <QJsonObject>
 #include <albert/logging.h>
+#include <algorithm>
 using namespace std;
 
-FsIndexPath::FsIndexPath(const QString &path) : root_(RootNode::make(path))
+FsIndexPath::FsIndexPath(const QString &path):
+    fs_watch_([this](const QStringList&){ emit updateRequired(this); }, chrono::seconds(1)),
+    root_(RootNode::make(path))
 {
-    connect(&fs_watcher_, &QFileSystemWatcher::directoryChanged,
-            this, [this](){ emit updateRequired(this); });
     connect(&scan_interval_timer_, &QTimer::timeout,
-            this, [this](){ emit updateRequired(this); });
+            this, [this](){ ++scan_tick_; emit updateRequired(this, true); });
 
     // Be tolerant but warn
     if (QFileInfo fi(root_->filePath()); !fi.exists())
@@ -30,12 +33,70 @@ QJsonObject FsIndexPath::serialize() const
 { return root_->toJson(); }
 
 void FsIndexPath::deserialize(const QJsonObject &json_object)
-{ root_ = RootNode::fromJson(json_object); }
+{
+    root_ = RootNode::fromJson(json_object);
+    dir_stats_.clear();
+}
+
+QJsonObject FsIndexPath::settings() const
+{
+    return {
+        {"nameFilters", QJsonArray::fromStringList(name_filters)},
+        {"mimeFilters", QJsonArray::fromStringList(mime_filters)},
+        {"indexhidden", index_hidden_files},
+        {"followSymlinks", follow_symlinks},
+        {"maxDepth", max_depth},
+        {"useFileSystemWatches", watch_fs},
+        {"scanInterval", (int)scanInterval()},
+        {"useLocateDb", use_locate_db}
+    };
+}
+
+void FsIndexPath::setSettings(const QJsonObject &json)
+{
+    auto strings = [](const QJsonValue &v){
+        QStringList l;
+        for (const auto &s : v.toArray())
+            l << s.toString();
+        return l;
+    };
+
+    if (auto v = strings(json["nameFilters"]); v != name_filters)
+        setNameFilters(v);
+    if (auto v = strings(json["mimeFilters"]); v != mime_filters)
+        setMimeFilters(v);
+    if (auto v = json["indexhidden"].toBool(); v != index_hidden_files)
+        setIndexHidden(v);
+    if (auto v = json["followSymlinks"].toBool(); v != follow_symlinks)
+        setFollowSymlinks(v);
+    if (auto v = (uint8_t)json["maxDepth"].toInt(255); v != max_depth)
+        setMaxDepth(v);
+    if (auto v = json["useFileSystemWatches"].toBool(); v != watch_fs)
+        setWatchFilesystem(v);
+    if (auto v = json["useLocateDb"].toBool(); v != use_locate_db)
+        setUseLocateDb(v);
+    if (auto v = (uint)json["scanInterval"].toInt(); v != scanInterval() || !scan_interval_timer_.isActive())
+        setScanInterval(v);
+}
 
 QString FsIndexPath::path() const { return root_->filePath(); }
 
+uint16_t FsIndexPath::scanTick() const { return scan_tick_; }
+
 void FsIndexPath::update(const bool &abort, std::function<void(const QString &)> status)
+{ update(abort, ::move(status), false, scan_tick_); }
+
+void FsIndexPath::update(const bool &abort, std::function<void(const QString &)> status,
+                         bool scheduled, uint16_t tick)
 {
+    if (use_locate_db)
+    {
+        root_->clear();
+        updateHotSpots({});
+        status(tr("%1 is served by the locate database.").arg(path()));
+        return;
+    }
+
     IndexSettings s;
 
     s.root_path = this->path();
@@ -50,16 +111,117 @@ void FsIndexPath::update(const bool &abort, std::function<void(const QString &)>
     s.follow_symlinks = follow_symlinks;
     s.max_depth = max_depth;
     s.forced = force_update;
+    s.scheduled = scheduled && !force_update;
+    s.tick = tick;
     std::set<QString> indexed_dirs;
 
+    // Verify the known directories in one batch. Only changed ones get enumerated.
+    unordered_map<const DirNode*, int64_t> mtimes;
+    if (!s.forced && (!s.follow_symlinks || s.scheduled))
+    {
+        vector<shared_ptr<DirNode>> nodes{root_};
+        root_->nodes(nodes);
+
+        // Scheduled scans verify the due dirs only, most overdue first. The
+        // budget caps the work per tick, deferred dirs stay due.
+        if (s.scheduled)
+        {
+            const auto budget = max<size_t>(512, nodes.size() / 16);
+            nodes.erase(remove_if(nodes.begin(), nodes.end(),
+                                  [&](const auto &n){ return n->overdue(s.tick) < 0; }),
+                        nodes.end());
+            if (nodes.size() > budget)
+            {
+                nth_element(nodes.begin(), nodes.begin() + budget, nodes.end(),
+                            [&](const auto &a, const auto &b){ return a->overdue(s.tick) > b->overdue(s.tick); });
+                nodes.resize(budget);
+            }
+        }
+
+        vector<string> paths;
+        paths.reserve(nodes.size());
+        for (const auto &node : nodes)
+            paths.emplace_back(QFile::encodeName(node->filePath()).toStdString());
+
+        statbatch::Backend backend;
+        const auto times = statbatch::mtimes(paths, &backend);
+        mtimes.reserve(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i)
+            mtimes.emplace(nodes[i].get(), times[i]);
+        s.mtimes = &mtimes;
+
+        DEBG << "Verified" << paths.size() << "directories of" << path() << "using"
+             << (backend == statbatch::Backend::IoUring ? "io_uring" : "threads");
+    }
+
+    unordered_map<const DirNode*, DirStats> enumerated;
+    s.stats = &enumerated;
+
     root_->update(root_, abort, status, s, indexed_dirs, 1);
 
-    status(tr("Indexed %n directories in %1.", nullptr, indexed_dirs.size()).arg(path()));
+    // Dirs are added and removed by enumerations only
+    if (!enumerated.empty())
+        updateHotSpots(enumerated);
+
+    if (s.scheduled)
+        status(tr("Verified %n directories in %1.", nullptr, mtimes.size()).arg(path()));
+    else
+        status(tr("Indexed %n directories in %1.", nullptr, indexed_dirs.size()).arg(path()));
 
     if (s.forced && !abort) // In case of successful forced run clear force flag
         force_update = false;
 }
 
+void FsIndexPath::updateHotSpots(const unordered_map<const DirNode*, DirStats> &enumerated)
+{
+    static const size_t count = 10;
+
+    // Keep the stats of existing dirs only
+    for (const auto &[node, stats] : enumerated)
+        dir_stats_[node] = stats;
+    vector<shared_ptr<DirNode>> nodes{root_};
+    root_->nodes(nodes);
+    unordered_map<const DirNode*, DirStats> dir_stats;
+    dir_stats.reserve(nodes.size());
+    for (const auto &node : nodes)
+        if (auto it = dir_stats_.find(node.get()); it != dir_stats_.end())
+            dir_stats.emplace(*it);
+    dir_stats_ = ::move(dir_stats);
+
+    vector<pair<const DirNode*, SubtreeStats>> candidates;
+    root_->subtreeStats(dir_stats_, candidates);
+    candidates.erase(remove_if(candidates.begin(), candidates.end(),
+                               [this](const auto &c){ return c.first == root_.get(); }),
+                     candidates.end());
+
+    // The subtrees with the most items and the ones with the most scan time
+    vector<const DirNode*> selected;
+    auto select = [&](auto heavier)
+    {
+        const auto end = candidates.begin() + (ptrdiff_t)min(count, candidates.size());
+        partial_sort(candidates.begin(), end, candidates.end(), heavier);
+        for (auto it = candidates.begin(); it != end; ++it)
+            if (find(selected.begin(), selected.end(), it->first) == selected.end())
+                selected.push_back(it->first);
+    };
+    select([](const auto &a, const auto &b){ return a.second.items > b.second.items; });
+    select([](const auto &a, const auto &b){ return a.second.nsecs > b.second.nsecs; });
+
+    vector<HotSpot> hot_spots;
+    for (const auto &[node, stats] : candidates)
+        if (find(selected.begin(), selected.end(), node) != selected.end())
+            hot_spots.push_back({node->relativeFilePath().mid(1), stats});
+
+    lock_guard lock(hot_spots_mutex_);
+    hot_spots_ = ::move(hot_spots);
+}
+
+vector<FsIndexPath::HotSpot> FsIndexPath::hotSpots() const
+{
+    lock_guard lock(hot_spots_mutex_);
+    return hot_spots_;
+}
+
 void FsIndexPath::items(vector<shared_ptr<FileItem>> &items) const
 {
     items.emplace_back(self);
@@ -78,7 +240,9 @@ uint8_t FsIndexPath::maxDepth() const { return max_depth; }
 
 bool FsIndexPath::watchFileSystem() const { return watch_fs; }
 
-uint FsIndexPath::scanInterval() const { return (uint)(scan_interval_timer_.interval()/60000); }
+bool FsIndexPath::useLocateDb() const { return use_locate_db; }
+
+uint FsIndexPath::scanInterval() const { return (uint)(scan_interval_timer_.interval()/15000); }
 
 void FsIndexPath::setNameFilters(const QStringList &val)
 {
@@ -115,27 +279,37 @@ void FsIndexPath::setMaxDepth(uint8_t val)
     emit updateRequired(this);
 }
 
+void FsIndexPath::setUseLocateDb(bool val)
+{
+    use_locate_db = val;
+    force_update = true;
+    emit updateRequired(this);
+}
+
 void FsIndexPath::setWatchFilesystem(bool val)
 {
     watch_fs = val;
-    if (val){
+    updateWatches();
+}
+
+void FsIndexPath::updateWatches()
+{
+    if (watch_fs){
         std::vector<std::shared_ptr<DirNode>> nodes;
         root_->nodes(nodes);
         QStringList l;
         for (auto &node : nodes)
             l << node->filePath();
         l << root_->filePath();
-        fs_watcher_.addPaths(l);
-    } else {
-        if (!fs_watcher_.directories().empty())
-            fs_watcher_.removePaths(fs_watcher_.directories());
-    }
+        fs_watch_.setPaths(l);
+    } else
+        fs_watch_.setPaths({});
 }
 
 void FsIndexPath::setScanInterval(uint minutes)
 {
     if (minutes)
-        scan_interval_timer_.start((int)(minutes*60000));
+        scan_interval_timer_.start((int)(minutes*15000));
     else
         scan_interval_timer_.stop();
 }
@@ -1,11 +1,14 @@
 // Copyright (c) 2022-2023 Manuel Schneider
 
 #pragma once
-#include <QFileSystemWatcher>
+#include "filewatch.h"
+#include "fsindexnodes.h"
 #include <QStringList>
 #include <QTimer>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 class FileItem;
 class QJsonObject;
@@ -22,9 +25,31 @@ public:
     QJsonObject serialize() const;
     void deserialize(const QJsonObject &json);
 
+    /// Settings in the format of the plugin config, used by the indexer service
+    QJsonObject settings() const;
+    void setSettings(const QJsonObject &json);  // sets changed values only
+
     QString path() const;
-    void update(const bool &abort, std::function<void(const QString&)> status);
+
+    /// Verifies the due dirs only if scheduled. The tick is the scan tick
+    /// taken on the main thread when the update got started, see scanTick().
+    void update(const bool &abort, std::function<void(const QString&)> status,
+                bool scheduled, uint16_t tick);
+    void update(const bool &abort, std::function<void(const QString&)> status);  // all dirs, main thread
+    uint16_t scanTick() const;  // main thread
+
     void items(std::vector<std::shared_ptr<FileItem>>&) const;
+    void updateWatches();  // not while updating
+
+    struct HotSpot
+    {
+        QString path;  // relative to the root
+        SubtreeStats stats;
+    };
+
+    /// The subtrees with the most items and the most scan time. Scan times
+    /// cover the directories enumerated since the start. Thread safe.
+    std::vector<HotSpot> hotSpots() const;
 
     const QStringList &nameFilters() const;
     const QStringList &mimeFilters() const;
@@ -33,6 +58,7 @@ public:
     uint8_t maxDepth() const;
     bool watchFileSystem() const;
     uint scanInterval() const;
+    bool useLocateDb() const;
 
     void setNameFilters(const QStringList&);
     void setMimeFilters(const QStringList&);
@@ -40,10 +66,12 @@ public:
     void setFollowSymlinks(bool);
     void setMaxDepth(uint8_t);
     void setWatchFilesystem(bool);
-    void setScanInterval(uint minutes);
+    void setScanInterval(uint minutes);  // of unchanged dirs, changing ones are verified more often
+    void setUseLocateDb(bool);  // served by the system locate database instead of scans
 
 private:
     void init();
+    void updateHotSpots(const std::unordered_map<const DirNode*, DirStats> &enumerated);
 
     QStringList name_filters;
     QStringList mime_filters;
@@ -51,15 +79,20 @@ private:
     bool index_hidden_files = false;
     bool follow_symlinks = false;
     bool watch_fs = false;
+    bool use_locate_db = false;
     bool force_update = false;
-    QTimer scan_interval_timer_;
+    uint16_t scan_tick_ = 0;  // main thread
+    QTimer scan_interval_timer_;  // ticks four times per scan interval
 
-    QFileSystemWatcher fs_watcher_;
+    filewatch::Subscription fs_watch_;
     std::shared_ptr<RootNode> root_;
     std::shared_ptr<FileItem> self;
+    std::unordered_map<const DirNode*, DirStats> dir_stats_;  // of the last enumeration
+    mutable std::mutex hot_spots_mutex_;
+    std::vector<HotSpot> hot_spots_;
 
 signals:
-    void updateRequired(FsIndexPath*);
+    void updateRequired(FsIndexPath*, bool scheduled = false);  // scheduled: due dirs only
 };
 
 
@@ -0,0 +1,139 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "fileitems.h"
+#include "indexerclient.h"
+#include "indexerprotocol.h"
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QMimeDatabase>
+#include <albert/logging.h>
+#include <albert/query.h>
+using namespace albert;
+using namespace indexer_protocol;
+using namespace std;
+
+static const int connect_timeout = 200;  // ms, the service is local
+static const int reply_timeout = 1000;  // ms, also bounds the wait for query results
+static const int poll_interval = 10;  // ms, to notice invalidation
+
+static bool connect(QLocalSocket &socket)
+{
+    socket.connectToServer(socketPath());
+    return socket.waitForConnected(connect_timeout);
+}
+
+static void send(QLocalSocket &socket, Message type, quint32 id, const function<void(QDataStream&)> &args = {})
+{
+    QByteArray payload;
+    QDataStream s(&payload, QIODevice::WriteOnly);
+    s.setVersion(stream_version);
+    s << (quint8)type << id;
+    if (args)
+        args(s);
+    writeFrame(socket, payload);
+    socket.flush();
+}
+
+// Waits for the Status reply, such that the request got processed before the connection closes
+static bool awaitStatus(QLocalSocket &socket)
+{
+    QByteArray buffer, payload;
+    while (!takeFrame(buffer, payload))
+    {
+        if (!socket.waitForReadyRead(reply_timeout))
+            return false;
+        buffer.append(socket.readAll());
+    }
+
+    QDataStream s(payload);
+    s.setVersion(stream_version);
+    quint8 type;
+    quint32 id;
+    QString text;
+    s >> type >> id >> text;
+    if ((Message)type != Message::Status)
+        return false;
+    DEBG << "File indexer service:" << text;
+    return true;
+}
+
+bool indexer_client::configure(const QJsonObject &config)
+{
+    QLocalSocket socket;
+    if (!connect(socket))
+        return false;
+    send(socket, Message::Configure, 0,
+         [&](QDataStream &s){ s << QJsonDocument(config).toJson(QJsonDocument::Compact); });
+    return awaitStatus(socket);
+}
+
+bool indexer_client::rescan()
+{
+    QLocalSocket socket;
+    if (!connect(socket))
+        return false;
+    send(socket, Message::Rescan, 0);
+    return awaitStatus(socket);
+}
+
+optional<vector<RankItem>> indexer_client::query(const Query *query, bool match_paths, quint32 max_results)
+{
+    vector<RankItem> results;
+
+    QLocalSocket socket;
+    if (!connect(socket))
+    {
+        WARN << "File indexer service not reachable:" << socket.errorString();
+        return nullopt;
+    }
+
+    const quint32 id = 1;  // one query per connection
+    send(socket, Message::Query, id,
+         [&](QDataStream &s){ s << query->string() << match_paths << max_results; });
+
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray buffer, payload;
+    while (!takeFrame(buffer, payload))
+    {
+        if (!query->isValid())
+        {
+            send(socket, Message::Cancel, id);
+            return results;
+        }
+        if (timer.elapsed() > reply_timeout)  // stalled or the reply got dropped
+        {
+            send(socket, Message::Cancel, id);
+            WARN << "File indexer service did not reply in time";
+            return nullopt;
+        }
+        if (socket.state() != QLocalSocket::ConnectedState && !socket.bytesAvailable())
+        {
+            WARN << "File indexer service disconnected";
+            return nullopt;
+        }
+        if (socket.waitForReadyRead(poll_interval) || socket.bytesAvailable())
+            buffer.append(socket.readAll());
+    }
+
+    QDataStream s(payload);
+    s.setVersion(stream_version);
+    quint8 type;
+    quint32 reply_id, count;
+    s >> type >> reply_id >> count;
+    if ((Message)type != Message::Results || reply_id != id)
+        return results;
+
+    QMimeDatabase mime_database;
+    results.reserve(count);
+    for (quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i)
+    {
+        QString path, mime_type;
+        float score;
+        s >> path >> mime_type >> score;
+        results.emplace_back(make_shared<StandardFile>(path, mime_database.mimeTypeForName(mime_type)),
+                             score);
+    }
+    return results;
+}
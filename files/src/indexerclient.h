@@ -0,0 +1,31 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QJsonObject>
+#include <albert/rankitem.h>
+#include <optional>
+#include <vector>
+namespace albert { class Query; }
+
+///
+/// Client of the file indexer service, see indexerprotocol.h.
+///
+/// Every call uses its own connection, hence the functions are thread-safe.
+/// Calls fail fast if the service is not running.
+///
+namespace indexer_client
+{
+
+/// Sends the index paths and their settings. Returns false if the service is unreachable.
+bool configure(const QJsonObject &config);
+
+/// Requests a rescan of all index paths. Returns false if the service is unreachable.
+bool rescan();
+
+/// Matches file names (and paths if `match_paths`) in the index of the service.
+/// Blocks until the results arrived. Cancels the remote query if `query`
+/// gets invalid. Returns nullopt if the service is unreachable, disconnected or
+/// does not reply in time.
+std::optional<std::vector<albert::RankItem>> query(const albert::Query *query, bool match_paths, quint32 max_results);
+
+}
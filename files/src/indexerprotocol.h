@@ -0,0 +1,85 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QDataStream>
+#include <QDir>
+#include <QIODevice>
+#include <QStandardPaths>
+
+///
+/// Wire format of the file indexer service (albert-files-indexer).
+///
+/// Frames are a quint32 payload size followed by the payload. Payloads are
+/// QDataStream encoded (Qt 6.0 format, big endian), starting with the message
+/// type and a request id chosen by the client:
+///
+///     Configure  json                               client > service
+///     Query      string, match_paths, max_results   client > service
+///     Cancel                                        client > service
+///     Rescan                                        client > service
+///     Results    count, (file path, mime type, score) × count
+///     Status     text                               service > client
+///
+/// Configure carries the index paths and their settings as compact JSON in the
+/// format of the files plugin config. Results answer the Query of the same id.
+/// Cancelled queries are not answered.
+///
+namespace indexer_protocol
+{
+
+enum class Message : quint8
+{
+    Configure = 1,
+    Query = 2,
+    Cancel = 3,
+    Rescan = 4,
+    Results = 0x81,
+    Status = 0x82
+};
+
+static constexpr quint32 max_frame_size = 64 * 1024 * 1024;
+
+inline QString socketPath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation))
+        .filePath(QStringLiteral("albert-files-indexer"));
+}
+
+static constexpr auto stream_version = QDataStream::Qt_6_0;
+
+inline void writeFrame(QIODevice &device, const QByteArray &payload)
+{
+    QByteArray frame;
+    QDataStream s(&frame, QIODevice::WriteOnly);
+    s.setVersion(stream_version);
+    s << (quint32)payload.size();
+    frame.append(payload);
+    device.write(frame);
+}
+
+/// Takes the next complete frame from `buffer`. Returns false if incomplete.
+/// Oversized frames are dropped along with the rest of the buffer.
+inline bool takeFrame(QByteArray &buffer, QByteArray &payload)
+{
+    if (buffer.size() < (qsizetype)sizeof(quint32))
+        return false;
+
+    quint32 size;
+    QDataStream s(buffer);
+    s.setVersion(stream_version);
+    s >> size;
+    if (size > max_frame_size)
+    {
+        buffer.clear();
+        return false;
+    }
+    if (buffer.size() < (qsizetype)(sizeof(quint32) + size))
+        return false;
+
+    payload = buffer.mid(sizeof(quint32), size);
+    buffer.remove(0, sizeof(quint32) + size);
+    return true;
+}
+
+}
@@ -0,0 +1,466 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "batchmatcher.h"
+#include "fileitems.h"
+#include "fsindexpath.h"
+#include "locatedb.h"
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <albert/logging.h>
+#include <albert/query.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+using namespace albert;
+using namespace std;
+
+namespace
+{
+
+const char mlocate_magic[8] = {'\0', 'm', 'l', 'o', 'c', 'a', 't', 'e'};
+const char plocate_magic[8] = {'\0', 'p', 'l', 'o', 'c', 'a', 't', 'e'};
+
+// mlocate: big endian, followed by the NUL terminated root path and the config block
+const size_t mlocate_header_size = 16;
+const size_t mlocate_dir_header_size = 16;
+enum MlocateEntry : uchar { MlocateFile = 0, MlocateDir = 1, MlocateEnd = 2 };
+
+// plocate: native endianness, see plocate db.h
+struct PlocateHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 hashtable_size;
+    quint32 extra_ht_slots;
+    quint32 num_docids;
+    quint64 hash_table_offset_bytes;
+    quint64 filename_index_offset_bytes;
+    // version >= 1
+    quint32 max_version;
+    quint32 zstd_dictionary_length_bytes;
+    quint64 zstd_dictionary_offset_bytes;
+};
+static_assert(offsetof(PlocateHeader, zstd_dictionary_offset_bytes) == 48);
+
+template<class T>
+T load(const uchar *p)
+{
+    T t;
+    memcpy(&t, p, sizeof(T));
+    return t;
+}
+
+quint32 loadBigEndian32(const uchar *p)
+{ return (quint32)p[0] << 24 | (quint32)p[1] << 16 | (quint32)p[2] << 8 | (quint32)p[3]; }
+
+// Joins dir and name of an entry
+void join(string_view dir, string_view name, string &path)
+{
+    path.assign(dir);
+    if (!path.empty() && path.back() != '/')
+        path.push_back('/');
+    path.append(name);
+}
+
+}
+
+
+LocateDb::LocateDb(const QString &path) : file_(path)
+{
+    if (!file_.open(QIODevice::ReadOnly))
+        return;
+
+    mtime_ = QFileInfo(file_).lastModified();
+    size_ = (size_t)file_.size();
+    if (size_ < sizeof(PlocateHeader) || !(data_ = file_.map(0, file_.size())))
+        return;
+
+    if (memcmp(data_, mlocate_magic, sizeof(mlocate_magic)) == 0)
+    {
+        const auto conf_size = loadBigEndian32(data_ + 8);
+        auto *root_end = (const uchar*)memchr(data_ + mlocate_header_size, 0, size_ - mlocate_header_size);
+        if (data_[12] != 0 || !root_end)  // version
+            return;
+
+        mlocate_dirs_offset_ = (size_t)(root_end - data_) + 1 + conf_size;
+        if (mlocate_dirs_offset_ <= size_)
+            format_ = Format::Mlocate;
+    }
+    else if (memcmp(data_, plocate_magic, sizeof(plocate_magic)) == 0)
+    {
+#ifdef HAVE_ZSTD
+        const auto header = load<PlocateHeader>(data_);
+        docid_count_ = header.num_docids;
+        filename_index_offset_ = header.filename_index_offset_bytes;
+        if (filename_index_offset_ > size_
+            || ((quint64)docid_count_ + 1) * sizeof(quint64) > size_ - filename_index_offset_)
+            return;
+
+        if (header.version >= 1 && header.zstd_dictionary_length_bytes > 0)
+        {
+            if (header.zstd_dictionary_offset_bytes > size_
+                || header.zstd_dictionary_length_bytes > size_ - header.zstd_dictionary_offset_bytes)
+                return;
+            ddict_ = ZSTD_createDDict(data_ + header.zstd_dictionary_offset_bytes,
+                                      header.zstd_dictionary_length_bytes);
+            if (!ddict_)
+                return;
+        }
+        format_ = Format::Plocate;
+#else
+        WARN << "plocate databases are not supported by this build:" << file_.fileName();
+#endif
+    }
+}
+
+LocateDb::~LocateDb()
+{
+#ifdef HAVE_ZSTD
+    ZSTD_freeDDict((ZSTD_DDict*)ddict_);
+#endif
+}
+
+bool LocateDb::isValid() const { return format_ != Format::Invalid; }
+
+LocateDb::Format LocateDb::format() const { return format_; }
+
+QString LocateDb::path() const { return file_.fileName(); }
+
+bool LocateDb::isOutdated() const { return QFileInfo(file_.fileName()).lastModified() != mtime_; }
+
+QStringList LocateDb::defaultPaths()
+{
+    if (auto path = qEnvironmentVariable("ALBERT_LOCATE_DB"); !path.isEmpty())
+        return {path};
+    return {
+#ifdef HAVE_ZSTD
+        QStringLiteral("/var/lib/plocate/plocate.db"),
+#endif
+        QStringLiteral("/var/lib/mlocate/mlocate.db")
+    };
+}
+
+void LocateDb::forEach(const function<bool(string_view, Kind)> &f) const
+{
+    string path;
+    forEachEntry([&](string_view dir, string_view name, Kind kind)
+    {
+        join(dir, name, path);
+        return f(path, kind);
+    });
+}
+
+void LocateDb::forEachEntry(const function<bool(string_view, string_view, Kind)> &f) const
+{
+    switch (format_)
+    {
+    case Format::Mlocate:
+        return forEachMlocate(f);
+    case Format::Plocate:
+        return forEachPlocate(f);
+    case Format::Invalid:
+        return;
+    }
+}
+
+string_view LocateDb::data() const { return string_view((const char*)data_, data_ ? size_ : 0); }
+
+void LocateDb::forEachMlocate(const function<bool(string_view, string_view, Kind)> &f) const
+{
+    // Takes the NUL terminated string at pos, false if corrupt
+    auto take = [this](size_t &pos, string_view &s)
+    {
+        auto *end = (const char*)memchr(data_ + pos, 0, size_ - pos);
+        if (!end)
+            return false;
+        s = string_view((const char*)data_ + pos, (size_t)(end - (const char*)data_) - pos);
+        pos += s.size() + 1;
+        return true;
+    };
+
+    string_view dir, name;
+    for (size_t pos = mlocate_dirs_offset_; pos + mlocate_dir_header_size < size_;)
+    {
+        pos += mlocate_dir_header_size;  // mtime
+        if (!take(pos, dir))
+            return;
+
+        while (pos < size_)
+        {
+            const auto type = data_[pos++];
+            if (type == MlocateEnd)
+                break;
+            if (type > MlocateEnd || pos >= size_ || !take(pos, name))
+                return;
+
+            if (!f(dir, name, type == MlocateDir ? Kind::Dir : Kind::File))
+                return;
+        }
+    }
+}
+
+void LocateDb::forEachPlocate(const function<bool(string_view, string_view, Kind)> &f) const
+{
+#ifdef HAVE_ZSTD
+    // The filename index holds the offsets of the compressed blocks, the last
+    // one marking the end. A block holds the NUL terminated paths of a docid.
+    auto *ctx = ZSTD_createDCtx();
+    string block;
+    const auto *offsets = data_ + filename_index_offset_;
+    for (quint32 docid = 0; docid < docid_count_; ++docid)
+    {
+        const auto begin = load<quint64>(offsets + docid * sizeof(quint64));
+        const auto end = load<quint64>(offsets + (docid + 1) * sizeof(quint64));
+        if (begin > end || end > size_)
+            break;
+
+        const auto content_size = ZSTD_getFrameContentSize(data_ + begin, end - begin);
+        if (content_size == ZSTD_CONTENTSIZE_ERROR || content_size == ZSTD_CONTENTSIZE_UNKNOWN)
+            break;
+        block.resize(content_size);
+
+        const auto size = ddict_
+            ? ZSTD_decompress_usingDDict(ctx, block.data(), block.size(),
+                                         data_ + begin, end - begin, (const ZSTD_DDict*)ddict_)
+            : ZSTD_decompressDCtx(ctx, block.data(), block.size(), data_ + begin, end - begin);
+        if (ZSTD_isError(size))
+        {
+            WARN << "Corrupt plocate block" << docid << ZSTD_getErrorName(size);
+            break;
+        }
+
+        string_view paths(block.data(), size);
+        for (size_t pos = 0, nul; (nul = paths.find('\0', pos)) != string_view::npos; pos = nul + 1)
+        {
+            if (nul == pos)
+                continue;
+            const auto path = paths.substr(pos, nul - pos);
+            const auto slash = path.rfind('/');
+            const auto dir = slash == string_view::npos ? string_view() : path.substr(0, max<size_t>(slash, 1));
+            if (!f(dir, path.substr(slash + 1), Kind::Unknown))  // npos + 1 == 0
+            {
+                ZSTD_freeDCtx(ctx);
+                return;
+            }
+        }
+    }
+    ZSTD_freeDCtx(ctx);
+#else
+    Q_UNUSED(f)
+#endif
+}
+
+
+LocateRoot::LocateRoot(const FsIndexPath &fsp):
+    prefix(fsp.path().toUtf8()),
+    max_depth(fsp.maxDepth()),
+    index_hidden(fsp.indexHidden())
+{
+    if (!prefix.endsWith('/'))
+        prefix.append('/');
+    for (const auto &pattern : fsp.nameFilters())
+        name_filters.emplace_back(pattern);
+    for (const auto &pattern : fsp.mimeFilters())
+        mime_filters.emplace_back(QRegularExpression::fromWildcard(pattern,
+                                                                   Qt::CaseSensitive,
+                                                                   QRegularExpression::UnanchoredWildcardConversion));
+}
+
+
+LocateSnapshot::LocateSnapshot(shared_ptr<const LocateDb> db, vector<LocateRoot> roots,
+                               const function<bool()> &abort):
+    db_(::move(db)),
+    roots_(::move(roots)),
+    mapped_(db_->format() == LocateDb::Format::Mlocate)
+{
+    if (roots_.size() > numeric_limits<decltype(Entry::root)>::max())
+        roots_.resize(numeric_limits<decltype(Entry::root)>::max());
+
+    // Offset of a string in the mapping, copied to strings_ if not mapped
+    const auto data = db_->data();
+    auto store = [&](string_view s) -> quint64
+    {
+        if (mapped_)
+            return (quint64)(s.data() - data.data());
+        strings_.append(s);
+        return strings_.size() - s.size();
+    };
+
+    string path;
+    size_t count = 0;
+    db_->forEachEntry([&](string_view dir, string_view name, LocateDb::Kind kind)
+    {
+        if ((++count & 0xffff) == 0 && abort && abort())
+            return false;
+
+        if (strings_.size() + dirs_.size() * sizeof(Dir) + entries_.size() * sizeof(Entry) > max_bytes)
+        {
+            truncated_ = true;
+            return false;
+        }
+
+        if (name.size() > numeric_limits<decltype(Entry::name_size)>::max())
+            return true;
+
+        join(dir, name, path);
+        auto root = find_if(roots_.begin(), roots_.end(), [&](const LocateRoot &r){
+            return path.size() > (size_t)r.prefix.size()
+                   && path.compare(0, r.prefix.size(), r.prefix.constData(), r.prefix.size()) == 0;
+        });
+        if (root == roots_.end())
+            return true;
+
+        // Hidden files and depth like the native indexer
+        const auto relative = string_view(path).substr(root->prefix.size());
+        if (!root->index_hidden && (relative.front() == '.' || relative.find("/.") != string_view::npos))
+            return true;
+        if (root->max_depth < 1 + (uint)std::count(relative.begin(), relative.end(), '/'))
+            return true;
+
+        // Name filters on the relative path
+        if (!root->name_filters.empty())
+        {
+            const auto relative_path = QString::fromUtf8(relative.data(), (qsizetype)relative.size());
+            auto exclude = false;
+            for (const auto &filter : root->name_filters)
+                if (((exclude && filter.type == PatternType::Include) || (!exclude && filter.type == PatternType::Exclude))
+                    && filter.regex.match(relative_path).hasMatch())
+                    exclude = !exclude;
+            if (exclude)
+                return true;
+        }
+
+        // Entries of a dir are consecutive
+        if (dirs_.empty() || view(dirs_.back().offset, dirs_.back().size) != dir)
+            dirs_.push_back({store(dir), (quint32)dir.size()});
+        entries_.push_back({store(name), (quint32)(dirs_.size() - 1),
+                            (decltype(Entry::root))(root - roots_.begin()),
+                            (decltype(Entry::name_size))name.size(), (quint8)kind});
+        return true;
+    });
+
+    strings_.shrink_to_fit();
+    dirs_.shrink_to_fit();
+    entries_.shrink_to_fit();
+}
+
+size_t LocateSnapshot::size() const { return entries_.size(); }
+
+size_t LocateSnapshot::bytes() const
+{ return strings_.capacity() + dirs_.capacity() * sizeof(Dir) + entries_.capacity() * sizeof(Entry); }
+
+bool LocateSnapshot::truncated() const { return truncated_; }
+
+string_view LocateSnapshot::view(quint64 offset, size_t size) const
+{ return (mapped_ ? db_->data() : string_view(strings_)).substr(offset, size); }
+
+void LocateSnapshot::filePath(const Entry &entry, string &path) const
+{
+    const auto &dir = dirs_[entry.dir];
+    join(view(dir.offset, dir.size), view(entry.name, entry.name_size), path);
+}
+
+vector<RankItem> LocateSnapshot::match(const Query *query, bool match_paths, uint max_results) const
+{
+    if (max_results == 0)
+        return {};
+
+    const batchmatch::BatchMatcher matcher(query->string());
+
+    // The ASCII words of the folded query. Reject entries not containing them
+    // before decoding and folding. Non ASCII entries are left to the matcher.
+    vector<string> words;
+    {
+        vector<char16_t> folded;
+        batchmatch::detail::fold(query->string(), folded);
+        for (size_t i = 0; i < folded.size();)
+        {
+            const auto j = (size_t)(find(folded.begin() + i + 1, folded.end(), u' ') - folded.begin());
+            if (all_of(folded.begin() + i + 1, folded.begin() + j, [](char16_t c){ return c < 0x80; }))
+                words.emplace_back(folded.begin() + i + 1, folded.begin() + j);
+            i = j;
+        }
+    }
+    string lowered;
+    auto mayMatch = [&](string_view text)
+    {
+        lowered.resize(text.size());
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            const auto c = (uchar)text[i];
+            if (c >= 0x80)
+                return true;
+            lowered[i] = (char)(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+        }
+        return all_of(words.begin(), words.end(),
+                      [&](const string &w){ return lowered.find(w) != string::npos; });
+    };
+
+    struct Match
+    {
+        float score;
+        QString path;
+        QMimeType mime;
+    };
+    vector<Match> best;  // min heap
+    auto worse = [](const Match &a, const Match &b){ return a.score > b.score; };
+
+    QMimeDatabase mime_database;
+    string path;
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        if ((i & 0x3ff) == 0x3ff && !query->isValid())
+            break;
+
+        const auto &entry = entries_[i];
+        const auto name = view(entry.name, entry.name_size);
+        if (!match_paths && !mayMatch(name))
+            continue;
+        filePath(entry, path);
+        if (match_paths && !mayMatch(path))
+            continue;
+
+        const auto file_path = QString::fromUtf8(path.data(), (qsizetype)path.size());
+        auto score = matcher.match(QString::fromUtf8(name.data(), (qsizetype)name.size()));
+        if (match_paths)
+            score = max(score, matcher.match(file_path));
+        if (score < 0 || (best.size() == max_results && score <= best.front().score))
+            continue;
+
+        // Mime types by extension, plocate entries are stat'ed only if that is inconclusive
+        QMimeType mime;
+        const auto kind = (LocateDb::Kind)entry.kind;
+        if (kind == LocateDb::Kind::Dir)
+            mime = DirNode::dirMimeType();
+        else
+        {
+            mime = mime_database.mimeTypeForFile(file_path, QMimeDatabase::MatchExtension);
+            if (kind == LocateDb::Kind::Unknown && mime.isDefault() && QFileInfo(file_path).isDir())
+                mime = DirNode::dirMimeType();
+        }
+        const auto &mime_filters = roots_[entry.root].mime_filters;
+        if (none_of(mime_filters.begin(), mime_filters.end(),
+                    [mt = mime.name()](const QRegularExpression &re){ return re.match(mt).hasMatch(); }))
+            continue;
+
+        if (best.size() == max_results)
+        {
+            pop_heap(best.begin(), best.end(), worse);
+            best.pop_back();
+        }
+        best.push_back({score, file_path, mime});
+        push_heap(best.begin(), best.end(), worse);
+    }
+
+    sort_heap(best.begin(), best.end(), worse);  // best first
+
+    vector<RankItem> results;
+    results.reserve(best.size());
+    for (auto &m : best)
+        results.emplace_back(make_shared<StandardFile>(m.path, m.mime), m.score);
+    return results;
+}
@@ -0,0 +1,169 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "fsindexnodes.h"
+#include <QDateTime>
+#include <QFile>
+#include <QRegularExpression>
+#include <QString>
+#include <albert/rankitem.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+class FsIndexPath;
+namespace albert { class Query; }
+
+///
+/// Read-only access to the databases of the system locate (updatedb).
+///
+/// The database is memory mapped and decoded lazily while iterating, i.e. an
+/// open database holds no heap memory and its pages are shared with the page
+/// cache. Supported are mlocate databases and, if built with zstd (HAVE_ZSTD),
+/// plocate databases. plocate lookups decompress the path blocks sequentially,
+/// the trigram posting lists are not used. Queries do not iterate the database,
+/// they match a LocateSnapshot.
+///
+/// The system databases are usually readable only by the mlocate/plocate
+/// group, i.e. the user has to be member of it.
+///
+class LocateDb
+{
+public:
+
+    enum class Format { Invalid, Mlocate, Plocate };
+    enum class Kind { File, Dir, Unknown };  // plocate does not store the kind
+
+    /// Maps the database at `path`, check isValid() before use
+    explicit LocateDb(const QString &path);
+    ~LocateDb();
+
+    bool isValid() const;
+    Format format() const;
+    QString path() const;
+
+    /// True if updatedb replaced the database since it was mapped
+    bool isOutdated() const;
+
+    /// Calls `f(path, kind)` with the UTF-8 path of every entry until f returns false.
+    /// Paths are valid for the duration of the call only. Thread-safe.
+    void forEach(const std::function<bool(std::string_view, Kind)> &f) const;
+
+    /// Calls `f(dir, name, kind)` for every entry until f returns false. `dir`
+    /// is the path of the parent dir, without trailing slash unless it is the
+    /// root. mlocate entries reference the mapped file, i.e. they are valid as
+    /// long as the database lives. plocate entries are valid for the duration
+    /// of the call only. Thread-safe.
+    void forEachEntry(const std::function<bool(std::string_view, std::string_view, Kind)> &f) const;
+
+    /// The mapped file
+    std::string_view data() const;
+
+    /// Database paths in the order of preference, ALBERT_LOCATE_DB if set
+    static QStringList defaultPaths();
+
+private:
+
+    void forEachMlocate(const std::function<bool(std::string_view, std::string_view, Kind)> &f) const;
+    void forEachPlocate(const std::function<bool(std::string_view, std::string_view, Kind)> &f) const;
+
+    QFile file_;
+    QDateTime mtime_;
+    const uchar *data_ = nullptr;
+    size_t size_ = 0;
+    Format format_ = Format::Invalid;
+
+    // mlocate
+    size_t mlocate_dirs_offset_ = 0;
+
+    // plocate
+    quint32 docid_count_ = 0;
+    quint64 filename_index_offset_ = 0;
+    void *ddict_ = nullptr;  // ZSTD_DDict, immutable, shared by the readers
+
+};
+
+
+///
+/// An index path served by a locate database, with the filters of the
+/// FsIndexPath applied at query time.
+///
+struct LocateRoot
+{
+    explicit LocateRoot(const FsIndexPath &fsp);
+
+    QByteArray prefix;  // UTF-8, with trailing slash
+    std::vector<NameFilter> name_filters;
+    std::vector<QRegularExpression> mime_filters;
+    uint max_depth;
+    bool index_hidden;
+};
+
+///
+/// The entries of a locate database below a set of roots, with the hidden,
+/// depth and name filters of the roots applied.
+///
+/// Iterating a database takes time linear in its size, plocate databases are
+/// decompressed on top. A snapshot is built once per database and roots, such
+/// that queries scan the entries of the served index paths only.
+///
+/// Entries of mlocate databases reference the names and dirs in the mapped
+/// database, the snapshot keeps it alive. plocate entries are compressed, their
+/// names and dirs are copied to the heap. Either way a snapshot is capped at
+/// max_bytes, entries beyond are dropped. Immutable, i.e. thread-safe.
+///
+class LocateSnapshot
+{
+public:
+
+    static constexpr size_t max_bytes = 128 << 20;
+
+    /// Iterates the database, stops early if `abort` returns true
+    LocateSnapshot(std::shared_ptr<const LocateDb> db, std::vector<LocateRoot> roots,
+                   const std::function<bool()> &abort = {});
+
+    size_t size() const;
+
+    /// Heap of the snapshot, the mapped database not included
+    size_t bytes() const;
+
+    /// True if entries got dropped because of max_bytes
+    bool truncated() const;
+
+    /// Matches the names (and paths if `match_paths`) against the query.
+    /// Returns the best `max_results`. Stops if the query gets invalid.
+    std::vector<albert::RankItem> match(const albert::Query *query,
+                                        bool match_paths,
+                                        uint max_results) const;
+
+private:
+
+    // Offsets are into the mapped database (mlocate) or strings_ (plocate)
+    struct Dir
+    {
+        quint64 offset;
+        quint32 size;
+    };
+
+    struct Entry
+    {
+        quint64 name;  // offset
+        quint32 dir;  // index in dirs_
+        quint16 root;  // index in roots_
+        quint8 name_size;
+        quint8 kind;  // LocateDb::Kind
+    };
+
+    std::string_view view(quint64 offset, size_t size) const;
+    void filePath(const Entry &entry, std::string &path) const;
+
+    std::shared_ptr<const LocateDb> db_;
+    std::vector<LocateRoot> roots_;
+    bool mapped_;
+    bool truncated_ = false;
+    std::string strings_;
+    std::vector<Dir> dirs_;
+    std::vector<Entry> entries_;
+
+};
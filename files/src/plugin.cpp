@@ -2,15 +2,23 @@
 
 #include "configwidget.h"
 #include "fileitems.h"
+#include "indexerclient.h"
+#include "memoryreport.h"
 #include "plugin.h"
+#include "trace.h"
 #include <QDir>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QSettings>
+#include <QtConcurrent>
 #include <albert/extensionregistry.h>
 #include <albert/logging.h>
+#include <albert/query.h>
 #include <albert/standarditem.h>
 #include <albert/util.h>
+#include <atomic>
+#include <numeric>
+#include <set>
 ALBERT_LOGGING_CATEGORY("files")
 using namespace albert;
 using namespace std;
@@ -34,8 +42,17 @@ const char* CFG_MAX_DEPTH = "maxDepth";
 const uint8_t DEF_MAX_DEPTH = 255;
 const char* CFG_SCAN_INTERVAL = "scanInterval";
 const uint DEF_SCAN_INTERVAL = 5;
+const char* CFG_USE_LOCATE_DB = "useLocateDb";
+const bool DEF_USE_LOCATE_DB = false;
 const char* INDEX_FILE_NAME = "file_index.json";
+const uint INDEXER_MAX_RESULTS = 500;
+const uint LOCATE_MAX_RESULTS = 500;
+const uint INFIX_MAX_RESULTS = 500;
+const uint THUMBNAIL_PREFETCH_COUNT = 16;
 applications::Plugin *apps;
+static atomic<ThumbnailCache*> thumbnails{nullptr};  // null if disabled, read by any thread
+
+ThumbnailCache *thumbnailCache() { return thumbnails.load(); }
 
 Plugin::Plugin():
     apps(registry(), "applications"),
@@ -53,12 +70,50 @@ Plugin::Plugin():
     connect(&fs_index_, &FsIndex::status, this, &Plugin::statusInfo);
     connect(&fs_index_, &FsIndex::updatedFinished, this, &Plugin::updateIndexItems);
     connect(this, &Plugin::index_file_path_changed, this, &Plugin::updateIndexItems);
+    connect(this, &Plugin::infix_matching_changed, this, &Plugin::updateIndexItems);
+
+    connect(&infix_builder_, &QFutureWatcher<shared_ptr<const InfixIndex>>::finished, this, [this]
+    {
+        {
+            lock_guard lock(infix_mutex_);
+            infix_index_ = infix_builder_.result();
+        }
+        publishMemory();
+        if (infix_pending_)
+        {
+            auto items = ::move(*infix_pending_);
+            infix_pending_.reset();
+            buildInfixIndex(::move(items));
+        }
+    });
+
+    auto s = settings();
+    restore_use_indexer_service(s);
+    restore_infix_matching(s);
+    restore_show_thumbnails(s);
+    restore_generate_thumbnails(s);
+
+    thumbnails = show_thumbnails() ? &thumbnail_cache_ : nullptr;
+    thumbnail_cache_.setGenerate(generate_thumbnails());
+    connect(this, &Plugin::show_thumbnails_changed, this,
+            [this](bool value){ thumbnails = value ? &thumbnail_cache_ : nullptr; });
+    connect(this, &Plugin::generate_thumbnails_changed, this,
+            [this](bool value){ thumbnail_cache_.setGenerate(value); });
+
+    // The service indexes, the local index paths just hold the settings.
+    // Updates are coalesced and sent as configuration.
+    remote_ = use_indexer_service();
+    fs_index_.setIndexingEnabled(!remote_);
+    indexer_config_timer_.setSingleShot(true);
+    indexer_config_timer_.setInterval(100);
+    connect(&indexer_config_timer_, &QTimer::timeout, this, &Plugin::configureIndexer);
+    connect(&fs_index_, &FsIndex::updateRequested,
+            &indexer_config_timer_, static_cast<void(QTimer::*)()>(&QTimer::start));
 
     QJsonObject object;
-    if (QFile file(createOrThrow(cacheLocation()).filePath(INDEX_FILE_NAME)); file.open(QIODevice::ReadOnly))
+    if (QFile file(createOrThrow(cacheLocation()).filePath(INDEX_FILE_NAME)); !remote_ && file.open(QIODevice::ReadOnly))
         object = QJsonDocument(QJsonDocument::fromJson(file.readAll())).object();
 
-    auto s = settings();
     restore_index_file_path(s);
     restore_fs_browsers_match_case_sensitive(s);
     restore_fs_browsers_show_hidden(s);
@@ -81,6 +136,7 @@ Plugin::Plugin():
         fsp->setMaxDepth(s->value(CFG_MAX_DEPTH, DEF_MAX_DEPTH).toUInt());
         fsp->setScanInterval(s->value(CFG_SCAN_INTERVAL, DEF_SCAN_INTERVAL).toUInt());
         fsp->setWatchFilesystem(s->value(CFG_FS_WATCHES, DEF_FS_WATCHES).toBool());
+        fsp->setUseLocateDb(s->value(CFG_USE_LOCATE_DB, DEF_USE_LOCATE_DB).toBool());
         s->endGroup();
 
         fs_index_.addPath(::move(fsp));
@@ -91,19 +147,30 @@ Plugin::Plugin():
         tr("Update index"),
         tr("Update the file index"),
         {":app_icon"},
-        {{"scan_files", tr("Scan"), [this](){ fs_index_.update(); }}}
+        {{"scan_files", tr("Scan"), [this](){
+            if (remote_)
+                indexer_client::rescan();
+            else
+                fs_index_.update();
+        }}}
     );
 
     registry().registerExtension(&homebrowser);
     registry().registerExtension(&rootbrowser);
+    registry().registerExtension(&content_search);
 }
 
 Plugin::~Plugin()
 {
     registry().deregisterExtension(&homebrowser);
     registry().deregisterExtension(&rootbrowser);
+    registry().deregisterExtension(&content_search);
+    thumbnails = nullptr;
 
     fs_index_.disconnect();
+    infix_builder_.disconnect();
+    infix_builder_.waitForFinished();
+    locate_builder_.waitForFinished();
 
     auto s = settings();
     QStringList paths;
@@ -118,11 +185,15 @@ Plugin::~Plugin()
         s->setValue(CFG_MAX_DEPTH, fsp->maxDepth());
         s->setValue(CFG_FS_WATCHES, fsp->watchFileSystem());
         s->setValue(CFG_SCAN_INTERVAL, fsp->scanInterval());
+        s->setValue(CFG_USE_LOCATE_DB, fsp->useLocateDb());
         s->endGroup();
         object.insert(path, fsp->serialize());
     }
     s->setValue(CFG_PATHS, paths);
 
+    if (remote_)
+        return;
+
     if (QFile file(QDir(cacheLocation()).filePath(INDEX_FILE_NAME)); file.open(QIODevice::WriteOnly)) {
         DEBG << "Storing file index to" << file.fileName();
         file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
@@ -133,22 +204,46 @@ Plugin::~Plugin()
 
 void Plugin::updateIndexItems()
 {
+    TRACE_SCOPE("files", "publish");
     vector<IndexItem> ii;
+    size_t file_count = 0;
+    size_t file_bytes = 0;
+    vector<shared_ptr<FileItem>> infix_items;
+    vector<shared_ptr<FileItem>> content_items;
 
-    // Get file items
-    for (auto &[path, fsp] : fs_index_.indexPaths())
-    {
-        vector<shared_ptr<FileItem>> items;
-        fsp->items(items);
-
-        // Create index items
-        for (auto &file_item : items)
+    // Get file items, served by the indexer service if remote
+    if (!remote_)
+        for (auto &[path, fsp] : fs_index_.indexPaths())
         {
-            ii.emplace_back(file_item, file_item->name());
-            if (index_file_path())
-                ii.emplace_back(file_item, file_item->filePath());
+            vector<shared_ptr<FileItem>> items;
+            fsp->items(items);
+            file_count += items.size();
+
+            // Create index items
+            for (auto &file_item : items)
+            {
+                file_bytes += sizeof(IndexFileItem) + memory::estimate(file_item->name());
+                ii.emplace_back(file_item, file_item->name());
+                if (index_file_path())
+                    ii.emplace_back(file_item, file_item->filePath());
+            }
+
+            if (infix_matching())
+                infix_items.insert(infix_items.end(), items.begin(), items.end());
+            content_items.insert(content_items.end(), items.begin(), items.end());
         }
+    content_search.setFiles(content_items);
+
+    // Paths served by the locate database, matched at query time
+    auto locate_roots = make_shared<vector<LocateRoot>>();
+    for (auto &[path, fsp] : fs_index_.indexPaths())
+        if (fsp->useLocateDb())
+            locate_roots->emplace_back(*fsp);
+    {
+        lock_guard lock(locate_mutex_);
+        locate_roots_ = ::move(locate_roots);
     }
+    locateSnapshot();  // build ahead of the queries
 
     // Add update item
     ii.emplace_back(update_item, update_item->text());
@@ -179,6 +274,13 @@ void Plugin::updateIndexItems()
     );
     ii.emplace_back(item, item->text());
 
+    memory_items_ = file_count;
+    memory_bytes_ = file_bytes + memory::estimateIndexItems(ii) + infix_items.size() * sizeof(shared_ptr<FileItem>);
+    publishMemory();
+
+    buildInfixIndex(::move(infix_items));
+
+    TRACE_SCOPE("files", "setIndexItems");
     setIndexItems(::move(ii));
 }
 
@@ -196,11 +298,240 @@ void Plugin::addPath(const QString &path)
     fsp->setMaxDepth(DEF_MAX_DEPTH);
     fsp->setScanInterval(DEF_SCAN_INTERVAL);
     fsp->setWatchFilesystem(DEF_FS_WATCHES);
+    fsp->setUseLocateDb(DEF_USE_LOCATE_DB);
     fs_index_.addPath(::move(fsp));
 }
 
 void Plugin::removePath(const QString &path)
 {
     fs_index_.removePath(path);
-    updateIndexItems();
+    if (remote_)
+        indexer_config_timer_.start();
+    else
+        updateIndexItems();
+}
+
+vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
+{
+    TRACE_SCOPE("query", "files");
+    auto results = IndexQueryHandler::handleGlobalQuery(query);
+    if (remote_)
+    {
+        if (auto remote_results = indexer_client::query(query, index_file_path(), INDEXER_MAX_RESULTS))
+            results.insert(results.end(),
+                           make_move_iterator(remote_results->begin()),
+                           make_move_iterator(remote_results->end()));
+        else if (remote_.exchange(false))  // the service went away
+            QMetaObject::invokeMethod(this, &Plugin::fallBackToLocalIndexing, Qt::QueuedConnection);
+    }
+    if (infix_matching())
+    {
+        auto infix_results = matchInfix(query, results);
+        results.insert(results.end(),
+                       make_move_iterator(infix_results.begin()),
+                       make_move_iterator(infix_results.end()));
+    }
+    if (auto snapshot = locateSnapshot())
+    {
+        auto locate_results = snapshot->match(query, index_file_path(), LOCATE_MAX_RESULTS);
+        results.insert(results.end(),
+                       make_move_iterator(locate_results.begin()),
+                       make_move_iterator(locate_results.end()));
+    }
+    if (show_thumbnails())
+        prefetchThumbnails(results);
+    return results;
+}
+
+void Plugin::prefetchThumbnails(const vector<RankItem> &results)
+{
+    // The best results are likely displayed, look their thumbnails up here
+    // rather than on the GUI thread when painting
+    vector<const RankItem*> best;
+    for (const auto &r : results)
+        best.push_back(&r);
+    auto end = best.begin() + (ptrdiff_t)min<size_t>(THUMBNAIL_PREFETCH_COUNT, best.size());
+    partial_sort(best.begin(), end, best.end(),
+                 [](const RankItem *a, const RankItem *b){ return a->score > b->score; });
+
+    for (auto it = best.begin(); it != end; ++it)
+        if (auto *file = dynamic_cast<const FileItem*>((*it)->item.get());
+            file && ThumbnailCache::hasThumbnails(file->mimeType()))
+            thumbnail_cache_.lookup(file->filePath());
+}
+
+shared_ptr<const LocateSnapshot> Plugin::locateSnapshot()
+{
+    lock_guard lock(locate_mutex_);
+    if (!locate_roots_ || locate_roots_->empty())
+    {
+        if (locate_snapshot_)
+        {
+            locate_snapshot_.reset();
+            QMetaObject::invokeMethod(this, &Plugin::publishMemory, Qt::QueuedConnection);
+        }
+        return {};
+    }
+
+    // Remapped if updatedb replaced the database
+    if (!locate_db_ || locate_db_->isOutdated())
+    {
+        locate_db_.reset();
+        for (const auto &path : LocateDb::defaultPaths())
+            if (auto db = make_shared<LocateDb>(path); db->isValid())
+            {
+                INFO << "Using locate database" << path;
+                locate_db_ = ::move(db);
+                locate_db_missing_reported_ = false;
+                break;
+            }
+
+        if (!locate_db_ && !locate_db_missing_reported_)
+        {
+            WARN << "No readable locate database:" << LocateDb::defaultPaths().join(", ");
+            locate_db_missing_reported_ = true;
+        }
+    }
+
+    // Rebuilt in the background if the database or the roots changed,
+    // queries match the previous snapshot meanwhile
+    if (locate_db_ && (locate_db_ != locate_snapshot_db_ || locate_roots_ != locate_snapshot_roots_)
+        && !locate_builder_.isRunning())
+    {
+        locate_snapshot_db_ = locate_db_;
+        locate_snapshot_roots_ = locate_roots_;
+        locate_builder_ = QtConcurrent::run([this, db = locate_db_, roots = locate_roots_]
+        {
+            TRACE_SCOPE("files", "locate snapshot");
+            auto snapshot = make_shared<const LocateSnapshot>(
+                db, *roots, [this, roots]{ lock_guard l(locate_mutex_); return roots != locate_roots_; });
+            DEBG << "Locate snapshot of" << db->path() << "holds" << snapshot->size() << "entries,"
+                 << memory::formatBytes(snapshot->bytes());
+            if (snapshot->truncated())
+                WARN << "Locate snapshot exceeds" << memory::formatBytes(LocateSnapshot::max_bytes)
+                     << "and misses entries. Serve smaller index paths from the locate database.";
+
+            {
+                lock_guard l(locate_mutex_);
+                if (roots != locate_roots_)  // outdated, rebuilt by the next query
+                    return;
+                locate_snapshot_ = ::move(snapshot);
+            }
+            QMetaObject::invokeMethod(this, &Plugin::publishMemory, Qt::QueuedConnection);
+        });
+    }
+
+    return locate_db_ ? locate_snapshot_ : nullptr;
+}
+
+void Plugin::publishMemory()
+{
+    auto items = memory_items_;
+    auto bytes = memory_bytes_;
+    if (lock_guard lock(infix_mutex_); infix_index_)
+        bytes += infix_index_->trigrams.bytes();
+    if (lock_guard lock(locate_mutex_); locate_snapshot_)
+    {
+        items += locate_snapshot_->size();
+        bytes += locate_snapshot_->bytes();
+    }
+    memory::publish(id(), items, bytes);
+}
+
+QJsonObject Plugin::indexerConfig() const
+{
+    QJsonObject config;
+    for (const auto &[path, fsp] : fs_index_.indexPaths())
+        config.insert(path, fsp->settings());
+    return config;
+}
+
+void Plugin::configureIndexer()
+{
+    if (!remote_)
+        return;
+
+    if (indexer_client::configure(indexerConfig()))
+    {
+        DEBG << "Configured the file indexer service";
+        updateIndexItems();
+        return;
+    }
+
+    remote_ = false;
+    fallBackToLocalIndexing();
+}
+
+void Plugin::fallBackToLocalIndexing()
+{
+    WARN << "File indexer service not reachable. Falling back to local indexing.";
+    fs_index_.setIndexingEnabled(true);
+    fs_index_.update();
+}
+
+void Plugin::buildInfixIndex(vector<shared_ptr<FileItem>> items)
+{
+    if (infix_builder_.isRunning())  // coalesce, build the latest items next
+    {
+        infix_pending_ = ::move(items);
+        return;
+    }
+
+    if (items.empty())
+    {
+        lock_guard lock(infix_mutex_);
+        infix_index_.reset();
+        return;
+    }
+
+    infix_builder_.setFuture(QtConcurrent::run([items = ::move(items)]() mutable
+    {
+        TRACE_SCOPE("files", "infix index");
+        auto index = make_shared<InfixIndex>();
+        index->trigrams = TrigramIndex(items.size(), [&](size_t i){ return items[i]->name(); });
+        index->items = ::move(items);
+        DEBG << "Built trigram index over" << index->items.size() << "names," << index->trigrams.trigramCount()
+             << "trigrams," << memory::formatBytes(index->trigrams.bytes());
+        return shared_ptr<const InfixIndex>(::move(index));
+    }));
+}
+
+vector<RankItem> Plugin::matchInfix(const Query *query, const vector<RankItem> &exclude)
+{
+    QStringList terms;
+    for (const auto &term : query->string().split(QChar::Space, Qt::SkipEmptyParts))
+        terms << TrigramIndex::fold(term);
+    if (!TrigramIndex::isSelective(terms))  // short queries are served by the word prefix index
+        return {};
+
+    shared_ptr<const InfixIndex> index;
+    {
+        lock_guard lock(infix_mutex_);
+        index = infix_index_;
+    }
+    if (!index)
+        return {};
+
+    set<const Item*> matched;
+    for (const auto &rank_item : exclude)
+        matched.insert(rank_item.item.get());
+
+    const auto term_length = accumulate(terms.begin(), terms.end(), qsizetype(0),
+                                        [](qsizetype n, const QString &t){ return n + t.size(); });
+
+    vector<RankItem> results;
+    for (const auto id : index->trigrams.candidates(terms))
+    {
+        if (results.size() == INFIX_MAX_RESULTS || !query->isValid())
+            break;
+
+        const auto &item = index->items[id];
+        if (matched.count(item.get()))
+            continue;
+
+        const auto name = item->name();
+        if (TrigramIndex::contains(name, terms))  // verify, trigrams may be apart
+            results.emplace_back(item, min(1.f, (float)term_length / (float)max(qsizetype(1), name.size())));
+    }
+    return results;
 }
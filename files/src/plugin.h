@@ -1,21 +1,35 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #pragma once
+#include "contentsearch.h"
 #include "filebrowsers.h"
 #include "fsindex.h"
+#include "locatedb.h"
+#include "thumbnailcache.h"
+#include "trigramindex.h"
+#include <QFutureWatcher>
+#include <QJsonObject>
 #include <QObject>
 #include <QSettings>
+#include <QTimer>
 #include <albert/extensionplugin.h>
 #include <albert/indexqueryhandler.h>
 #include <albert/plugin/applications.h>
 #include <albert/plugindependency.h>
 #include <albert/property.h>
+#include <atomic>
+#include <mutex>
+#include <optional>
 
 class Plugin : public albert::ExtensionPlugin,
                public albert::IndexQueryHandler
 {
     ALBERT_PLUGIN
     ALBERT_PLUGIN_PROPERTY(bool, index_file_path, false)
+    ALBERT_PLUGIN_PROPERTY(bool, use_indexer_service, false)
+    ALBERT_PLUGIN_PROPERTY(bool, infix_matching, true)
+    ALBERT_PLUGIN_PROPERTY(bool, show_thumbnails, true)
+    ALBERT_PLUGIN_PROPERTY(bool, generate_thumbnails, false)
     ALBERT_PLUGIN_PROPERTY(bool, fs_browsers_match_case_sensitive, true)
     ALBERT_PLUGIN_PROPERTY(bool, fs_browsers_show_hidden, true)
     ALBERT_PLUGIN_PROPERTY(bool, fs_browsers_sort_case_insensitive, true)
@@ -28,6 +42,7 @@ public:
 
     QWidget *buildConfigWidget() override;
     void updateIndexItems() override;
+    std::vector<albert::RankItem> handleGlobalQuery(const albert::Query*) override;
 
     const FsIndex &fsIndex();
     void addPath(const QString&);
@@ -35,11 +50,45 @@ public:
 
 private:
 
+    QJsonObject indexerConfig() const;
+    void configureIndexer();
+    void fallBackToLocalIndexing();
+    std::shared_ptr<const LocateSnapshot> locateSnapshot();
+    void publishMemory();  // of the index, the infix index and the locate snapshot
+
+    struct InfixIndex
+    {
+        std::vector<std::shared_ptr<FileItem>> items;
+        TrigramIndex trigrams;  // over the item names
+    };
+    void buildInfixIndex(std::vector<std::shared_ptr<FileItem>> items);
+    std::vector<albert::RankItem> matchInfix(const albert::Query*,
+                                             const std::vector<albert::RankItem> &exclude);
+    void prefetchThumbnails(const std::vector<albert::RankItem>&);
+
     albert::StrongDependency<applications::Plugin> apps;
     FsIndex fs_index_;
+    std::atomic<bool> remote_;  // indexing delegated to the indexer service, read by queries
+    QTimer indexer_config_timer_;
+    std::mutex locate_mutex_;
+    std::shared_ptr<const LocateDb> locate_db_;
+    std::shared_ptr<const std::vector<LocateRoot>> locate_roots_;  // rebuilt with the index items
+    std::shared_ptr<const LocateSnapshot> locate_snapshot_;
+    std::shared_ptr<const LocateDb> locate_snapshot_db_;  // the snapshot is built or being built of
+    std::shared_ptr<const std::vector<LocateRoot>> locate_snapshot_roots_;
+    QFuture<void> locate_builder_;
+    bool locate_db_missing_reported_ = false;
+    std::mutex infix_mutex_;
+    std::shared_ptr<const InfixIndex> infix_index_;
+    QFutureWatcher<std::shared_ptr<const InfixIndex>> infix_builder_;
+    std::optional<std::vector<std::shared_ptr<FileItem>>> infix_pending_;  // while building
+    size_t memory_items_ = 0;
+    size_t memory_bytes_ = 0;  // without the infix index and the locate snapshot
+    ThumbnailCache thumbnail_cache_;
     std::shared_ptr<albert::Item> update_item;
     HomeBrowser homebrowser;
     RootBrowser rootbrowser;
+    ContentSearch content_search;
 
 signals:
 
@@ -0,0 +1,215 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "statbatch.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sys/stat.h>
+#include <thread>
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace
+{
+
+void statThreaded(const vector<string> &paths, vector<int64_t> &mtimes, size_t begin)
+{
+    const size_t n = paths.size() - begin;
+    const size_t thread_count = min<size_t>(n / 256 + 1, clamp(thread::hardware_concurrency(), 1u, 8u));
+
+    atomic<size_t> next(begin);
+    auto work = [&]
+    {
+        struct stat st;
+        for (size_t i; (i = next.fetch_add(64)) < paths.size();)
+            for (size_t j = i; j < min(i + 64, paths.size()); ++j)
+                mtimes[j] = ::stat(paths[j].c_str(), &st) == 0 ? (int64_t)st.st_mtime : -1;
+    };
+
+    vector<thread> threads;
+    for (size_t t = 1; t < thread_count; ++t)
+        threads.emplace_back(work);
+    work();
+    for (auto &t : threads)
+        t.join();
+}
+
+#if defined(__linux__) && defined(IORING_FEAT_FAST_POLL)
+
+// Minimal io_uring, submits statx in batches of the queue depth
+class Ring
+{
+public:
+
+    static constexpr unsigned depth = 256;
+
+    Ring()
+    {
+        io_uring_params p{};
+        fd_ = (int)syscall(__NR_io_uring_setup, depth, &p);
+        if (fd_ < 0)
+            return;
+
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap)
+            sq_size_ = cq_size_ = max(sq_size_, cq_size_);
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+
+        sq_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        cq_ = single_mmap ? sq_ : mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        sqes_ = (io_uring_sqe*)mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sq_ == MAP_FAILED || cq_ == MAP_FAILED || sqes_ == MAP_FAILED)
+            return;
+
+        auto *sq = (char*)sq_;
+        sq_tail_ = (unsigned*)(sq + p.sq_off.tail);
+        sq_mask_ = *(unsigned*)(sq + p.sq_off.ring_mask);
+        sq_array_ = (unsigned*)(sq + p.sq_off.array);
+        auto *cq = (char*)cq_;
+        cq_head_ = (unsigned*)(cq + p.cq_off.head);
+        cq_tail_ = (unsigned*)(cq + p.cq_off.tail);
+        cq_mask_ = *(unsigned*)(cq + p.cq_off.ring_mask);
+        cqes_ = (io_uring_cqe*)(cq + p.cq_off.cqes);
+        entries_ = p.sq_entries;
+        valid_ = true;
+    }
+
+    ~Ring()
+    {
+        if (sqes_ && sqes_ != MAP_FAILED)
+            munmap(sqes_, sqes_size_);
+        if (cq_ && cq_ != MAP_FAILED && cq_ != sq_)
+            munmap(cq_, cq_size_);
+        if (sq_ && sq_ != MAP_FAILED)
+            munmap(sq_, sq_size_);
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    bool isValid() const { return valid_; }
+
+    /// Stats paths [begin, end), at most entries(). False if the ring failed,
+    /// e.g. statx is not supported, in which case the range has to be retried.
+    bool stat(const vector<string> &paths, size_t begin, size_t end, vector<int64_t> &mtimes)
+    {
+        const auto n = (unsigned)(end - begin);
+        auto tail = *sq_tail_;
+        for (unsigned i = 0; i < n; ++i, ++tail)
+        {
+            const auto index = tail & sq_mask_;
+            auto &sqe = sqes_[index];
+            sqe = {};
+            sqe.opcode = IORING_OP_STATX;
+            sqe.fd = AT_FDCWD;
+            sqe.addr = (unsigned long)paths[begin + i].c_str();
+            sqe.len = STATX_MTIME;
+            sqe.off = (unsigned long)&buffers_[i];
+            sqe.user_data = i;
+            sq_array_[index] = index;
+        }
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+        for (unsigned submitted = 0; submitted < n;)
+        {
+            const auto r = (int)syscall(__NR_io_uring_enter, fd_, n - submitted, n - submitted,
+                                        IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (r < 0 && errno != EINTR)
+                return valid_ = false;
+            if (r > 0)
+                submitted += (unsigned)r;
+        }
+
+        bool unsupported = false;
+        for (unsigned completed = 0; completed < n;)
+        {
+            auto head = *cq_head_;
+            const auto cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            if (head == cq_tail)
+            {
+                if (syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+                    return valid_ = false;
+                continue;
+            }
+            for (; head != cq_tail; ++head, ++completed)
+            {
+                const auto &cqe = cqes_[head & cq_mask_];
+                const auto i = (unsigned)cqe.user_data;
+                if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP)
+                    unsupported = true;
+                mtimes[begin + i] = cqe.res < 0 ? -1 : (int64_t)buffers_[i].stx_mtime.tv_sec;
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        }
+
+        return valid_ = !unsupported;
+    }
+
+    unsigned entries() const { return min(entries_, depth); }
+
+private:
+
+    int fd_ = -1;
+    bool valid_ = false;
+    void *sq_ = nullptr;
+    void *cq_ = nullptr;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sq_size_ = 0, cq_size_ = 0, sqes_size_ = 0;
+    unsigned *sq_tail_ = nullptr, *sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned *cq_head_ = nullptr, *cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+    unsigned entries_ = 0;
+    struct statx buffers_[depth];
+
+};
+
+#endif
+
+}
+
+vector<int64_t> statbatch::mtimes(const vector<string> &paths, Backend *backend)
+{
+    vector<int64_t> mtimes(paths.size(), -1);
+
+#if defined(__linux__) && defined(IORING_FEAT_FAST_POLL)
+    const auto *forced = getenv("ALBERT_FILES_STAT_BACKEND");
+    if (auto ring = forced && strcmp(forced, "threads") == 0 ? nullptr : make_unique<Ring>();
+        ring && ring->isValid())
+    {
+        size_t i = 0;
+        for (; i < paths.size() && ring->isValid(); i += ring->entries())
+            if (!ring->stat(paths, i, min(paths.size(), i + ring->entries()), mtimes))
+                break;
+
+        if (i >= paths.size())
+        {
+            if (backend)
+                *backend = Backend::IoUring;
+            return mtimes;
+        }
+
+        // The ring failed, stat the rest
+        if (backend)
+            *backend = Backend::Threads;
+        statThreaded(paths, mtimes, i);
+        return mtimes;
+    }
+#endif
+
+    if (backend)
+        *backend = Backend::Threads;
+    statThreaded(paths, mtimes, 0);
+    return mtimes;
+}
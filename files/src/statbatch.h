@@ -0,0 +1,26 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///
+/// Batched stat of many paths.
+///
+/// On Linux the requests are submitted as statx operations through an
+/// io_uring (raw syscalls, no liburing), i.e. one syscall per batch instead of
+/// one per path, and the kernel may complete them in parallel. Where io_uring
+/// is unavailable (old kernels, seccomp filters, other platforms) the paths are
+/// stat'ed by a few threads. ALBERT_FILES_STAT_BACKEND=threads forces the latter.
+///
+namespace statbatch
+{
+
+enum class Backend { IoUring, Threads };
+
+/// Modification times in seconds since epoch, -1 for paths that can not be
+/// stat'ed. Symlinks are followed. Reports the backend used if `backend` is set.
+std::vector<int64_t> mtimes(const std::vector<std::string> &paths, Backend *backend = nullptr);
+
+}
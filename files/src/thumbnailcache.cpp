@@ -0,0 +1,178 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "thumbnailcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QMimeType>
+#include <QSaveFile>
+#include <QUrl>
+using namespace std;
+
+static const auto max_age = chrono::minutes(5);
+static const qsizetype max_entries = 4096;
+static const qsizetype max_pending = 64;
+static const qint64 max_image_bytes = 32 << 20;
+static const qint64 max_image_pixels = 64 << 20;
+static const int normal_size = 128;
+
+static const QString &thumbnailDir()
+{
+    static const QString dir = [] {
+        auto cache = qEnvironmentVariable("XDG_CACHE_HOME");
+        if (cache.isEmpty())
+            cache = QDir::home().filePath(".cache");
+        return cache + "/thumbnails";
+    }();
+    return dir;
+}
+
+static QByteArray fileUri(const QString &file_path)
+{ return QUrl::fromLocalFile(file_path).toEncoded(); }
+
+static QString thumbnailName(const QByteArray &uri)
+{ return QString::fromLatin1(QCryptographicHash::hash(uri, QCryptographicHash::Md5).toHex()) + ".png"; }
+
+
+ThumbnailCache::ThumbnailCache()
+{ pool_.setMaxThreadCount(1); }
+
+ThumbnailCache::~ThumbnailCache()
+{
+    pool_.clear();
+    pool_.waitForDone();
+}
+
+optional<QString> ThumbnailCache::find(const QString &file_path)
+{
+    lock_guard lock(mutex_);
+
+    optional<QString> thumbnail;
+    if (auto it = entries_.constFind(file_path); it != entries_.cend())
+    {
+        thumbnail = it->thumbnail;
+        if (chrono::steady_clock::now() - it->checked < max_age)
+            return thumbnail;
+    }
+
+    // Unknown or outdated
+    if (!pending_.contains(file_path) && pending_.size() < max_pending)
+    {
+        pending_.insert(file_path);
+        pool_.start([this, file_path]
+        {
+            auto t = resolve(file_path);
+            if (t.isEmpty() && generating())
+                t = generate(file_path);
+            store(file_path, t);
+        });
+    }
+
+    return thumbnail;
+}
+
+QString ThumbnailCache::lookup(const QString &file_path)
+{
+    {
+        lock_guard lock(mutex_);
+        if (auto it = entries_.constFind(file_path);
+            it != entries_.cend() && chrono::steady_clock::now() - it->checked < max_age)
+            return it->thumbnail;
+    }
+
+    // Missing thumbnails are left to find(), which generates in the background
+    auto thumbnail = resolve(file_path);
+    if (!thumbnail.isEmpty() || !generating())
+        store(file_path, thumbnail);
+    return thumbnail;
+}
+
+void ThumbnailCache::setGenerate(bool value)
+{
+    lock_guard lock(mutex_);
+    generate_ = value;
+    entries_.clear();  // retry the missing ones
+}
+
+bool ThumbnailCache::generating()
+{
+    lock_guard lock(mutex_);
+    return generate_;
+}
+
+bool ThumbnailCache::hasThumbnails(const QMimeType &mime_type)
+{
+    const auto name = mime_type.name();
+    return name.startsWith(QStringLiteral("image/"))
+           || name.startsWith(QStringLiteral("video/"))
+           || name == QStringLiteral("application/pdf")
+           || name.startsWith(QStringLiteral("application/vnd.oasis.opendocument."));
+}
+
+void ThumbnailCache::store(const QString &file_path, const QString &thumbnail)
+{
+    lock_guard lock(mutex_);
+    if (entries_.size() >= max_entries)
+        entries_.clear();
+    entries_.insert(file_path, {thumbnail, chrono::steady_clock::now()});
+    pending_.remove(file_path);
+}
+
+QString ThumbnailCache::resolve(const QString &file_path)
+{
+    const QFileInfo file_info(file_path);
+    if (!file_info.isFile())
+        return {};
+
+    const auto mtime = QString::number(file_info.lastModified().toSecsSinceEpoch());
+    const auto name = thumbnailName(fileUri(file_path));
+    for (const auto *size : {"normal", "large", "x-large", "xx-large"})
+    {
+        const auto path = QString("%1/%2/%3").arg(thumbnailDir(), QLatin1String(size), name);
+        if (QImageReader reader(path, "png"); reader.canRead() && reader.text("Thumb::MTime") == mtime)
+            return path;
+    }
+    return {};
+}
+
+QString ThumbnailCache::generate(const QString &file_path)
+{
+    const QFileInfo file_info(file_path);
+    if (file_info.size() > max_image_bytes)
+        return {};
+
+    QImageReader reader(file_path);
+    const auto size = reader.size();
+    if (!reader.canRead() || size.isEmpty() || (qint64)size.width() * size.height() > max_image_pixels)
+        return {};
+
+    reader.setAutoTransform(true);
+    if (size.width() > normal_size || size.height() > normal_size)
+        reader.setScaledSize(size.scaled(normal_size, normal_size, Qt::KeepAspectRatio));
+
+    auto image = reader.read();
+    if (image.isNull())
+        return {};
+
+    const auto uri = fileUri(file_path);
+    image.setText("Thumb::URI", QString::fromUtf8(uri));
+    image.setText("Thumb::MTime", QString::number(file_info.lastModified().toSecsSinceEpoch()));
+    image.setText("Software", "Albert");
+
+    const auto dir = thumbnailDir() + "/normal";
+    if (!QFileInfo::exists(dir))
+    {
+        if (!QDir().mkpath(dir))
+            return {};
+        QFile::setPermissions(dir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+    }
+
+    QSaveFile file(QString("%1/%2").arg(dir, thumbnailName(uri)));
+    if (!file.open(QIODevice::WriteOnly) || !image.save(&file, "PNG") || !file.commit())
+        return {};
+    QFile::setPermissions(file.fileName(), QFile::ReadOwner | QFile::WriteOwner);
+    return file.fileName();
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <chrono>
+#include <mutex>
+#include <optional>
+class QMimeType;
+
+///
+/// Thumbnails of the freedesktop thumbnail cache.
+///
+/// Thumbnails are looked up by the MD5 of the file URI and are valid if their
+/// Thumb::MTime matches the modification time of the file. Lookups read files
+/// and therefore run on a background thread or the calling worker thread,
+/// find() only returns what is cached. Optionally missing thumbnails of
+/// images are generated on a single background thread, the number of pending
+/// jobs and the size of the images are capped.
+///
+/// https://specifications.freedesktop.org/thumbnail-spec/latest/
+///
+class ThumbnailCache
+{
+public:
+
+    ThumbnailCache();
+    ~ThumbnailCache();
+
+    /// The cached thumbnail path, empty if there is none. Schedules a lookup
+    /// if unknown. Does not block, i.e. suitable for the GUI thread.
+    std::optional<QString> find(const QString &file_path);
+
+    /// Looks the thumbnail up synchronously and caches the result
+    QString lookup(const QString &file_path);
+
+    void setGenerate(bool);
+
+    /// True for mime types file managers commonly thumbnail
+    static bool hasThumbnails(const QMimeType&);
+
+private:
+
+    bool generating();
+    void store(const QString &file_path, const QString &thumbnail);
+    static QString resolve(const QString &file_path);
+    static QString generate(const QString &file_path);
+
+    struct Entry
+    {
+        QString thumbnail;  // empty if none
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    std::mutex mutex_;
+    QHash<QString, Entry> entries_;
+    QSet<QString> pending_;  // queued lookups
+    bool generate_ = false;
+    QThreadPool pool_;
+
+};
@@ -0,0 +1,216 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "trigramindex.h"
+#include <algorithm>
+#include <unordered_map>
+using namespace std;
+
+static const quint32 block_size = 128;
+
+static inline quint64 trigram(const QChar *c)
+{ return (quint64)c[0].unicode() << 32 | (quint64)c[1].unicode() << 16 | c[2].unicode(); }
+
+static inline void appendVarint(vector<uchar> &out, quint32 v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((uchar)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uchar)v);
+}
+
+static inline quint32 readVarint(const uchar *&p)
+{
+    quint32 v = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        const auto b = *p++;
+        v |= (quint32)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+}
+
+
+// Decodes a posting list sequentially, jumps blocks to seek
+class TrigramIndex::Cursor
+{
+public:
+
+    Cursor(const TrigramIndex &index, const Entry &entry) :
+        skips_(index.skips_.data() + entry.skip),
+        data_(index.data_.data()),
+        count_(entry.count)
+    { jump(0); }
+
+    quint32 id() const { return id_; }
+
+    bool next()
+    {
+        if (pos_ == count_)
+            return false;
+        id_ += readVarint(p_);  // the base of a block is the last id of the previous one
+        ++pos_;
+        return true;
+    }
+
+    /// Advances to the first id >= target, false if there is none
+    bool seek(quint32 target)
+    {
+        if (pos_ > 0 && id_ >= target)
+            return true;
+
+        // Last block whose base is smaller than the target
+        const quint32 blocks = (count_ + block_size - 1) / block_size;
+        const auto *it = partition_point(skips_ + 1, skips_ + blocks,
+                                         [target](const Skip &s){ return s.base < target; });
+        if (const auto block = (quint32)(it - skips_) - 1; block * block_size > pos_)
+            jump(block);
+
+        while (next())
+            if (id_ >= target)
+                return true;
+        return false;
+    }
+
+private:
+
+    void jump(quint32 block)
+    {
+        pos_ = block * block_size;
+        p_ = data_ + skips_[block].offset;
+        id_ = skips_[block].base;
+    }
+
+    const Skip *skips_;
+    const uchar *data_;
+    const uchar *p_;
+    const quint32 count_;
+    quint32 pos_;
+    quint32 id_;
+
+};
+
+
+TrigramIndex::TrigramIndex(size_t count, const function<QString(size_t)> &string)
+{
+    struct List
+    {
+        vector<uchar> data;
+        vector<Skip> skips;
+        quint32 count = 0;
+        quint32 last = 0;
+    };
+    unordered_map<quint64, List> lists;
+
+    vector<quint64> keys;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto s = fold(string(i));
+        keys.clear();
+        for (qsizetype j = 0; j + 3 <= s.size(); ++j)
+            keys.push_back(trigram(s.constData() + j));
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+        for (const auto key : keys)
+        {
+            auto &l = lists[key];
+            if (l.count % block_size == 0)
+                l.skips.push_back({l.last, (quint32)l.data.size()});
+            appendVarint(l.data, (quint32)i - l.last);  // the first id of a list is relative to 0
+            l.last = (quint32)i;
+            ++l.count;
+        }
+    }
+
+    // Flatten, ordered by trigram
+    entries_.reserve(lists.size());
+    size_t data_size = 0, skip_count = 0;
+    for (const auto &[key, l] : lists)
+    {
+        entries_.push_back({key, l.count, 0});
+        data_size += l.data.size();
+        skip_count += l.skips.size();
+    }
+    sort(entries_.begin(), entries_.end(), [](const Entry &a, const Entry &b){ return a.key < b.key; });
+
+    data_.reserve(data_size);
+    skips_.reserve(skip_count);
+    for (auto &e : entries_)
+    {
+        auto &l = lists[e.key];
+        e.skip = (quint32)skips_.size();
+        for (const auto &s : l.skips)
+            skips_.push_back({s.base, (quint32)(s.offset + data_.size())});
+        data_.insert(data_.end(), l.data.begin(), l.data.end());
+        l = {};
+    }
+}
+
+const TrigramIndex::Entry *TrigramIndex::find(quint64 key) const
+{
+    auto it = lower_bound(entries_.begin(), entries_.end(), key,
+                          [](const Entry &e, quint64 k){ return e.key < k; });
+    return it != entries_.end() && it->key == key ? &*it : nullptr;
+}
+
+vector<quint32> TrigramIndex::candidates(const QStringList &terms) const
+{
+    vector<const Entry*> lists;
+    for (const auto &term : terms)
+        for (qsizetype j = 0; j + 3 <= term.size(); ++j)
+        {
+            const auto *e = find(trigram(term.constData() + j));
+            if (!e)
+                return {};
+            lists.push_back(e);
+        }
+    if (lists.empty())
+        return {};
+
+    sort(lists.begin(), lists.end(), [](const Entry *a, const Entry *b){ return a->count < b->count; });
+    lists.erase(unique(lists.begin(), lists.end()), lists.end());
+
+    vector<quint32> ids;
+    ids.reserve(lists.front()->count);
+    for (Cursor c(*this, *lists.front()); c.next();)
+        ids.push_back(c.id());
+
+    for (auto it = lists.begin() + 1; it != lists.end() && !ids.empty(); ++it)
+    {
+        Cursor c(*this, **it);
+        size_t kept = 0;
+        for (const auto id : ids)
+        {
+            if (!c.seek(id))
+                break;
+            if (c.id() == id)
+                ids[kept++] = id;
+        }
+        ids.resize(kept);
+    }
+
+    return ids;
+}
+
+bool TrigramIndex::isSelective(const QStringList &terms)
+{ return any_of(terms.begin(), terms.end(), [](const QString &t){ return t.size() >= 3; }); }
+
+QString TrigramIndex::fold(const QString &s) { return s.toCaseFolded(); }
+
+bool TrigramIndex::contains(const QString &s, const QStringList &terms)
+{
+    const auto folded = fold(s);
+    return all_of(terms.begin(), terms.end(), [&](const QString &t){ return folded.contains(t); });
+}
+
+size_t TrigramIndex::trigramCount() const { return entries_.size(); }
+
+size_t TrigramIndex::bytes() const
+{
+    return entries_.capacity() * sizeof(Entry)
+           + skips_.capacity() * sizeof(Skip)
+           + data_.capacity();
+}
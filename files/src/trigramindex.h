@@ -0,0 +1,75 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <vector>
+
+///
+/// Trigram index for infix (substring) queries over many strings.
+///
+/// Maps the trigrams (three UTF-16 code units) of the case folded strings to
+/// posting lists of string ids. Posting lists are delta encoded varints in
+/// blocks of 128 ids, each block referenced by a skip entry holding the id
+/// preceding it. Lists are intersected smallest first, seeking the larger
+/// lists block wise, i.e. the cost depends on the smallest list rather than on
+/// the number of strings.
+///
+/// The index yields candidates only, i.e. strings containing all trigrams of
+/// the terms. Callers verify candidates, e.g. using contains(). Terms shorter
+/// than three code units have no trigrams and do not constrain the candidates.
+///
+/// Immutable after construction, i.e. can be shared across threads.
+///
+class TrigramIndex
+{
+public:
+
+    TrigramIndex() = default;
+
+    /// Indexes `count` strings, `string(i)` returns the string of id i
+    TrigramIndex(size_t count, const std::function<QString(size_t)> &string);
+
+    /// Ids of the strings containing the trigrams of all `terms`, in
+    /// ascending order. Terms have to be folded (see fold()).
+    std::vector<quint32> candidates(const QStringList &terms) const;
+
+    /// True if one of the terms has trigrams, i.e. candidates() is selective
+    static bool isSelective(const QStringList &terms);
+
+    /// Case folding used for strings and terms
+    static QString fold(const QString &s);
+
+    /// True if the folded `s` contains all `terms`
+    static bool contains(const QString &s, const QStringList &terms);
+
+    size_t trigramCount() const;
+
+    /// Heap held, for memory reports
+    size_t bytes() const;
+
+private:
+
+    struct Entry
+    {
+        quint64 key;
+        quint32 count;  // ids
+        quint32 skip;  // index of the first skip entry
+    };
+
+    struct Skip
+    {
+        quint32 base;  // id preceding the block, deltas are relative to it
+        quint32 offset;  // of the block in data_
+    };
+
+    class Cursor;
+
+    const Entry *find(quint64 key) const;
+
+    std::vector<Entry> entries_;  // sorted by key
+    std::vector<Skip> skips_;
+    std::vector<uchar> data_;
+
+};
@@ -1,11 +1,25 @@
 //// Copyright (c) 2022-2024 Manuel Schneider
 
+#include "contentsearch.h"
 #include "fileitems.h"
 #include "fsindex.h"
+#include "fsindexnodes.h"
 #include "fsindexpath.h"
+#include "locatedb.h"
+#include "statbatch.h"
 #include "test.h"
+#include "thumbnailcache.h"
+#include "trigramindex.h"
+#include <QDir>
 #include <QFile>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QThread>
+#include <QUrl>
 #include <QTemporaryDir>
+#include <optional>
 using namespace std;
 
 
@@ -178,3 +192,287 @@ void FilesTests::fs_index()
     fsp->items(items);
     QCOMPARE(items.size(),  4);
 }
+
+void FilesTests::locate_db()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+
+    // mlocate: magic, conf size (BE), version, visibility, padding, root, conf,
+    // then per dir: 16 byte header, path, entries (type, name), end marker
+    QByteArray db("\0mlocate", 8);
+    db.append("\0\0\0\4\0\1\0\0", 8);
+    db.append("/\0", 2);
+    db.append("conf", 4);
+    auto dir = [&](const QByteArray &path, const vector<pair<char, QByteArray>> &entries)
+    {
+        db.append(QByteArray(16, '\0'));
+        db.append(path + '\0');
+        for (const auto &[type, name] : entries)
+            db.append(type).append(name + '\0');
+        db.append('\2');
+    };
+    dir("/", {{1, "home"}, {0, "vmlinuz"}});
+    dir("/home", {{0, "a.txt"}, {1, "b"}});
+    dir("/home/b", {});
+
+    QFile file(root.filePath("mlocate.db"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(db);
+    file.close();
+
+    vector<pair<string, LocateDb::Kind>> entries;
+    auto collect = [&](string_view path, LocateDb::Kind kind)
+    {
+        entries.emplace_back(path, kind);
+        return true;
+    };
+
+    auto locate_db = make_shared<const LocateDb>(file.fileName());
+    QVERIFY(locate_db->isValid());
+    QCOMPARE(locate_db->format(), LocateDb::Format::Mlocate);
+    QVERIFY(!locate_db->isOutdated());
+    locate_db->forEach(collect);
+    QCOMPARE(entries.size(), 4);
+    QVERIFY(entries[0].first == "/home");
+    QVERIFY(entries[0].second == LocateDb::Kind::Dir);
+    QVERIFY(entries[1].first == "/vmlinuz");
+    QVERIFY(entries[1].second == LocateDb::Kind::File);
+    QVERIFY(entries[2].first == "/home/a.txt");
+    QVERIFY(entries[3].first == "/home/b");
+
+    // Snapshots hold the entries below the roots only
+    FsIndexPath fsp("/home");
+    fsp.setMimeFilters({"*"});
+    LocateSnapshot snapshot(locate_db, {LocateRoot(fsp)});
+    QCOMPARE(snapshot.size(), size_t(2));
+    QVERIFY(!snapshot.truncated());
+    fsp.setNameFilters({"^b$"});
+    QCOMPARE(LocateSnapshot(locate_db, {LocateRoot(fsp)}).size(), size_t(1));
+
+    // Stops at corrupt data
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(db.left(db.indexOf("a.txt") + 2));
+    file.close();
+    entries.clear();
+    LocateDb(file.fileName()).forEach(collect);
+    QCOMPARE(entries.size(), 2);
+
+    // Not a locate database
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(64, 'x'));
+    file.close();
+    QVERIFY(!LocateDb(file.fileName()).isValid());
+}
+
+void FilesTests::trigram_index()
+{
+    // Enough strings for multi block posting lists
+    QStringList names;
+    for (int i = 0; i < 1000; ++i)
+        names << QString("%1_%2.%3").arg(i % 3 ? "Report" : "notes").arg(i).arg(i % 2 ? "txt" : "pdf");
+
+    TrigramIndex index(names.size(), [&](size_t i){ return names[i]; });
+
+    auto brute_force = [&](const QStringList &terms)
+    {
+        vector<quint32> ids;
+        for (int i = 0; i < names.size(); ++i)
+            if (TrigramIndex::contains(names[i], terms))
+                ids.push_back(i);
+        return ids;
+    };
+
+    auto verified = [&](const QStringList &terms)
+    {
+        vector<quint32> ids;
+        for (auto id : index.candidates(terms))
+            if (TrigramIndex::contains(names[id], terms))
+                ids.push_back(id);
+        return ids;
+    };
+
+    for (const QStringList &terms : {QStringList{"port"}, QStringList{"ort_99"}, QStringList{"rep", ".txt"},
+                                     QStringList{"notes_12"}, QStringList{"es_", "pdf", "7"}})
+        QVERIFY(verified(terms) == brute_force(terms));
+
+    QVERIFY(index.candidates({"xyz"}).empty());
+    QVERIFY(index.candidates({"report"}).size() == brute_force({"report"}).size());  // folded
+    QVERIFY(!TrigramIndex::isSelective({"ab", "c"}));
+    QVERIFY(TrigramIndex::isSelective({"ab", "cde"}));
+}
+
+void FilesTests::stat_batch()
+{
+    QTemporaryDir dir;
+    QDir(dir.path()).mkpath("a/b");
+
+    vector<string> paths;
+    for (const auto &p : {dir.path(), dir.path() + "/a", dir.path() + "/a/b", dir.path() + "/missing"})
+        paths.emplace_back(QFile::encodeName(p).toStdString());
+
+    for (const char *forced : {"", "threads"})
+    {
+        qputenv("ALBERT_FILES_STAT_BACKEND", forced);
+        const auto mtimes = statbatch::mtimes(paths);
+        QVERIFY(mtimes.size() == paths.size());
+        for (size_t i = 0; i < 3; ++i)
+            QVERIFY(mtimes[i] == QFileInfo(QFile::decodeName(paths[i])).lastModified().toSecsSinceEpoch());
+        QVERIFY(mtimes[3] == -1);
+    }
+    qunsetenv("ALBERT_FILES_STAT_BACKEND");
+}
+
+void FilesTests::scan_schedule()
+{
+    QTemporaryDir dir;
+    QDir(dir.path()).mkpath("a");
+
+    auto root = RootNode::make(dir.path());
+    shared_ptr<DirNode> node = root;
+    function<void(const QString&)> status = [](const QString&){};
+
+    IndexSettings s;
+    s.root_path = dir.path();
+    s.max_depth = 255;
+    s.index_hidden_files = false;
+    s.follow_symlinks = false;
+    s.forced = false;
+
+    auto update = [&](uint16_t tick, const unordered_map<const DirNode*, int64_t> *mtimes, bool scheduled)
+    {
+        s.tick = tick;
+        s.mtimes = mtimes;
+        s.scheduled = scheduled;
+        set<QString> indexed_dirs;
+        node->update(node, false, status, s, indexed_dirs, 1);
+    };
+
+    // New dirs are due after the default interval of four ticks
+    update(0, nullptr, false);
+    QVERIFY(root->overdue(0) == -4);
+
+    // Unchanged dirs double their interval
+    const unordered_map<const DirNode*, int64_t> mtimes{
+        {root.get(), QFileInfo(dir.path()).lastModified().toSecsSinceEpoch()}};
+    update(4, &mtimes, true);
+    QVERIFY(root->overdue(4) == -8);
+    update(12, &mtimes, true);
+    QVERIFY(root->overdue(12) == -16);
+
+    // Dirs not in a scheduled batch are not verified
+    const unordered_map<const DirNode*, int64_t> none;
+    update(20, &none, true);
+    QVERIFY(root->overdue(20) == -8);
+}
+
+void FilesTests::hot_spots()
+{
+    QTemporaryDir root;
+    QDir dir(root.path());
+    QVERIFY(dir.mkdir("a"));
+    QVERIFY(dir.mkdir("b"));
+
+    auto createFile = [](const QString &path)
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+        file.write("test");
+    };
+    for (int i = 0; i < 20; ++i)
+        createFile(root.filePath(QString("a/%1.txt").arg(i)));
+    createFile(root.filePath("b/foo.txt"));
+    createFile(root.filePath("b/noext"));
+
+    FsIndexPath p(root.path());
+    p.setMimeFilters({"text/plain"});
+    p.update(false, [](const QString&){});
+
+    auto hotSpot = [&](const QString &path)
+    {
+        const auto hot_spots = p.hotSpots();
+        auto it = find_if(hot_spots.begin(), hot_spots.end(), [&](const auto &h){ return h.path == path; });
+        return it == hot_spots.end() ? optional<SubtreeStats>() : it->stats;
+    };
+
+    QVERIFY(p.hotSpots().size() == 2);
+    QVERIFY(hotSpot("a") && hotSpot("a")->items == 20 && hotSpot("a")->entries == 20 && hotSpot("a")->mime_reads == 0);
+    QVERIFY(hotSpot("b") && hotSpot("b")->items == 2 && hotSpot("b")->entries == 2 && hotSpot("b")->mime_reads == 1);
+
+    p.setNameFilters({"^a$"});
+    p.update(false, [](const QString&){});
+    QVERIFY(!hotSpot("a") && hotSpot("b"));
+}
+
+void FilesTests::content_matcher()
+{
+    const QByteArray text = "first line\n  Second Line with Foo\nthird foo_bar line\n";
+    auto match = [&](const QString &pattern){ return ContentMatcher(pattern).firstMatch(text.constData(), text.size()); };
+
+    // Literals, smart case
+    QVERIFY(match("foo") && match("foo")->number == 2 && match("foo")->text == "Second Line with Foo");
+    QVERIFY(match("Foo") && match("Foo")->number == 2);
+    QVERIFY(match("foo_") && match("foo_")->number == 3);
+    QVERIFY(!match("FOO"));
+
+    // Regular expressions
+    QVERIFY(match("/fo+_b.r/") && match("/fo+_b.r/")->number == 3);
+    QVERIFY(match("/^third/") && match("/^third/")->number == 3);
+    QVERIFY(!match("/^foo/"));
+
+    QVERIFY(!ContentMatcher("").isValid());
+    QVERIFY(!ContentMatcher("/(/").isValid());
+
+    QVERIFY(ContentMatcher::requiredLiteral("ab?cde+f") == "cde");
+    QVERIFY(ContentMatcher::requiredLiteral("foo(bar)?baz[0-9]{2}") == "foo");
+    QVERIFY(ContentMatcher::requiredLiteral("[abc]{12}x") == "x");
+    QVERIFY(ContentMatcher::requiredLiteral("foo|bar").isEmpty());
+}
+
+void FilesTests::thumbnail_cache()
+{
+    QTemporaryDir dir;
+    qputenv("XDG_CACHE_HOME", dir.path().toUtf8());
+    QVERIFY(QDir(dir.path()).mkpath("thumbnails/normal"));
+
+    auto thumbnailPath = [&](const QString &file_path)
+    {
+        const auto uri = QUrl::fromLocalFile(file_path).toEncoded();
+        return QString("%1/thumbnails/normal/%2.png")
+            .arg(dir.path(), QCryptographicHash::hash(uri, QCryptographicHash::Md5).toHex());
+    };
+
+    QImage image(300, 200, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    const auto valid = dir.filePath("valid.png");
+    const auto outdated = dir.filePath("outdated.png");
+    const auto missing = dir.filePath("missing.png");
+    for (const auto &path : {valid, outdated, missing})
+        QVERIFY(image.save(path));
+
+    auto writeThumbnail = [&](const QString &path, qint64 mtime)
+    {
+        QImage thumbnail = image.scaled(128, 85);
+        thumbnail.setText("Thumb::MTime", QString::number(mtime));
+        QVERIFY(thumbnail.save(thumbnailPath(path)));
+    };
+    writeThumbnail(valid, QFileInfo(valid).lastModified().toSecsSinceEpoch());
+    writeThumbnail(outdated, QFileInfo(outdated).lastModified().toSecsSinceEpoch() - 1);
+
+    ThumbnailCache cache;
+    QVERIFY(cache.lookup(valid) == thumbnailPath(valid));
+    QVERIFY(cache.find(valid) == thumbnailPath(valid));
+    QVERIFY(cache.lookup(outdated).isEmpty());
+    QVERIFY(cache.lookup(missing).isEmpty());
+
+    // Generated in the background
+    cache.setGenerate(true);
+    QVERIFY(!cache.find(missing));
+    for (int i = 0; i < 500 && cache.find(missing).value_or(QString()).isEmpty(); ++i)
+        QThread::msleep(10);
+    QVERIFY(cache.find(missing) == thumbnailPath(missing));
+
+    QImageReader reader(thumbnailPath(missing));
+    QVERIFY(reader.size() == QSize(128, 85));
+    QVERIFY(reader.text("Thumb::MTime") == QString::number(QFileInfo(missing).lastModified().toSecsSinceEpoch()));
+}
@@ -10,5 +10,12 @@ private slots:
 
     void fs_index_path();
     void fs_index();
+    void locate_db();
+    void trigram_index();
+    void stat_batch();
+    void scan_schedule();
+    void hot_spots();
+    void content_matcher();
+    void thumbnail_cache();
 
 };
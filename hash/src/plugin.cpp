@@ -3,6 +3,7 @@
 #include <albert/util.h>
 #include <albert/standarditem.h>
 #include "plugin.h"
+#include "trace.h"
 #include <QCoreApplication>
 #include <QCryptographicHash>
 #include <QMetaEnum>
@@ -44,6 +45,7 @@ static shared_ptr<Item> buildItem(int algo_index, const QString& string_to_hash)
 
 vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 {
+    TRACE_SCOPE("query", "hash");
     vector<RankItem> results;
     for (int i = 0; i < algo_count; ++i){
         auto prefix = QString("%1 ").arg(QMetaEnum::fromType<QCryptographicHash::Algorithm>().key(i)).toLower();
@@ -57,6 +59,7 @@ vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 
 void Plugin::handleTriggerQuery(Query *query)
 {
+    TRACE_SCOPE("query", "hash");
     for (int i = 0; i < algo_count; ++i)
         query->add(buildItem(i, query->string()));
 }
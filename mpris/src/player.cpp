@@ -0,0 +1,133 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "player.h"
+#include <QDBusArgument>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <albert/logging.h>
+using namespace std;
+
+static const int dbus_timeout = 100;
+static const char *dbus_object_path = "/org/mpris/MediaPlayer2";
+static const char *dbus_properties_interface = "org.freedesktop.DBus.Properties";
+static const char *mpris_interface = "org.mpris.MediaPlayer2";
+static const char *mpris_player_interface = "org.mpris.MediaPlayer2.Player";
+
+// Nested containers arrive as QDBusArgument
+static QVariantMap toMap(const QVariant &v)
+{
+    if (v.canConvert<QDBusArgument>())
+        return qdbus_cast<QVariantMap>(v.value<QDBusArgument>());
+    return v.toMap();
+}
+
+Player::Player(const QString &service_name, const QDBusConnection &session_bus):
+    service_(service_name),
+    bus_(session_bus),
+    player_(service_, dbus_object_path, bus_),
+    control_(service_, dbus_object_path, bus_)
+{
+    player_.setTimeout(dbus_timeout);
+    control_.setTimeout(dbus_timeout);
+
+    if (!bus_.connect(service_, dbus_object_path, dbus_properties_interface,
+                      QStringLiteral("PropertiesChanged"), this,
+                      SLOT(onPropertiesChanged(QString,QVariantMap,QStringList))))
+        WARN << "Failed to connect to PropertiesChanged of" << service_;
+
+    fetch(mpris_interface);
+    fetch(mpris_player_interface);
+}
+
+const QString &Player::service() const { return service_; }
+
+Player::State Player::state() const
+{
+    lock_guard lock(mutex_);
+    return state_;
+}
+
+void Player::fetch(const QString &interface)
+{
+    auto msg = QDBusMessage::createMethodCall(service_, dbus_object_path,
+                                              dbus_properties_interface,
+                                              QStringLiteral("GetAll"));
+    msg << interface;
+
+    auto *watcher = new QDBusPendingCallWatcher(bus_.asyncCall(msg), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, [this, interface](QDBusPendingCallWatcher *w)
+    {
+        w->deleteLater();
+        if (QDBusPendingReply<QVariantMap> reply = *w; reply.isError())
+            WARN << "Failed fetching properties of" << service_ << reply.error().message();
+        else
+            apply(interface, reply.value());
+    });
+}
+
+void Player::apply(const QString &interface, const QVariantMap &p)
+{
+    lock_guard lock(mutex_);
+
+    if (interface == mpris_interface)
+    {
+        for (auto it = p.begin(); it != p.end(); ++it)
+            if (it.key() == QStringLiteral("Identity"))
+                state_.identity = it.value().toString();
+            else if (it.key() == QStringLiteral("DesktopEntry"))
+                state_.desktop_entry = it.value().toString();
+            else if (it.key() == QStringLiteral("CanQuit"))
+                state_.can_quit = it.value().toBool();
+            else if (it.key() == QStringLiteral("CanRaise"))
+                state_.can_raise = it.value().toBool();
+    }
+    else if (interface == mpris_player_interface)
+    {
+        for (auto it = p.begin(); it != p.end(); ++it)
+            if (it.key() == QStringLiteral("PlaybackStatus"))
+                state_.playback_status = it.value().toString();
+            else if (it.key() == QStringLiteral("Metadata"))
+                state_.metadata = toMap(it.value());
+            else if (it.key() == QStringLiteral("CanControl"))
+                state_.can_control = it.value().toBool();
+            else if (it.key() == QStringLiteral("CanPlay"))
+                state_.can_play = it.value().toBool();
+            else if (it.key() == QStringLiteral("CanPause"))
+                state_.can_pause = it.value().toBool();
+            else if (it.key() == QStringLiteral("CanGoNext"))
+                state_.can_go_next = it.value().toBool();
+            else if (it.key() == QStringLiteral("CanGoPrevious"))
+                state_.can_go_previous = it.value().toBool();
+
+        state_.valid = true;
+    }
+}
+
+void Player::onPropertiesChanged(const QString &interface,
+                                 const QVariantMap &changed,
+                                 const QStringList &invalidated)
+{
+    apply(interface, changed);
+
+    // Invalidated properties come without values
+    if (!invalidated.isEmpty())
+        fetch(interface);
+}
+
+// Generated methods return pending replies, i.e. they do not block
+
+void Player::play() { control_.Play(); }
+
+void Player::pause() { control_.Pause(); }
+
+void Player::stop() { control_.Stop(); }
+
+void Player::next() { control_.Next(); }
+
+void Player::previous() { control_.Previous(); }
+
+void Player::raise() { player_.Raise(); }
+
+void Player::quit() { player_.Quit(); }
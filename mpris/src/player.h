@@ -0,0 +1,72 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "mpris.h"
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+#include <mutex>
+
+///
+/// Local mirror of the state of a MPRIS media player.
+///
+/// Populated asynchronously once using `GetAll` and kept up to date by
+/// `org.freedesktop.DBus.Properties.PropertiesChanged`. Reading the state never
+/// blocks on the player. Control calls are asynchronous.
+///
+class Player : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    struct State
+    {
+        bool valid = false;  // received the initial state
+        QString identity;
+        QString desktop_entry;
+        QString playback_status;
+        QVariantMap metadata;
+        bool can_quit = false;
+        bool can_raise = false;
+        bool can_control = false;
+        bool can_play = false;
+        bool can_pause = false;
+        bool can_go_next = false;
+        bool can_go_previous = false;
+    };
+
+    Player(const QString &service_name, const QDBusConnection &session_bus);
+
+    const QString &service() const;
+
+    /// Thread-safe copy of the current state
+    State state() const;
+
+    void play();
+    void pause();
+    void stop();
+    void next();
+    void previous();
+    void raise();
+    void quit();
+
+private slots:
+
+    void onPropertiesChanged(const QString &interface,
+                             const QVariantMap &changed,
+                             const QStringList &invalidated);
+
+private:
+
+    void fetch(const QString &interface);
+    void apply(const QString &interface, const QVariantMap &properties);
+
+    const QString service_;
+    QDBusConnection bus_;
+    OrgMprisMediaPlayer2Interface player_;
+    OrgMprisMediaPlayer2PlayerInterface control_;
+    mutable std::mutex mutex_;
+    State state_;
+
+};
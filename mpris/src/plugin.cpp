@@ -1,184 +1,166 @@
 // Copyright (c) 2017-2024 Manuel Schneider
 
-#include "mpris.h"
+#include "batchmatcher.h"
+#include "player.h"
 #include "plugin.h"
+#include "trace.h"
 #include "ui_configwidget.h"
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QDBusMetaType>
 #include <QDBusServiceWatcher>
+#include <QDir>
+#include <QFileInfo>
+#include <QUrl>
 #include <albert/logging.h>
-#include <albert/matcher.h>
 #include <albert/standarditem.h>
+#include <shared_mutex>
 ALBERT_LOGGING_CATEGORY("mpris")
 using namespace albert;
 using namespace std;
-using MediaPlayer2Interface = OrgMprisMediaPlayer2Interface;
-using MediaPlayer2PlayerInterface = OrgMprisMediaPlayer2PlayerInterface;
 
-static const int dbus_timeout = 100;
-static const char * dbus_object_path = "/org/mpris/MediaPlayer2";
 
-class Player
+static void addItems(vector<RankItem>& items, const shared_ptr<Player> &player,
+                     const batchmatch::BatchMatcher &matcher)
 {
-    const QString dbus_service_name;
-    OrgMprisMediaPlayer2Interface player;
-    MediaPlayer2PlayerInterface control;
-    QString id;
-
-public:
-
-    Player(const QString &service_name,const QDBusConnection &session_bus):
-        dbus_service_name(service_name),
-        player(dbus_service_name, dbus_object_path, session_bus),
-        control(dbus_service_name, dbus_object_path, session_bus),
-        id(player.identity())
+    // Reads the local mirror only, the player is never called while handling queries
+    const auto s = player->state();
+    if (!s.valid || !s.can_control)
+        return;
+
+    static const QString tr_raise = Plugin::tr("Raise");
+    static const QString tr_quit = Plugin::tr("Quit");
+    static const QString tr_play = Plugin::tr("Play");
+    static const QString tr_pause = Plugin::tr("Pause");
+    static const QString tr_stop = Plugin::tr("Stop");
+    static const QString tr_next = Plugin::tr("Next");
+    static const QString tr_prev = Plugin::tr("Previous");
+
+    enum Control { Next, Previous, Stop, Pause, Play };
+    static const batchmatch::Candidates controls = []
     {
-        player.setTimeout(dbus_timeout);
-        control.setTimeout(dbus_timeout);
-
-        // TODO: it makes no sense to proceed here without dynamic items
-        // notes: qdbusxml2cpp created files are still low level. calls are sync there are no
-        // signals emitted for changed properties. this has to be done manually. also since qobject
-        // does not support multiple inheritance the way to go is probably another level on top
-        // facading all the dbus interfaces below.
-        // Helpful: QDBUS_DEBUG=1
-    }
-
-    inline shared_ptr<Item>
-    makeCtlItem(const QString &cmd, const QStringList &icon_urls, function<void()> &&action)
-    { return StandardItem::make(cmd, cmd, id, icon_urls, {{ cmd, cmd, ::move(action)}}); }
-
-    void addItems(vector<RankItem>& items, const QString &query)
-    {
-        if (!control.canControl())
-            return;
-
-        static const QString tr_raise = Plugin::tr("Raise");
-        static const QString tr_quit = Plugin::tr("Quit");
-        static const QString tr_play = Plugin::tr("Play");
-        static const QString tr_pause = Plugin::tr("Pause");
-        static const QString tr_stop = Plugin::tr("Stop");
-        static const QString tr_next = Plugin::tr("Next");
-        static const QString tr_prev = Plugin::tr("Previous");
-
-        static const QStringList iu_play = {"xdg:media-playback-start"};
-        static const QStringList iu_pause = {"xdg:media-playback-pause"};
-        static const QStringList iu_stop = {"xdg:media-playback-stop"};
-        static const QStringList iu_next = {"xdg:media-skip-forward"};
-        static const QStringList iu_prev = {"xdg:media-skip-backward"};
-        static const QStringList iu_player = {"xdg:multimedia-player"};
-
-        static const auto act_play = [this]{ control.Play(); };
-        static const auto act_pause = [this]{ control.Pause(); };
-        static const auto act_stop = [this]{ control.Stop(); };
-        static const auto act_next = [this]{ control.Next(); };
-        static const auto act_prev = [this]{ control.Previous(); };
-
-        enum PlaybackStatus { Playing, Paused, Stopped };
-        static const QString playback_status_strings[] = {
-            Plugin::tr("Playing"),
-            Plugin::tr("Paused"),
-            Plugin::tr("Stopped")
-        };
-
-        PlaybackStatus playback_status = Stopped;
-        if (control.playbackStatus() == QStringLiteral("Playing"))
-            playback_status = Playing;
-        else if (control.playbackStatus() == QStringLiteral("Paused"))
-            playback_status = Paused;
-        else if (control.playbackStatus() == QStringLiteral("Stopped"))
-            playback_status = Stopped;
-        else
-            WARN << "Invalid playback status received:" << control.playbackStatus();
-
+        batchmatch::Candidates c;
+        for (const auto *s : {&tr_next, &tr_prev, &tr_stop, &tr_pause, &tr_play})
+            c.add(*s);
+        return c;
+    }();
+
+    static const QStringList iu_play = {"xdg:media-playback-start"};
+    static const QStringList iu_pause = {"xdg:media-playback-pause"};
+    static const QStringList iu_stop = {"xdg:media-playback-stop"};
+    static const QStringList iu_next = {"xdg:media-skip-forward"};
+    static const QStringList iu_prev = {"xdg:media-skip-backward"};
+    static const QStringList iu_player = {"xdg:multimedia-player"};
+
+    // Items may outlive the player
+    const weak_ptr<Player> w = player;
+    const auto act_play = [w]{ if (auto p = w.lock()) p->play(); };
+    const auto act_pause = [w]{ if (auto p = w.lock()) p->pause(); };
+    const auto act_stop = [w]{ if (auto p = w.lock()) p->stop(); };
+    const auto act_next = [w]{ if (auto p = w.lock()) p->next(); };
+    const auto act_prev = [w]{ if (auto p = w.lock()) p->previous(); };
+
+    const auto &id = s.identity.isEmpty() ? player->service() : s.identity;
+    auto makeCtlItem = [&id](const QString &cmd, const QStringList &icon_urls, function<void()> &&action)
+    { return StandardItem::make(cmd, cmd, id, icon_urls, {{ cmd, cmd, ::move(action)}}); };
+
+    enum PlaybackStatus { Playing, Paused, Stopped };
+    static const QString playback_status_strings[] = {
+        Plugin::tr("Playing"),
+        Plugin::tr("Paused"),
+        Plugin::tr("Stopped")
+    };
 
-        Matcher matcher(query);
-        Match m;
+    PlaybackStatus playback_status = Stopped;
+    if (s.playback_status == QStringLiteral("Playing"))
+        playback_status = Playing;
+    else if (s.playback_status == QStringLiteral("Paused"))
+        playback_status = Paused;
+    else if (s.playback_status != QStringLiteral("Stopped"))
+        DEBG << "Invalid playback status received:" << s.playback_status;
 
-        // Player item
 
-        if (m = matcher.match(id); m)
-        {
-            vector<Action> actions;
+    float m;
 
-            if (player.canRaise())
-                actions.emplace_back(tr_raise, tr_raise, [this]{ player.Raise(); });
+    // Player item
 
-            if (playback_status == Playing)
-            {
-                if (control.canPause())
-                    actions.emplace_back(tr_pause, tr_pause, act_pause);
+    if (m = matcher.match(id); m >= 0)
+    {
+        vector<Action> actions;
 
-                actions.emplace_back(tr_stop, tr_stop, act_stop);
-            }
-            else
-                if (control.canPlay())
-                    actions.emplace_back(tr_play, tr_play, act_play);
+        if (s.can_raise)
+            actions.emplace_back(tr_raise, tr_raise, [w]{ if (auto p = w.lock()) p->raise(); });
 
-            if (control.canGoNext())
-                actions.emplace_back(tr_next, tr_next, act_next);
+        if (playback_status == Playing)
+        {
+            if (s.can_pause)
+                actions.emplace_back(tr_pause, tr_pause, act_pause);
 
-            if (control.canGoPrevious())
-                actions.emplace_back(tr_prev, tr_prev, act_prev);
+            actions.emplace_back(tr_stop, tr_stop, act_stop);
+        }
+        else
+            if (s.can_play)
+                actions.emplace_back(tr_play, tr_play, act_play);
 
-            if (player.canQuit())
-                actions.emplace_back(tr_quit, tr_quit, [this]{ player.Quit(); });
+        if (s.can_go_next)
+            actions.emplace_back(tr_next, tr_next, act_next);
 
-            QStringList icon_urls;
-            if (auto de = player.desktopEntry(); !de.isEmpty())
-                icon_urls << QString("xdg:%1").arg(de);
-            icon_urls << iu_player;
+        if (s.can_go_previous)
+            actions.emplace_back(tr_prev, tr_prev, act_prev);
 
-            // https://www.freedesktop.org/wiki/Specifications/mpris-spec/metadata/
+        if (s.can_quit)
+            actions.emplace_back(tr_quit, tr_quit, [w]{ if (auto p = w.lock()) p->quit(); });
 
-            auto md = control.metadata();
-            CRIT << md;
-            QStringList sl;
+        QStringList icon_urls;
+        if (!s.desktop_entry.isEmpty())
+            icon_urls << QString("xdg:%1").arg(s.desktop_entry);
+        icon_urls << iu_player;
 
-            sl << playback_status_strings[playback_status];
+        // https://www.freedesktop.org/wiki/Specifications/mpris-spec/metadata/
 
-            // TODO: Dynamic items
+        const auto &md = s.metadata;
+        QStringList sl;
 
-            if (auto it1 = md.find("xesam:title"), it2 = md.find("xesam:artist");
-                it1 != md.end() && it2 != md.end() && it1->canConvert<QString>() && it2->canConvert<QString>())
-            {
-                sl << it1->toString() << it2->toString();
-            }
-            else if (it1 = md.find("xesam:url"); it1 != md.end() && it1->canConvert<QString>())
-            {
-                QFileInfo fi(QUrl(it1->toString()).toLocalFile());
-                sl << fi.fileName() << fi.dir().dirName();
-            }
+        sl << playback_status_strings[playback_status];
 
-            items.emplace_back(StandardItem::make(id, id, sl.join(" – "), icon_urls, actions), m);
+        if (auto it1 = md.find("xesam:title"), it2 = md.find("xesam:artist");
+            it1 != md.end() && it2 != md.end() && it1->canConvert<QString>())
+        {
+            // xesam:artist is a list of strings
+            sl << it1->toString() << it2->toStringList().join(", ");
+        }
+        else if (it1 = md.find("xesam:url"); it1 != md.end() && it1->canConvert<QString>())
+        {
+            QFileInfo fi(QUrl(it1->toString()).toLocalFile());
+            sl << fi.fileName() << fi.dir().dirName();
         }
 
+        items.emplace_back(StandardItem::make(id, id, sl.join(" – "), icon_urls, actions), m);
+    }
 
-        // Control items
 
-        if (m = matcher.match(tr_next); m && control.canGoNext())
-            items.emplace_back(makeCtlItem(tr_next, iu_next, act_next), m);
+    // Control items
 
-        if (m = matcher.match(tr_prev); m && control.canGoPrevious())
-            items.emplace_back(makeCtlItem(tr_prev, iu_prev, act_prev), m);
+    if (m = matcher.match(controls, Next); m >= 0 && s.can_go_next)
+        items.emplace_back(makeCtlItem(tr_next, iu_next, act_next), m);
 
-        if (playback_status == Playing)
-        {
-            if (m = matcher.match(tr_stop); m)
-                items.emplace_back(makeCtlItem(tr_stop, iu_stop, act_stop), m);
+    if (m = matcher.match(controls, Previous); m >= 0 && s.can_go_previous)
+        items.emplace_back(makeCtlItem(tr_prev, iu_prev, act_prev), m);
 
-            if (m = matcher.match(tr_pause); m && control.canPause())
-                items.emplace_back(makeCtlItem(tr_pause, iu_pause, act_pause), m);
-        }
-        else
-        {
-            if (m = matcher.match(tr_play); m && control.canPlay())
-                items.emplace_back(makeCtlItem(tr_play, iu_play, act_stop), m);
-        }
+    if (playback_status == Playing)
+    {
+        if (m = matcher.match(controls, Stop); m >= 0)
+            items.emplace_back(makeCtlItem(tr_stop, iu_stop, act_stop), m);
 
+        if (m = matcher.match(controls, Pause); m >= 0 && s.can_pause)
+            items.emplace_back(makeCtlItem(tr_pause, iu_pause, act_pause), m);
     }
-};
+    else
+    {
+        if (m = matcher.match(controls, Play); m >= 0 && s.can_play)
+            items.emplace_back(makeCtlItem(tr_play, iu_play, act_play), m);
+    }
+}
 
 
 struct Plugin::Private
@@ -188,7 +170,16 @@ struct Plugin::Private
         "org.mpris.MediaPlayer2*", bus,
         QDBusServiceWatcher::WatchForOwnerChange
     };
-    map<QString, Player> players;
+    shared_mutex players_mutex;
+    map<QString, shared_ptr<Player>> players;
+
+    void addPlayer(const QString &service)
+    {
+        // The last reference may be released in a query thread
+        shared_ptr<Player> player(new Player(service, bus), [](Player *p){ p->deleteLater(); });
+        lock_guard lock(players_mutex);
+        players.insert_or_assign(service, ::move(player));
+    }
 };
 
 Plugin::Plugin() : d(make_unique<Private>())
@@ -205,16 +196,25 @@ Plugin::Plugin() : d(make_unique<Private>())
     else
         for (const auto &service : reply.value())
             if (service.startsWith(QStringLiteral("org.mpris.MediaPlayer2.")))
-                d->players.emplace(piecewise_construct, forward_as_tuple(service), forward_as_tuple(service, d->bus));
+                d->addPlayer(service);
 }
 
 Plugin::~Plugin() = default;
 
 vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 {
+    TRACE_SCOPE("query", "mpris");
+    vector<shared_ptr<Player>> players;
+    {
+        shared_lock lock(d->players_mutex);
+        for (const auto &[service, player] : d->players)
+            players.emplace_back(player);
+    }
+
+    batchmatch::BatchMatcher matcher(query->string());
     vector<RankItem> results;
-    for (auto &[service, player] : d->players)
-        player.addItems(results, query->string());
+    for (const auto &player : players)
+        addItems(results, player, matcher);
     return results;
 }
 
@@ -228,8 +228,11 @@ QWidget *Plugin::buildConfigWidget()
 
 void Plugin::serviceOwnerChanged(const QString &service, const QString &, const QString &newOwner)
 {
-    if(d->players.erase(service))
-        DEBG << "MPRIS player unregistered:" << service;
+    {
+        lock_guard lock(d->players_mutex);
+        if(d->players.erase(service))
+            DEBG << "MPRIS player unregistered:" << service;
+    }
     if (!newOwner.isEmpty())
-        d->players.emplace(piecewise_construct, forward_as_tuple(service), forward_as_tuple(service, d->bus));
+        d->addPlayer(service);
 }
@@ -1,8 +1,8 @@
 // Copyright (c) 2017-2024 Manuel Schneider
 
 #include "plugin.h"
+#include "trace.h"
 #include <QDirIterator>
-#include <QFileSystemWatcher>
 #include <QLabel>
 #include <QStringList>
 #include <albert/extensionregistry.h>
@@ -37,8 +37,7 @@ Plugin::Plugin():
         index_ = ::move(res);
     };
     
-    watcher_.addPaths(QString(::getenv("PATH")).split(':', Qt::SkipEmptyParts));
-    connect(&watcher_, &QFileSystemWatcher::directoryChanged, this, [this](){ indexer_.run(); });
+    watch_.setPaths(QString(::getenv("PATH")).split(':', Qt::SkipEmptyParts));
 
     indexer_.run();
 }
@@ -81,6 +80,7 @@ vector<Action> Plugin::buildActions(const QString &commandline) const
 
 void Plugin::handleTriggerQuery(Query *query)
 {
+    TRACE_SCOPE("query", "terminal");
     if (query->string().trimmed().isEmpty())
         return;
 
@@ -1,7 +1,7 @@
 // Copyright (c) 2017-2024 Manuel Schneider
 
 #pragma once
-#include <QFileSystemWatcher>
+#include "filewatch.h"
 #include <albert/backgroundexecutor.h>
 #include <albert/extensionplugin.h>
 #include <albert/plugin/applications.h>
@@ -29,7 +29,7 @@ private:
 
     std::vector<albert::Action> buildActions(const QString &commandline) const;
 
-    QFileSystemWatcher watcher_;
+    filewatch::Subscription watch_{[this](const QStringList&){ indexer_.run(); }};
     std::set<QString> index_;
     albert::BackgroundExecutor<std::set<QString>> indexer_;
     albert::StrongDependency<applications::Plugin> apps_;
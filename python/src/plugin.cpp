@@ -7,6 +7,7 @@
 #include "plugin.h"
 #include "pypluginloader.h"
 #include "ui_configwidget.h"
+#include "warmup.h"
 #include <QDir>
 #include <QFontDatabase>
 #include <QPointer>
@@ -33,6 +34,8 @@ applications::Plugin *apps;
 Plugin::Plugin():
     apps(registry(), "applications")
 {
+    warmup::ConstructionTimer construction(id());
+
     if (Py_IsInitialized() != 0)
         throw runtime_error("The interpreter is already running");
 
@@ -112,20 +115,40 @@ Plugin::Plugin():
     auto sys = py::module::import("sys");
 
 
-    // Initialize the virtual environment using the system interpreter
-    QProcess p;
-    p.start(QDir(sys.attr("prefix").cast<QString>()).filePath("bin/python3"),
-            {"-m", "venv", "--upgrade", "--upgrade-deps", venv()});
-    DEBG << "Initializing venv using system interpreter:"
-         << (QStringList() << p.program() << p.arguments()).join(QChar::Space);
-    p.waitForFinished(-1);
-    if (auto out = p.readAllStandardOutput(); !out.isEmpty())
-        DEBG << out;
-    if (auto err = p.readAllStandardError(); !err.isEmpty())
-        WARN << err;
-    if (p.exitCode() != 0)
-        throw runtime_error(tr("Failed initializing virtual environment. Exit code: %1.")
-                            .arg(p.exitCode()).toStdString());
+    // Initialize the virtual environment using the system interpreter. Upgrading
+    // an existing venv involves pip and the network, hence runs deferred.
+    auto system_python = QDir(sys.attr("prefix").cast<QString>()).filePath("bin/python3");
+    if (QFile::exists(venv_python()))
+        warmup::schedule(this, id(), [this, system_python]
+        {
+            venv_upgrade_ = new QProcess(this);
+            connect(venv_upgrade_, &QProcess::finished, venv_upgrade_, [this](int exit_code)
+            {
+                if (auto err = venv_upgrade_->readAllStandardError(); !err.isEmpty())
+                    WARN << err;
+                if (exit_code != 0)
+                    WARN << "Failed upgrading virtual environment. Exit code:" << exit_code;
+                venv_upgrade_->deleteLater();
+                warmup::ready(id());
+            });
+            DEBG << "Upgrading venv using system interpreter";
+            venv_upgrade_->start(system_python, {"-m", "venv", "--upgrade", "--upgrade-deps", venv()});
+        }, warmup::Ready::Reported);
+    else
+    {
+        QProcess p;
+        p.start(system_python, {"-m", "venv", "--upgrade-deps", venv()});
+        DEBG << "Initializing venv using system interpreter:"
+             << (QStringList() << p.program() << p.arguments()).join(QChar::Space);
+        p.waitForFinished(-1);
+        if (auto out = p.readAllStandardOutput(); !out.isEmpty())
+            DEBG << out;
+        if (auto err = p.readAllStandardError(); !err.isEmpty())
+            WARN << err;
+        if (p.exitCode() != 0)
+            throw runtime_error(tr("Failed initializing virtual environment. Exit code: %1.")
+                                .arg(p.exitCode()).toStdString());
+    }
 
 
     // Add venv site packages to path
@@ -183,6 +206,8 @@ Plugin::Plugin():
 
 Plugin::~Plugin()
 {
+    if (venv_upgrade_)
+        venv_upgrade_->waitForFinished(-1);
     release_.reset();
     plugins_.clear();
 
@@ -241,6 +266,9 @@ QWidget *Plugin::buildConfigWidget()
 
 bool Plugin::installPackages(const QStringList &packages)
 {
+    if (venv_upgrade_)  // pip must not run concurrently
+        venv_upgrade_->waitForFinished(-1);
+
     // Install dependencies
     QProcess p;
     p.start(venv_pip(), QStringList{"install"} << packages);
@@ -3,12 +3,14 @@
 #pragma once
 #include "pybind11/gil.h"
 
+#include <QPointer>
 #include <albert/extensionplugin.h>
 #include <albert/plugin/applications.h>
 #include <albert/plugindependency.h>
 #include <albert/pluginprovider.h>
 #include <memory>
 class PyPluginLoader;
+class QProcess;
 
 class Plugin : public albert::ExtensionPlugin,
                public albert::PluginProvider
@@ -32,10 +34,12 @@ private:
     inline QString sitePackagesLocation() const;
     inline QString userPluginsLocation() const;
     inline QString stubLocation() const;
+    void upgradeVenv();
 
     albert::StrongDependency<applications::Plugin> apps;
     std::vector<std::unique_ptr<PyPluginLoader>> plugins_;
     std::unique_ptr<pybind11::gil_scoped_release> release_;
+    QPointer<QProcess> venv_upgrade_;
 
 };
 
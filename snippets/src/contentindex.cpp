@@ -0,0 +1,134 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "contentindex.h"
+#include <QIODevice>
+#include <QStringDecoder>
+#include <algorithm>
+#include <unordered_set>
+using namespace std;
+
+static const qint64 read_chunk_size = 64 * 1024;
+
+template<class F>
+static void forEachWord(QStringView text, F &&f)
+{
+    qsizetype begin = -1;
+    for (qsizetype i = 0; i <= text.size(); ++i)
+    {
+        if (i < text.size() && text[i].isLetterOrNumber())
+        {
+            if (begin < 0)
+                begin = i;
+        }
+        else if (begin >= 0)
+        {
+            if (!f(text.mid(begin, i - begin)))
+                return;
+            begin = -1;
+        }
+    }
+}
+
+vector<QString> ContentIndex::tokenize(QIODevice &device)
+{
+    unordered_set<QString> tokens;
+    QStringDecoder decoder(QStringDecoder::Utf8);
+    QString carry;  // word split by the chunk boundary
+
+    while (tokens.size() < max_tokens && !device.atEnd())
+    {
+        QString text = carry + decoder(device.read(read_chunk_size));
+
+        // Keep the trailing partial word for the next chunk
+        qsizetype end = text.size();
+        while (!device.atEnd() && end > 0 && text[end - 1].isLetterOrNumber())
+            --end;
+        if (end == 0)  // no word boundary at all
+            end = text.size();
+        carry = text.mid(end);
+
+        forEachWord(QStringView(text).left(end), [&](QStringView word){
+            if (word.size() > 1)
+                tokens.insert(word.left(max_token_length).toString().toLower());
+            return tokens.size() < max_tokens;
+        });
+    }
+
+    return {tokens.begin(), tokens.end()};
+}
+
+void ContentIndex::remove(const QString &file_name)
+{
+    if (auto it = tokens_.find(file_name); it != tokens_.end())
+    {
+        for (const auto &token : it->second)
+            if (auto p = postings_.find(token); p != postings_.end())
+                if (p->second.erase(file_name); p->second.empty())
+                    postings_.erase(p);
+        tokens_.erase(it);
+    }
+}
+
+void ContentIndex::update(const set<QString> &existing,
+                          map<QString, vector<QString>> &&tokenized)
+{
+    unique_lock lock(mutex_);
+
+    vector<QString> removed;
+    for (const auto &[file_name, _] : tokens_)
+        if (!existing.contains(file_name) || tokenized.contains(file_name))
+            removed.emplace_back(file_name);
+    for (const auto &file_name : removed)
+        remove(file_name);
+
+    for (auto &[file_name, tokens] : tokenized)
+    {
+        for (const auto &token : tokens)
+            postings_[token].insert(file_name);
+        tokens_.emplace(file_name, ::move(tokens));
+    }
+}
+
+void ContentIndex::clear()
+{
+    unique_lock lock(mutex_);
+    postings_.clear();
+    tokens_.clear();
+}
+
+bool ContentIndex::contains(const QString &file_name) const
+{
+    shared_lock lock(mutex_);
+    return tokens_.contains(file_name);
+}
+
+set<QString> ContentIndex::find(const QString &query) const
+{
+    shared_lock lock(mutex_);
+
+    set<QString> result;
+    bool first = true;
+    forEachWord(query, [&](QStringView word)
+    {
+        const auto prefix = word.left(max_token_length).toString().toLower();
+
+        set<QString> matches;
+        for (auto it = postings_.lower_bound(prefix);
+             it != postings_.end() && it->first.startsWith(prefix); ++it)
+            matches.insert(it->second.begin(), it->second.end());
+
+        if (first)
+            result = ::move(matches);
+        else
+        {
+            set<QString> intersection;
+            set_intersection(result.begin(), result.end(), matches.begin(), matches.end(),
+                             inserter(intersection, intersection.end()));
+            result = ::move(intersection);
+        }
+
+        first = false;
+        return !result.empty();
+    });
+    return result;
+}
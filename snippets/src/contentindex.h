@@ -0,0 +1,49 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <map>
+#include <set>
+#include <shared_mutex>
+#include <vector>
+class QIODevice;
+
+///
+/// Inverted index of the words in the snippet files.
+///
+/// Maps lowercase tokens to the file names of the snippets containing them. At
+/// most `max_tokens` distinct tokens are stored per snippet, such that memory
+/// stays bounded for large files. Updates replace the tokens of single snippets.
+///
+/// Thread-safe.
+///
+class ContentIndex
+{
+public:
+
+    static constexpr size_t max_tokens = 1000;
+    static constexpr int max_token_length = 32;
+
+    /// Distinct lowercase tokens of `device`, reads until `max_tokens` are found
+    static std::vector<QString> tokenize(QIODevice &device);
+
+    /// Drops snippets not in `existing` and (re)places the tokens of `tokenized`.
+    void update(const std::set<QString> &existing,
+                std::map<QString, std::vector<QString>> &&tokenized);
+
+    void clear();
+
+    bool contains(const QString &file_name) const;
+
+    /// Snippets containing a token starting with each of the words in `query`.
+    std::set<QString> find(const QString &query) const;
+
+private:
+
+    void remove(const QString &file_name);
+
+    mutable std::shared_mutex mutex_;
+    std::map<QString, std::set<QString>> postings_;  // token -> file names
+    std::map<QString, std::vector<QString>> tokens_;  // file name -> tokens
+
+};
@@ -1,115 +1,82 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
 #include "plugin.h"
+#include "snippetitem.h"
+#include "trace.h"
 #include "ui_configwidget.h"
 #include <QFileSystemModel>
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QTextStream>
+#include <albert/matcher.h>
 #include <albert/standarditem.h>
 #include <albert/util.h>
-#include <memory>
 ALBERT_LOGGING_CATEGORY("snippets")
 using namespace albert;
 using namespace std;
 
-static const int preview_max_size = 100;
-
-struct SnippetItem : Item
-{
-    SnippetItem(const QFileInfo& fi, Plugin *p)
-        : file_base_name_(fi.completeBaseName()), plugin_(p)
-    {
-        QFile file(fi.filePath());
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream in(&file);
-            preview_ = in.readAll().simplified();
-            if (preview_.size() > preview_max_size)
-                preview_ = preview_.left(preview_max_size) + " …";
-            preview_.squeeze();
-            file.close();
-        } else
-            WARN << "Failed to read from snippet file" << path();
-    }
-
-    QString id() const override
-    { return file_base_name_; }
-
-    QString text() const override
-    { return file_base_name_; }
-
-    QString subtext() const override
-    {
-        static const auto tr = QCoreApplication::translate("SnippetItem", "Text snippet");
-        return QString("%1 – %2").arg(tr, preview_);
-    }
-
-    QStringList iconUrls() const override
-    { return {":snippet"}; }
-
-    vector<Action> actions() const override
-    {
-        static const auto tr_cp = QCoreApplication::translate("SnippetItem", "Copy and paste");
-        static const auto tr_c = QCoreApplication::translate("SnippetItem", "Copy");
-        static const auto tr_e = QCoreApplication::translate("SnippetItem", "Edit");
-        static const auto tr_r = QCoreApplication::translate("SnippetItem", "Remove");
-
-        vector<Action> actions;
-
-        if (havePasteSupport())
-            actions.emplace_back(
-                "cp", tr_cp,
-                [this]{
-                    QFile f(path());
-                    f.open(QIODevice::ReadOnly);
-                    setClipboardTextAndPaste(QTextStream(&f).readAll());
-                }
-            );
-
-        actions.emplace_back(
-            "c", tr_c,
-            [this]{
-                QFile f(path());
-                f.open(QIODevice::ReadOnly);
-                setClipboardText(QTextStream(&f).readAll());
-            }
-        );
-
-        actions.emplace_back("o", tr_e, [this]{ openUrl(QUrl::fromLocalFile(path())); });
-
-        actions.emplace_back("r", tr_r, [this]{ plugin_->removeSnippet(file_base_name_+".txt"); });
-
-        return actions;
-    }
-
-    QString path() const
-    { return QDir(plugin_->configLocation()).filePath(file_base_name_ + ".txt"); }
-
-private:
-
-    const QString file_base_name_;
-    QString preview_;
-    Plugin * const plugin_;
-};
-
-
 Plugin::Plugin()
 {
     createOrThrow(configLocation());
 
-    fs_watcher.addPath(configLocation());
-    connect(&fs_watcher, &QFileSystemWatcher::directoryChanged, this, [this](){updateIndexItems();});
+    fs_watch.setPaths({configLocation()});
+
+    restore_index_content(settings());
+    connect(this, &Plugin::index_content_changed, this, &Plugin::updateIndexItems);
 
+    // Only new and modified snippets get new items. Unchanged items are kept
+    // including their lazily read previews.
     indexer.parallel = [this](const bool &abort){
-        vector<IndexItem> r;
-        for (const auto &f : QDir(configLocation()).entryInfoList({"*.txt"}, QDir::Files)){
+        TRACE_SCOPE("snippets", "scan");
+        IndexerResult r;
+        const bool index_content = index_content_;
+        for (const auto &fi : QDir(configLocation()).entryInfoList({"*.txt"}, QDir::Files)){
             if (abort) return r;
-            r.emplace_back(make_shared<SnippetItem>(f, this), f.completeBaseName());
+
+            bool modified = false;
+            if (auto it = snippet_items.find(fi.fileName());
+                it != snippet_items.end() && it->second->isUpToDate(fi.lastModified(), fi.size()))
+                r.snippets.emplace(*it);
+            else
+            {
+                r.snippets.emplace(fi.fileName(),
+                                   make_shared<SnippetItem>(fi.completeBaseName(), fi.lastModified(), fi.size(), this));
+                modified = true;
+            }
+
+            if (index_content && (modified || !content_index.contains(fi.fileName())))
+            {
+                TRACE_SCOPE("snippets", "tokenize");
+                if (QFile file(fi.filePath()); file.open(QIODevice::ReadOnly))
+                    r.tokenized.emplace(fi.fileName(), ContentIndex::tokenize(file));
+                else
+                    WARN << "Failed to read from snippet file" << fi.filePath();
+            }
         }
         return r;
     };
-    indexer.finish = [this](vector<IndexItem> &&results){
-        setIndexItems(::move(results));
+    indexer.finish = [this](IndexerResult &&r){
+        TRACE_SCOPE("snippets", "publish");
+        {
+            unique_lock lock(snippet_items_mutex);
+            snippet_items = ::move(r.snippets);
+        }
+
+        if (index_content_)
+        {
+            set<QString> existing;
+            for (const auto &[file_name, _] : snippet_items)
+                existing.insert(existing.end(), file_name);
+            content_index.update(existing, ::move(r.tokenized));
+        }
+        else
+            content_index.clear();
+
+        vector<IndexItem> items;
+        items.reserve(snippet_items.size());
+        for (const auto &[file_name, item] : snippet_items)
+            items.emplace_back(item, item->text());
+        setIndexItems(::move(items));
     };
 }
 
@@ -127,6 +94,7 @@ void Plugin::updateIndexItems()
 
 void Plugin::handleTriggerQuery(Query *query)
 {
+    TRACE_SCOPE("query", "snippets");
     if (query->string() == QStringLiteral("+"))
         query->add(
             StandardItem::make(
@@ -140,7 +108,25 @@ void Plugin::handleTriggerQuery(Query *query)
             )
         );
     else
+    {
+        // Name matches first
         IndexQueryHandler::handleTriggerQuery(query);
+
+        if (!index_content_ || query->string().trimmed().isEmpty())
+            return;
+
+        Matcher matcher(query->string());
+        shared_lock lock(snippet_items_mutex);
+        for (const auto &file_name : content_index.find(query->string()))
+        {
+            if (!query->isValid())
+                return;
+
+            if (auto it = snippet_items.find(file_name);
+                it != snippet_items.end() && !matcher.match(it->second->text()))
+                query->add(it->second);
+        }
+    }
 }
 
 void Plugin::addSnippet(const QString &text, QWidget *parent) const
@@ -227,6 +213,8 @@ QWidget *Plugin::buildConfigWidget()
     ui.listView->setModel(model);
     ui.listView->setRootIndex(model->index(configLocation()));
 
+    ALBERT_PROPERTY_CONNECT_CHECKBOX(this, index_content, ui.checkBox_indexContent)
+
     connect(ui.listView, &QListView::activated, this,
             [model](const QModelIndex &index){ openUrl(QUrl::fromLocalFile(model->filePath(index))); });
 
@@ -2,11 +2,17 @@
 
 #pragma once
 
+#include "contentindex.h"
+#include "filewatch.h"
 #include "snippets.h"
-#include <QFileSystemWatcher>
 #include <albert/backgroundexecutor.h>
 #include <albert/extensionplugin.h>
 #include <albert/indexqueryhandler.h>
+#include <albert/property.h>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+class SnippetItem;
 class QWidget;
 
 class Plugin : public albert::ExtensionPlugin,
@@ -15,6 +21,8 @@ class Plugin : public albert::ExtensionPlugin,
 
 {
     ALBERT_PLUGIN
+    ALBERT_PLUGIN_PROPERTY(bool, index_content, false)
+
 public:
     Plugin();
 
@@ -28,6 +36,18 @@ private:
     QString synopsis() const override;
     void handleTriggerQuery(albert::Query*) override;
 
-    QFileSystemWatcher fs_watcher;
-    albert::BackgroundExecutor<std::vector<albert::IndexItem>> indexer;
+    using Snippets = std::map<QString, std::shared_ptr<SnippetItem>>;  // by file name
+
+    struct IndexerResult
+    {
+        Snippets snippets;
+        std::map<QString, std::vector<QString>> tokenized;  // new or modified, if index_content
+    };
+
+    filewatch::Subscription fs_watch{[this](const QStringList&){ indexer.run(); },
+                                     std::chrono::milliseconds(200)};
+    albert::BackgroundExecutor<IndexerResult> indexer;
+    Snippets snippet_items;  // accessed by the indexer, read only while running
+    mutable std::shared_mutex snippet_items_mutex;  // guards against queries
+    ContentIndex content_index;
 };
@@ -0,0 +1,97 @@
+// Copyright (c) 2023-2024 Manuel Schneider
+
+#include "plugin.h"
+#include "snippetitem.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <albert/logging.h>
+#include <albert/util.h>
+using namespace albert;
+using namespace std;
+
+static const int preview_max_size = 100;
+static const qint64 preview_read_size = 4096;  // bytes, enough for preview_max_size chars in most cases
+
+SnippetItem::SnippetItem(const QString &file_base_name, const QDateTime &mtime, qint64 size, Plugin *p)
+    : file_base_name_(file_base_name), mtime_(mtime), size_(size), plugin_(p) {}
+
+QString SnippetItem::id() const
+{ return file_base_name_; }
+
+QString SnippetItem::text() const
+{ return file_base_name_; }
+
+QString SnippetItem::subtext() const
+{
+    static const auto tr = QCoreApplication::translate("SnippetItem", "Text snippet");
+    return QString("%1 – %2").arg(tr, preview());
+}
+
+QStringList SnippetItem::iconUrls() const
+{ return {":snippet"}; }
+
+vector<Action> SnippetItem::actions() const
+{
+    static const auto tr_cp = QCoreApplication::translate("SnippetItem", "Copy and paste");
+    static const auto tr_c = QCoreApplication::translate("SnippetItem", "Copy");
+    static const auto tr_e = QCoreApplication::translate("SnippetItem", "Edit");
+    static const auto tr_r = QCoreApplication::translate("SnippetItem", "Remove");
+
+    vector<Action> actions;
+
+    if (havePasteSupport())
+        actions.emplace_back(
+            "cp", tr_cp,
+            [this]{
+                QFile f(path());
+                f.open(QIODevice::ReadOnly);
+                setClipboardTextAndPaste(QTextStream(&f).readAll());
+            }
+        );
+
+    actions.emplace_back(
+        "c", tr_c,
+        [this]{
+            QFile f(path());
+            f.open(QIODevice::ReadOnly);
+            setClipboardText(QTextStream(&f).readAll());
+        }
+    );
+
+    actions.emplace_back("o", tr_e, [this]{ openUrl(QUrl::fromLocalFile(path())); });
+
+    actions.emplace_back("r", tr_r, [this]{ plugin_->removeSnippet(file_base_name_+".txt"); });
+
+    return actions;
+}
+
+QString SnippetItem::path() const
+{ return QDir(plugin_->configLocation()).filePath(file_base_name_ + ".txt"); }
+
+bool SnippetItem::isUpToDate(const QDateTime &mtime, qint64 size) const
+{ return mtime_ == mtime && size_ == size; }
+
+QString SnippetItem::preview() const
+{
+    call_once(preview_flag_, [this]
+    {
+        QFile file(path());
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            WARN << "Failed to read from snippet file" << path();
+            return;
+        }
+
+        // Bounded prefix only, snippets may be large
+        const auto head = file.read(preview_read_size);
+        preview_ = QString::fromUtf8(head).simplified();
+        if (preview_.size() > preview_max_size)
+            preview_ = preview_.left(preview_max_size) + " …";
+        else if (file.size() > head.size())
+            preview_ += " …";
+        preview_.squeeze();
+    });
+    return preview_;
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2023-2024 Manuel Schneider
+
+#pragma once
+#include <QDateTime>
+#include <QString>
+#include <albert/item.h>
+#include <mutex>
+class Plugin;
+
+class SnippetItem : public albert::Item
+{
+public:
+
+    SnippetItem(const QString &file_base_name, const QDateTime &mtime, qint64 size, Plugin *p);
+
+    QString id() const override;
+    QString text() const override;
+    QString subtext() const override;
+    QStringList iconUrls() const override;
+    std::vector<albert::Action> actions() const override;
+
+    QString path() const;
+
+    /// True if the file did not change since the item has been created.
+    bool isUpToDate(const QDateTime &mtime, qint64 size) const;
+
+private:
+
+    QString preview() const;
+
+    const QString file_base_name_;
+    const QDateTime mtime_;
+    const qint64 size_;
+    Plugin * const plugin_;
+
+    // Read on first display
+    mutable std::once_flag preview_flag_;
+    mutable QString preview_;
+
+};
@@ -0,0 +1,342 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "hoststore.h"
+#include "trace.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMessageAuthenticationCode>
+#include <QTextStream>
+#include <albert/logging.h>
+#include <functional>
+#include <glob.h>
+#include <set>
+using namespace std;
+
+static const QStringList user_configs = { QStringLiteral(".ssh/config") };
+static const QStringList system_configs = { QStringLiteral("/etc/ssh/ssh_config"),
+                                            QStringLiteral("/etc/ssh/config") };
+static const QStringList user_known_hosts = { QStringLiteral(".ssh/known_hosts"),
+                                              QStringLiteral(".ssh/known_hosts2") };
+static const QStringList system_known_hosts = { QStringLiteral("/etc/ssh/ssh_known_hosts"),
+                                                QStringLiteral("/etc/ssh/ssh_known_hosts2") };
+
+static bool isPattern(const QString &s)
+{ return s.contains('*') || s.contains('?') || s.startsWith('!'); }
+
+static QString expandTilde(const QString &path)
+{
+    if (path == QStringLiteral("~"))
+        return QDir::homePath();
+    else if (path.startsWith(QStringLiteral("~/")))
+        return QDir::home().filePath(path.mid(2));
+    return path;
+}
+
+static QStringList expandGlob(const QString &pattern)
+{
+    QStringList paths;
+    glob_t g;
+    if (glob(QFile::encodeName(pattern).constData(), 0, nullptr, &g) == 0)
+        for (size_t i = 0; i < g.gl_pathc; ++i)
+            paths << QFile::decodeName(g.gl_pathv[i]);
+    globfree(&g);
+    return paths;
+}
+
+// Splits a config line into keyword and arguments. Handles '=' and double quotes.
+static QStringList tokenize(const QString &line)
+{
+    QStringList tokens;
+    QString token;
+    bool quoted = false;
+    bool have_token = false;
+
+    for (const QChar c : line)
+    {
+        if (c == '"')
+        {
+            quoted = !quoted;
+            have_token = true;
+        }
+        else if (!quoted && (c.isSpace() || (c == '=' && tokens.isEmpty())))
+        {
+            if (have_token)
+                tokens << token;
+            token.clear();
+            have_token = false;
+        }
+        else if (!quoted && c == '#')
+            break;
+        else
+        {
+            token.append(c);
+            have_token = true;
+        }
+    }
+    if (have_token)
+        tokens << token;
+    return tokens;
+}
+
+static shared_ptr<HostStore::ParsedFile> parseConfig(const QFileInfo &fi, bool user_config)
+{
+    auto parsed = make_shared<HostStore::ParsedFile>();
+    parsed->mtime = fi.lastModified();
+    parsed->size = fi.size();
+
+    QFile file(fi.filePath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return parsed;
+
+    // Relative includes are relative to ~/.ssh or /etc/ssh, see ssh_config(5)
+    const QDir include_base = user_config ? QDir(QDir::home().filePath(".ssh"))
+                                          : QDir(QStringLiteral("/etc/ssh"));
+
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        const auto tokens = tokenize(in.readLine());
+        if (tokens.size() < 2)
+            continue;
+
+        const auto &keyword = tokens[0];
+        if (keyword.compare(QStringLiteral("Host"), Qt::CaseInsensitive) == 0)
+        {
+            for (auto it = tokens.begin() + 1; it != tokens.end(); ++it)
+                if (!isPattern(*it))
+                    parsed->hosts << *it;
+        }
+        else if (keyword.compare(QStringLiteral("Include"), Qt::CaseInsensitive) == 0)
+        {
+            for (auto it = tokens.begin() + 1; it != tokens.end(); ++it)
+            {
+                auto pattern = include_base.filePath(expandTilde(*it));
+                parsed->include_dirs << QFileInfo(pattern).path();
+                parsed->includes << expandGlob(pattern);
+            }
+        }
+        else if (keyword.compare(QStringLiteral("UserKnownHostsFile"), Qt::CaseInsensitive) == 0
+                 || keyword.compare(QStringLiteral("GlobalKnownHostsFile"), Qt::CaseInsensitive) == 0)
+        {
+            for (auto it = tokens.begin() + 1; it != tokens.end(); ++it)
+                if (!it->contains('%') && it->compare(QStringLiteral("none"), Qt::CaseInsensitive) != 0)
+                    parsed->known_hosts_files << include_base.filePath(expandTilde(*it));
+        }
+    }
+
+    parsed->include_dirs.removeDuplicates();
+    return parsed;
+}
+
+static shared_ptr<HostStore::ParsedFile> parseKnownHosts(const QFileInfo &fi)
+{
+    auto parsed = make_shared<HostStore::ParsedFile>();
+    parsed->mtime = fi.lastModified();
+    parsed->size = fi.size();
+
+    QFile file(fi.filePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return parsed;
+
+    // [marker] hostnames keytype base64-key [comment]
+    while (!file.atEnd())
+    {
+        auto line = file.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        if (line.startsWith('@'))  // @cert-authority, @revoked
+        {
+            if (line.startsWith("@revoked"))
+                continue;
+            line = line.mid(line.indexOf(' ') + 1).trimmed();
+        }
+
+        const auto names = line.left(line.indexOf(' '));
+
+        if (names.startsWith("|1|"))  // |1|base64 salt|base64 hash
+        {
+            if (auto fields = names.split('|'); fields.size() == 4)
+                parsed->hashed.emplace_back(QByteArray::fromBase64(fields[2]),
+                                            QByteArray::fromBase64(fields[3]));
+            continue;
+        }
+
+        for (const auto &name : names.split(','))
+        {
+            auto host = QString::fromUtf8(name);
+            if (host.startsWith('['))  // [host]:port
+                host = host.mid(1, host.indexOf(']') - 1);
+            if (!host.isEmpty() && !isPattern(host))
+                parsed->hosts << host;
+        }
+    }
+    return parsed;
+}
+
+
+HostStore::HostStore() : index_(make_shared<Index>())
+{
+    indexer_.parallel = [this](const bool &abort)
+    {
+        TRACE_SCOPE("ssh", "scan");
+        IndexerResult r;
+        set<QString> known_hosts_files;
+
+        // Reuse the cached parse results of files that did not change
+        auto get = [&](const QString &path, auto parse) -> shared_ptr<const ParsedFile>
+        {
+            QFileInfo fi(path);
+            r.watch_paths << fi.path();
+            if (!fi.isFile())
+                return nullptr;
+
+            r.watch_paths << fi.filePath();
+            if (auto it = cache_.find(fi.absoluteFilePath());
+                it != cache_.end() && it->second->mtime == fi.lastModified() && it->second->size == fi.size())
+                return r.cache.emplace(it->first, it->second).first->second;
+
+            TRACE_SCOPE("ssh", "parse");
+            return r.cache.emplace(fi.absoluteFilePath(), parse(fi)).first->second;
+        };
+
+        set<QString> visited;  // Include loops
+        function<void(const QString&, bool)> walk = [&](const QString &path, bool user_config)
+        {
+            if (abort || !visited.insert(path).second)
+                return;
+
+            if (auto parsed = get(path, [=](const QFileInfo &fi){ return parseConfig(fi, user_config); }))
+            {
+                r.watch_paths << parsed->include_dirs;
+                for (const auto &kh : parsed->known_hosts_files)
+                    known_hosts_files.insert(kh);
+                for (const auto &include : parsed->includes)
+                    walk(include, user_config);
+            }
+        };
+
+        for (const auto &path : user_configs)
+            walk(QDir::home().filePath(path), true);
+        for (const auto &path : system_configs)
+            walk(path, false);
+
+        for (const auto &path : user_known_hosts)
+            known_hosts_files.insert(QDir::home().filePath(path));
+        for (const auto &path : system_known_hosts)
+            known_hosts_files.insert(path);
+
+        for (const auto &path : known_hosts_files)
+            if (!abort)
+                get(path, parseKnownHosts);
+
+        // Merge into the sorted prefix index
+
+        vector<pair<QString, QString>> entries;
+        auto index = make_shared<Index>();
+        for (const auto &[path, parsed] : r.cache)
+        {
+            for (const auto &host : parsed->hosts)
+                entries.emplace_back(host.toLower(), host);
+            index->hashed.insert(index->hashed.end(), parsed->hashed.begin(), parsed->hashed.end());
+        }
+
+        sort(entries.begin(), entries.end());
+        entries.erase(unique(entries.begin(), entries.end()), entries.end());
+
+        index->keys.reserve(entries.size());
+        index->hosts.reserve(entries.size());
+        for (auto &[key, host] : entries)
+        {
+            index->keys.emplace_back(::move(key));
+            index->hosts.emplace_back(::move(host));
+        }
+
+        r.watch_paths.removeDuplicates();
+        r.index = ::move(index);
+        return r;
+    };
+
+    indexer_.finish = [this](IndexerResult &&r){ onIndexerFinished(::move(r)); };
+
+    update();
+}
+
+HostStore::~HostStore() = default;
+
+void HostStore::update() { indexer_.run(); }
+
+void HostStore::onIndexerFinished(IndexerResult &&r)
+{
+    TRACE_SCOPE("ssh", "publish");
+    cache_ = ::move(r.cache);
+
+    // Editors and ssh replace files, lost watches are renewed
+    watch_.setPaths(r.watch_paths);
+
+    {
+        lock_guard lock(index_mutex_);
+        index_ = ::move(r.index);
+    }
+    {
+        lock_guard lock(hashed_lookup_mutex_);
+        last_hashed_lookup_ = {};
+    }
+
+    DEBG << QStringLiteral("Indexed %1 ssh hosts from %2 files [%3 ms]")
+                .arg(index_->hosts.size()).arg(cache_.size()).arg(indexer_.runtime.count());
+
+    emit updated(index_->hosts.size());
+}
+
+vector<QString> HostStore::prefixMatches(const QString &prefix) const
+{
+    shared_ptr<const Index> index;
+    {
+        lock_guard lock(index_mutex_);
+        index = index_;
+    }
+
+    vector<QString> matches;
+    const auto key = prefix.toLower();
+    for (auto it = lower_bound(index->keys.begin(), index->keys.end(), key);
+         it != index->keys.end() && it->startsWith(key); ++it)
+        matches.emplace_back(index->hosts[distance(index->keys.begin(), it)]);
+    return matches;
+}
+
+vector<QString> HostStore::hosts() const
+{
+    lock_guard lock(index_mutex_);
+    return index_->hosts;
+}
+
+bool HostStore::isHashedKnownHost(const QString &hostname) const
+{
+    shared_ptr<const Index> index;
+    {
+        lock_guard lock(index_mutex_);
+        index = index_;
+    }
+
+    if (hostname.isEmpty() || index->hashed.empty())
+        return false;
+
+    // Typing a host name queries the same host several times, one HMAC per entry is not free
+    {
+        lock_guard lock(hashed_lookup_mutex_);
+        if (last_hashed_lookup_.first == hostname)
+            return last_hashed_lookup_.second;
+    }
+
+    const auto data = hostname.toLower().toUtf8();
+    bool known = any_of(index->hashed.begin(), index->hashed.end(), [&](const auto &salt_hash){
+        return QMessageAuthenticationCode::hash(data, salt_hash.first, QCryptographicHash::Sha1)
+               == salt_hash.second;
+    });
+
+    lock_guard lock(hashed_lookup_mutex_);
+    last_hashed_lookup_ = {hostname, known};
+    return known;
+}
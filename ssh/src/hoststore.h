@@ -0,0 +1,90 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "filewatch.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <albert/backgroundexecutor.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+///
+/// Index of the hosts declared in the ssh configs and known_hosts files.
+///
+/// The configs are parsed recursively (glob `Include` patterns supported) in a
+/// background thread. Parse results are cached per file and keyed by modification date
+/// and size, such that changes of a single (included) file re-read only that file.
+///
+/// Lookups are thread-safe and served from an immutable, sorted snapshot.
+///
+class HostStore : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    HostStore();
+    ~HostStore();
+
+    /// Hosts starting with `prefix`, case insensitive, sorted.
+    std::vector<QString> prefixMatches(const QString &prefix) const;
+
+    /// All hosts, sorted. Used for the fuzzy fallback.
+    std::vector<QString> hosts() const;
+
+    /// True if `hostname` matches one of the hashed known_hosts entries.
+    bool isHashedKnownHost(const QString &hostname) const;
+
+    /// Rebuild the index. Unchanged files are not parsed again.
+    void update();
+
+    struct ParsedFile
+    {
+        QDateTime mtime;
+        qint64 size;
+        QStringList hosts;
+        QStringList includes;  // config only, globs expanded, absolute
+        QStringList include_dirs;  // config only, dirs globs are expanded in
+        QStringList known_hosts_files;  // config only, UserKnownHostsFile and alike
+        std::vector<std::pair<QByteArray, QByteArray>> hashed;  // known_hosts only, salt/hash
+    };
+
+    using FileCache = std::map<QString, std::shared_ptr<const ParsedFile>>;
+
+    struct Index
+    {
+        std::vector<QString> keys;  // lowercase, sorted
+        std::vector<QString> hosts;  // same order as keys
+        std::vector<std::pair<QByteArray, QByteArray>> hashed;
+    };
+
+private:
+
+    struct IndexerResult
+    {
+        FileCache cache;
+        QStringList watch_paths;
+        std::shared_ptr<const Index> index;
+    };
+
+    void onIndexerFinished(IndexerResult &&);
+
+    filewatch::Subscription watch_{[this](const QStringList&){ update(); }, std::chrono::milliseconds(200)};
+    albert::BackgroundExecutor<IndexerResult> indexer_;
+    FileCache cache_;  // accessed by the indexer, read only while running
+    mutable std::mutex index_mutex_;
+    std::shared_ptr<const Index> index_;
+    mutable std::mutex hashed_lookup_mutex_;
+    mutable std::pair<QString, bool> last_hashed_lookup_;
+
+signals:
+
+    void updated(uint host_count);
+
+};
@@ -1,14 +1,13 @@
 // Copyright (c) 2017-2024 Manuel Schneider
 
 #include "plugin.h"
-#include <QDir>
-#include <QFile>
+#include "trace.h"
 #include <QLabel>
 #include <QRegularExpression>
 #include <QString>
-#include <QTextStream>
 #include <QWidget>
 #include <albert/logging.h>
+#include <albert/matcher.h>
 #include <albert/standarditem.h>
 #include <albert/util.h>
 ALBERT_LOGGING_CATEGORY("ssh")
@@ -19,40 +18,13 @@ const QStringList Plugin::icon_urls = {"xdg:ssh", ":ssh"};
 
 const QRegularExpression Plugin::regex_synopsis = QRegularExpression(R"raw(^(?:(\w+)@)?\[?([\w\.-]*)\]?(?:\h+(.*))?$)raw");
 
-static QSet<QString> parseConfigFile(const QString &path)
-{
-    QSet<QString> hosts;
-
-    if (QFile file(path); file.open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        QTextStream in(&file);
-        while (!in.atEnd())
-        {
-            QStringList fields = in.readLine().split(" ", Qt::SkipEmptyParts);
-            if (fields.size() > 1 && fields[0] == "Host")
-            {
-                for (int i = 1; i < fields.size(); ++i)
-                    if (!(fields[i].contains('*') || fields[i].contains('?')))
-                        hosts << fields[i];
-            }
-            else if (fields.size() > 1 && fields[0] == "Include")
-            {
-                hosts.unite(parseConfigFile((fields[1][0] == '~') ? QDir::home().filePath(fields[1]) : fields[1]));
-            }
-        }
-        file.close();
-    }
-    return hosts;
-}
-
 Plugin::Plugin():
     apps(registry(), "applications"),
     tr_desc(tr("Configured SSH host – %1")),
     tr_conn(tr("Connect"))
 {
-    hosts.unite(parseConfigFile(QStringLiteral("/etc/ssh/config")));
-    hosts.unite(parseConfigFile(QDir::home().filePath(".ssh/config")));
-    INFO << QStringLiteral("Found %1 ssh hosts.").arg(hosts.size());
+    connect(&hosts, &HostStore::updated, this,
+            [](uint count){ INFO << QStringLiteral("Found %1 ssh hosts.").arg(count); });
 }
 
 QString Plugin::synopsis() const
@@ -76,24 +48,40 @@ std::vector<RankItem> Plugin::getItems(const QString &query, bool allowParams) c
     if (!(allowParams || q_params.isEmpty()))
         return r;
 
-    for (const auto &host : hosts)
+    auto makeItem = [&](const QString &host, double score)
+    {
+        QString cmd = "ssh ";
+        if (!q_user.isEmpty())
+            cmd += q_user + '@';
+        cmd += host;
+        if (!q_params.isEmpty())
+            cmd += ' ' + q_params;
+
+        auto a = [cmd, this]{ apps->runTerminal(QString("%1 || exec $SHELL").arg(cmd)); };
+
+        r.emplace_back(
+            StandardItem::make(host, host, tr_desc.arg(cmd), cmd, icon_urls, {{"c", tr_conn, a}}),
+            score
+        );
+    };
+
+    for (const auto &host : hosts.prefixMatches(q_host))
+        makeItem(host, (double)q_host.size() / host.size());
+
+    // Trigger queries only, global queries must stay cheap
+    if (allowParams && r.empty() && !q_host.isEmpty())
     {
-        if (host.startsWith(q_host, Qt::CaseInsensitive))
-        {
-            QString cmd = "ssh ";
-            if (!q_user.isEmpty())
-                cmd += q_user + '@';
-            cmd += host;
-            if (!q_params.isEmpty())
-                cmd += ' ' + q_params;
-
-            auto a = [cmd, this]{ apps->runTerminal(QString("%1 || exec $SHELL").arg(cmd)); };
-
-            r.emplace_back(
-                StandardItem::make(host, host, tr_desc.arg(cmd), cmd, icon_urls, {{"c", tr_conn, a}}),
-                (double)q_host.size() / host.size()
-            );
-        }
+        // Fuzzy fallback, e.g. for typos or mid name parts like "db-17" in "prod-db-17.example.com"
+        MatchConfig config;
+        config.fuzzy = true;
+        Matcher matcher(q_host, config);
+        for (const auto &host : hosts.hosts())
+            if (auto m = matcher.match(host); m)
+                makeItem(host, m.score());
+
+        // Hashed known_hosts entries can not be listed, but typed hosts can be verified
+        if (r.empty() && hosts.isHashedKnownHost(q_host))
+            makeItem(q_host, 1.0);
     }
 
     return r;
@@ -102,6 +90,7 @@ std::vector<RankItem> Plugin::getItems(const QString &query, bool allowParams) c
 
 void Plugin::handleTriggerQuery(albert::Query *query)
 {
+    TRACE_SCOPE("query", "ssh");
     auto r = getItems(query->string(), true);
     applyUsageScore(&r);
     for (const auto &[i, s] : r)
@@ -110,6 +99,7 @@ void Plugin::handleTriggerQuery(albert::Query *query)
 
 vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 {
+    TRACE_SCOPE("query", "ssh");
     return getItems(query->string(), false);
 }
 
@@ -117,7 +107,8 @@ QWidget *Plugin::buildConfigWidget()
 {
     auto *w = new QLabel(tr(
         "Provides session launch action items for host patterns in the "
-        "SSH config that do not contain globbing characters."
+        "SSH config that do not contain globbing characters and for the "
+        "hosts in the known_hosts files."
     ));
     w->setAlignment(Qt::AlignTop);
     w->setWordWrap(true);
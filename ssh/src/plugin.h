@@ -1,8 +1,8 @@
 // Copyright (c) 2017-2024 Manuel Schneider
 
 #pragma once
+#include "hoststore.h"
 #include <QRegularExpression>
-#include <QSet>
 #include <QString>
 #include <albert/extensionplugin.h>
 #include <albert/globalqueryhandler.h>
@@ -28,7 +28,7 @@ private:
     std::vector<albert::RankItem> getItems(const QString &query, bool allowParams) const;
 
     albert::StrongDependency<applications::Plugin> apps;
-    QSet<QString> hosts;
+    HostStore hosts;
     const QString tr_desc;
     const QString tr_conn;
     static const QRegularExpression regex_synopsis;
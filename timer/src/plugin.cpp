@@ -1,9 +1,10 @@
 // Copyright (c) 2024-2024 Manuel Schneider
 
+#include "batchmatcher.h"
 #include "plugin.h"
+#include "trace.h"
 #include <QDateTime>
 #include <QLocale>
-#include <albert/matcher.h>
 #include <albert/standarditem.h>
 #include <albert/util.h>
 using namespace albert::timer;
@@ -87,15 +88,16 @@ static uint parseDurationString(const QString &s)
 
 vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 {
+    TRACE_SCOPE("query", "timer");
     if (!query->isValid())
         return {};
 
-    Matcher matcher(query->string());
+    batchmatch::BatchMatcher matcher(query->string());
     vector<RankItem> r;
 
     // List matching timers
     for (auto &timer: timers_)
-        if(auto m = matcher.match(timer.objectName()); m)
+        if(auto m = matcher.match(timer.objectName()); m >= 0)
             r.emplace_back(makeTimerItem(timer), m);
 
     // Add new timer item
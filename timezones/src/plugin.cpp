@@ -1,64 +1,179 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
 #include "plugin.h"
+#include "trace.h"
 #include <QDateTime>
 #include <QLocale>
-#include <QTimeZone>
-#include <albert/matcher.h>
-#include <albert/standarditem.h>
+#include <albert/item.h>
+#include <albert/logging.h>
 #include <albert/util.h>
+#include <limits>
+ALBERT_LOGGING_CATEGORY("timezones")
 using namespace albert::timezones;
 using namespace albert;
 using namespace std;
 
+namespace {
+
+// Formats the time lazily, i.e. only for displayed items, and at most once per minute
+class TimeZoneItem : public Item
+{
+public:
+
+    TimeZoneItem(const TimeZoneEntry &e, const QStringList &icon_urls):
+        entry_(e), icon_urls_(icon_urls) {}
+
+    QString id() const override { return entry_.id; }
+
+    QString text() const override { return formatted().second; }
+
+    QString subtext() const override
+    {
+        QStringList tz_info{entry_.id, entry_.long_name, entry_.short_name, entry_.offset_name};
+        tz_info.removeDuplicates();
+        return tz_info.join(", ");
+    }
+
+    QString inputActionText() const override { return entry_.id; }
+
+    QStringList iconUrls() const override { return icon_urls_; }
+
+    vector<Action> actions() const override
+    {
+        const auto tr_copy = Plugin::tr("Copy to clipboard");
+        const auto tr_copy_placeholder = Plugin::tr("Copy '%1' to clipboard");
+
+        const auto [sf, lf] = formatted();
+        return {
+            {
+                QStringLiteral("cl"), tr_copy,
+                [=]{ setClipboardText(lf); }
+            },
+            {
+                QStringLiteral("cl"), tr_copy_placeholder.arg(sf),
+                [=]{ setClipboardText(sf); }
+            }
+        };
+    }
+
+private:
+
+    pair<QString, QString> formatted() const
+    {
+        const auto utc = QDateTime::currentDateTimeUtc();
+        const auto minute = utc.toSecsSinceEpoch() / 60;
+
+        lock_guard lock(mutex_);
+        if (minute_ != minute)
+        {
+            minute_ = minute;
+            QLocale loc;
+            auto dt = utc.toTimeZone(entry_.tz);
+            short_format_ = loc.toString(dt, QLocale::ShortFormat);
+            long_format_ = loc.toString(dt, QLocale::LongFormat);
+        }
+        return {short_format_, long_format_};
+    }
+
+    const TimeZoneEntry entry_;
+    const QStringList icon_urls_;
+    mutable mutex mutex_;
+    mutable qint64 minute_ = -1;
+    mutable QString short_format_;
+    mutable QString long_format_;
+
+};
+
+}
+
 QString Plugin::defaultTrigger() const
 { return tr("tz "); }
 
-void Plugin::handleTriggerQuery(Query *query)
+shared_ptr<const Plugin::Index> Plugin::index()
 {
     QLocale loc;
     auto utc = QDateTime::currentDateTimeUtc();
-    const auto tr_copy = tr("Copy to clipboard");
-    const auto tr_copy_placeholder = tr("Copy '%1' to clipboard");
 
-    for (auto &tz_id_barray: QTimeZone::availableTimeZoneIds())
+    lock_guard lock(index_mutex_);
+
+    // Display names depend on the locale and change with DST transitions only
+    if (index_ && index_->locale_name == loc.name() && utc.toMSecsSinceEpoch() < index_->valid_until)
+        return index_;
+
+    TRACE_SCOPE("timezones", "index");
+    auto index = make_shared<Index>();
+    index->locale_name = loc.name();
+    index->valid_until = numeric_limits<qint64>::max();
+    index->generation = index_ ? index_->generation + 1 : 0;
+
+    const auto ids = QTimeZone::availableTimeZoneIds();
+    index->entries.reserve(ids.size());
+    for (auto &tz_id_barray: ids)
     {
-        if (!query->isValid())
-            return;
+        auto &e = index->entries.emplace_back();
+        e.tz = QTimeZone(tz_id_barray);
+        auto dt = utc.toTimeZone(e.tz);
+
+        e.id = QString::fromLocal8Bit(tz_id_barray).replace("_", " ");
+        e.short_name = e.tz.displayName(dt, QTimeZone::ShortName, loc);
+        e.long_name = e.tz.displayName(dt, QTimeZone::LongName, loc);
+        e.offset_name = e.tz.displayName(dt, QTimeZone::OffsetName, loc);
 
-        auto tz = QTimeZone(tz_id_barray);
-        auto dt = utc.toTimeZone(tz);
+        index->candidates.add(e.id);
+        index->candidates.add(e.short_name);
+        index->candidates.add(e.long_name);
 
-        auto tz_id = QString::fromLocal8Bit(tz_id_barray).replace("_", " ");
-        auto tz_name_sf = tz.displayName(dt, QTimeZone::ShortName, loc);
-        auto tz_name_lf = tz.displayName(dt, QTimeZone::LongName, loc);
-        auto tz_name_of = tz.displayName(dt, QTimeZone::OffsetName, loc);
+        if (auto t = e.tz.nextTransition(utc); t.atUtc.isValid())
+            index->valid_until = min(index->valid_until, t.atUtc.toMSecsSinceEpoch());
+    }
+
+    DEBG << QStringLiteral("Indexed %1 time zones, valid until %2.")
+                .arg(index->entries.size())
+                .arg(QDateTime::fromMSecsSinceEpoch(index->valid_until).toString(Qt::ISODate));
 
-        Matcher matcher(query->string());
+    return index_ = ::move(index);
+}
 
-        if (matcher.match(tz_id) || matcher.match(tz_name_sf) || matcher.match(tz_name_lf))
+void Plugin::handleTriggerQuery(Query *query)
+{
+    TRACE_SCOPE("query", "timezones");
+    const auto idx = index();
+    batchmatch::BatchMatcher matcher(query->string());
+
+    vector<uint> matches;
+    auto add = [&](uint i)
+    {
+        matches.emplace_back(i);
+        query->add(make_shared<TimeZoneItem>(idx->entries[i], icon_urls));
+    };
+
+    // Typing mostly extends the previous query, verify its matches only
+    if (auto cached = refinement_cache_.candidates(query->string(), idx->generation))
+    {
+        for (auto i : *cached)
         {
-            QStringList tz_info{tz_id, tz_name_lf, tz_name_sf, tz_name_of};
-            tz_info.removeDuplicates();
-
-            auto sf = loc.toString(dt, QLocale::ShortFormat);
-            auto lf = loc.toString(dt, QLocale::LongFormat);
-
-            query->add(
-                StandardItem::make(
-                    tz_id, lf, tz_info.join(", "), tz_id, {QStringLiteral(":datetime")},
-                    {
-                        {
-                            QStringLiteral("cl"), tr_copy,
-                            [=]{ setClipboardText(lf); }
-                        },
-                        {
-                            QStringLiteral("cl"), tr_copy_placeholder.arg(sf),
-                            [=]{ setClipboardText(sf); }
-                        }
-                    }
-                )
-            );
+            if (!query->isValid())
+                return;
+            if (matcher.match(idx->candidates, 3 * i) >= 0
+                || matcher.match(idx->candidates, 3 * i + 1) >= 0
+                || matcher.match(idx->candidates, 3 * i + 2) >= 0)
+                add(i);
         }
     }
+    else
+    {
+        bool valid = true;
+        matcher.matchAll(idx->candidates, [&](size_t c, float)
+        {
+            if (!(valid = query->isValid()))
+                return false;
+            if (auto i = uint(c / 3); matches.empty() || matches.back() != i)
+                add(i);
+            return true;
+        });
+        if (!valid)
+            return;
+    }
+
+    refinement_cache_.store(query->string(), idx->generation, ::move(matches));
 }
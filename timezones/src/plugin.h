@@ -1,11 +1,28 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
 #pragma once
+#include "batchmatcher.h"
+#include "refinementcache.h"
+#include <QTimeZone>
 #include <albert/extensionplugin.h>
 #include <albert/triggerqueryhandler.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace albert::timezones
 {
+
+struct TimeZoneEntry
+{
+    QTimeZone tz;
+    QString id;
+    QString long_name;
+    QString short_name;
+    QString offset_name;
+};
+
+
 class Plugin : public albert::ExtensionPlugin,
                public albert::TriggerQueryHandler
 {
@@ -18,6 +35,23 @@ public:
 
     QStringList icon_urls{":timezones"};
 
+private:
+
+    struct Index
+    {
+        QString locale_name;
+        qint64 valid_until;  // msecs since epoch, next offset or name change of any zone
+        quint64 generation;
+        std::vector<TimeZoneEntry> entries;
+        batchmatch::Candidates candidates;  // id, short and long name per entry
+    };
+
+    std::shared_ptr<const Index> index();
+
+    std::mutex index_mutex_;
+    std::shared_ptr<const Index> index_;
+    RefinementCache<uint> refinement_cache_;  // entry indices
+
 };
 
 }
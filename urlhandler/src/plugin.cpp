@@ -1,61 +1,102 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #include "plugin.h"
-#include <QDesktopServices>
-#include <QFile>
-#include <QTextStream>
+#include "publicsuffix.h"
+#include "trace.h"
 #include <QUrl>
 #include <albert/standarditem.h>
 #include <albert/util.h>
 using namespace albert;
 using namespace std;
 
-Plugin::Plugin()
+// Strips "http://" or "https://". Returns false for any other scheme.
+static bool stripScheme(QStringView &s, bool &has_scheme)
 {
-    QFile file(":tlds");
-    if (!file.open(QIODevice::ReadOnly))
-        throw runtime_error("Unable to read tld resource");
-    valid_tlds << QTextStream(&file).readAll().split("\n");
-    std::sort(valid_tlds.begin(), valid_tlds.end());
+    has_scheme = false;
+    for (const auto scheme : { u"http://", u"https://" })
+    {
+        if (s.startsWith(QStringView(scheme), Qt::CaseInsensitive))
+        {
+            s = s.mid(QStringView(scheme).size());
+            has_scheme = true;
+            return true;
+        }
+    }
+    return !s.contains(u"://");
+}
+
+// Cheap byte level checks that reject inputs which can not be web URLs before
+// any QUrl work is done. Returns the host part of `s`.
+static bool prefilter(QStringView s, QStringView &host, bool &has_scheme)
+{
+    if (s.isEmpty() || s[0] == u'/' || s[0] == u'~' || s[0] == u'.')  // local paths
+        return false;
+
+    for (const auto c : s)
+        if (c.unicode() <= u' ' || c.unicode() == 0x7f)  // whitespace and controls
+            return false;
+
+    if (!stripScheme(s, has_scheme))
+        return false;
+
+    // authority := [userinfo@]host[:port]
+    qsizetype end = s.size();
+    for (qsizetype i = 0; i < s.size(); ++i)
+        if (s[i] == u'/' || s[i] == u'?' || s[i] == u'#')
+        {
+            end = i;
+            break;
+        }
+    host = s.left(end);
+    if (auto at = host.lastIndexOf(u'@'); at >= 0)
+        host = host.mid(at + 1);
+    if (auto colon = host.lastIndexOf(u':'); colon >= 0 && !host.endsWith(u']'))
+        host = host.left(colon);
+
+    return !host.isEmpty() && (has_scheme || host.contains(u'.'));
 }
 
 vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 {
+    TRACE_SCOPE("query", "urlhandler");
     vector<RankItem> results;
     auto trimmed = query->string().trimmed();
-    auto url = QUrl::fromUserInput(trimmed);
 
-    // Check syntax and TLD validity
-    if (!url.isValid())
+    QStringView host;
+    bool has_scheme;
+    if (!prefilter(trimmed, host, has_scheme))
         return results;
 
-    if ((url.scheme() == "http" || url.scheme() == "https")){
-
-        auto tld = url.host().section('.', -1, -1);
-
-        // Skip tld only queries
-        if (trimmed.size() == tld.size())
+    // Validate the public suffix if scheme is not given (http assumed). Skip
+    // suffix only queries, e.g. "co.uk", a registrable label is required.
+    if (!has_scheme)
+    {
+        auto suffix_length = publicSuffixLength({host.utf16(), size_t(host.size())});
+        if (suffix_length == 0 || suffix_length >= size_t(host.size()))
             return results;
+    }
 
-        // validate top level domain if scheme is not given (http assumed)
-        if (tld.size() == 0 || (!trimmed.startsWith("http") && !binary_search(valid_tlds.begin(), valid_tlds.end(), tld)))
-            return results;
+    auto url = QUrl::fromUserInput(trimmed);
 
-        results.emplace_back(
-            StandardItem::make(
-                "url_hanlder",
-                tr("Open URL in browser"),
-                tr("Open %1").arg(url.authority()),
-                {"xdg:www", "xdg:web-browser", "xdg:emblem-web", ":default"},
+    // Check syntax
+    if (!url.isValid() || (url.scheme() != "http" && url.scheme() != "https"))
+        return results;
+
+    results.emplace_back(
+        StandardItem::make(
+            "url_hanlder",
+            tr("Open URL in browser"),
+            tr("Open %1").arg(url.authority()),
+            {"xdg:www", "xdg:web-browser", "xdg:emblem-web", ":default"},
+            {
                 {
-                    {
-                        "open_url", tr("Open URL"),
-                        [url](){ openUrl(url); }
-                    }
+                    "open_url", tr("Open URL"),
+                    [url](){ openUrl(url); }
                 }
-            ),
-            1.0f
-        );
-    }
+            }
+        ),
+        1.0f
+    );
+
     return results;
 }
@@ -11,11 +11,6 @@ class Plugin : public albert::ExtensionPlugin,
 
 public:
 
-    Plugin();
     std::vector<albert::RankItem> handleGlobalQuery(const albert::Query*) override;
 
-private:
-
-    QStringList valid_tlds;
-
 };
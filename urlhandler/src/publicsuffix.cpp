@@ -0,0 +1,74 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "publicsuffix.h"
+#include "publicsuffixdata.h"
+#include <algorithm>
+using namespace std;
+
+static constexpr uint8_t RULE = 1;
+static constexpr uint8_t EXCEPTION = 2;
+
+static inline char16_t toLower(char16_t c)
+{ return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+
+// Three way comparison of a trie label and a host label
+static int compare(const SuffixTrieEdge &edge, u16string_view label)
+{
+    const char *l = suffix_labels + edge.label_offset;
+    const size_t n = min<size_t>(edge.label_length, label.size());
+    for (size_t i = 0; i < n; ++i)
+        if (int d = int(char16_t(l[i])) - int(toLower(label[i])); d)
+            return d;
+    return int(edge.label_length) - int(label.size());
+}
+
+static const SuffixTrieNode *child(const SuffixTrieNode &node, u16string_view label)
+{
+    auto begin = suffix_edges + node.first_edge;
+    auto end = begin + node.edge_count;
+    auto it = lower_bound(begin, end, label,
+                          [](const SuffixTrieEdge &e, u16string_view l){ return compare(e, l) < 0; });
+    return (it != end && compare(*it, label) == 0) ? &suffix_nodes[it->node] : nullptr;
+}
+
+size_t publicSuffixLength(u16string_view host)
+{
+    static const u16string_view wildcard = u"*";
+
+    const SuffixTrieNode *node = suffix_nodes;
+    size_t suffix_length = 0;
+    size_t end = host.size();
+
+    while (end > 0)
+    {
+        const size_t dot = host.rfind(u'.', end - 1);
+        const size_t begin = dot == u16string_view::npos ? 0 : dot + 1;
+        const auto label = host.substr(begin, end - begin);
+        const size_t length = host.size() - begin;  // suffix including this label
+
+        if (label.empty())
+            break;
+
+        const auto *exact = child(*node, label);
+
+        // Exception rules end the suffix before their leftmost label
+        if (exact && exact->flags & EXCEPTION)
+            return end == host.size() ? 0 : host.size() - end - 1;
+
+        if (const auto *any = child(*node, wildcard); any && any->flags & RULE)
+            suffix_length = length;
+
+        if (!exact)
+            break;
+
+        if (exact->flags & RULE)
+            suffix_length = length;
+
+        node = exact;
+        if (dot == u16string_view::npos)
+            break;
+        end = dot;
+    }
+
+    return suffix_length;
+}
@@ -0,0 +1,28 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+struct SuffixTrieNode
+{
+    uint16_t first_edge;
+    uint16_t edge_count;
+    uint8_t flags;
+};
+
+struct SuffixTrieEdge
+{
+    uint32_t label_offset;
+    uint16_t label_length;
+    uint16_t node;
+};
+
+///
+/// Returns the length of the public suffix of `host`, e.g. 5 for "co.uk" in
+/// "www.example.co.uk", or 0 if no rule of the compiled suffix list matches.
+///
+/// `host` is matched case insensitively, from right to left, in O(length) and
+/// without allocations. Non ASCII hosts have to be punycode encoded.
+///
+std::size_t publicSuffixLength(std::u16string_view host);
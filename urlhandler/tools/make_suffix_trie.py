@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 Manuel Schneider
+
+"""
+Compiles a public suffix list into a label trie embedded as C++ arrays.
+
+Input is the publicsuffix.org format: one rule per line, '//' comments, '*'
+wildcard labels and '!' exception rules. A plain list of top level domains is
+a valid subset. Labels are stored right to left, i.e. the root has the TLDs as
+children. Children are sorted by label to allow binary search. Identical labels
+share their bytes in the string pool.
+
+Usage: make_suffix_trie.py <suffix list> <output header>
+"""
+
+import sys
+
+RULE = 1
+EXCEPTION = 2
+
+
+class Node:
+    def __init__(self):
+        self.children = {}
+        self.flags = 0
+
+
+def parse(path):
+    root = Node()
+    with open(path, encoding='utf-8') as f:
+        for line in f:
+            rule = line.split()[0] if line.split() else ''
+            if not rule or rule.startswith('//'):
+                continue
+
+            flag = RULE
+            if rule.startswith('!'):
+                flag = EXCEPTION
+                rule = rule[1:]
+
+            node = root
+            for label in reversed(rule.lower().encode('idna').decode('ascii').split('.')):
+                node = node.children.setdefault(label, Node())
+            node.flags |= flag
+    return root
+
+
+def flatten(root):
+    nodes = [root]      # breadth first, children of a node are contiguous
+    edges = []          # (label, node index)
+    ranges = []         # per node (first edge, edge count)
+    i = 0
+    while i < len(nodes):
+        node = nodes[i]
+        first = len(edges)
+        for label in sorted(node.children):
+            edges.append((label, len(nodes)))
+            nodes.append(node.children[label])
+        ranges.append((first, len(node.children)))
+        i += 1
+    return nodes, edges, ranges
+
+
+def main(src, dst):
+    nodes, edges, ranges = flatten(parse(src))
+
+    pool = ''
+    offsets = {}
+    for label, _ in edges:
+        if label not in offsets:
+            offsets[label] = len(pool)
+            pool += label
+
+    if len(pool) > 0xFFFFFF or len(edges) > 0xFFFF or len(nodes) > 0xFFFF:
+        sys.exit('Suffix list exceeds the limits of the trie encoding')
+
+    out = ['// Generated by make_suffix_trie.py. Do not edit.', '',
+           '#pragma once', '',
+           'static constexpr char suffix_labels[] =']
+    for i in range(0, len(pool), 72):
+        out.append('    "%s"' % pool[i:i + 72])
+    out[-1] += ';'
+
+    out += ['', 'static constexpr SuffixTrieNode suffix_nodes[] = {']
+    for node, (first, count) in zip(nodes, ranges):
+        out.append('    {%d, %d, %d},' % (first, count, node.flags))
+    out += ['};', '', 'static constexpr SuffixTrieEdge suffix_edges[] = {']
+    for label, node in edges:
+        out.append('    {%d, %d, %d},' % (offsets[label], len(label), node))
+    out += ['};', '']
+
+    with open(dst, 'w', encoding='ascii') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    main(sys.argv[1], sys.argv[2])
@@ -3,6 +3,7 @@
 
 #include "configwidget.h"
 #include "plugin.h"
+#include "trace.h"
 #include <QDesktopServices>
 #include <QDir>
 #include <QFile>
@@ -11,10 +12,10 @@
 #include <QJsonObject>
 #include <QUrl>
 #include <albert/logging.h>
-#include <albert/matcher.h>
 #include <albert/standarditem.h>
 #include <albert/util.h>
 #include <array>
+#include <map>
 #include <vector>
 ALBERT_LOGGING_CATEGORY("websearch")
 using namespace albert;
@@ -29,6 +30,14 @@ static const char * CK_ENGINE_URL      = "url";
 static const char * CK_ENGINE_TRIGGER  = "trigger";
 static const char * CK_ENGINE_ICON     = "iconPath";
 static const char * CK_ENGINE_FALLBACK = "fallback";
+
+// Trigger and name, shortest first (yield higher scores) (*)
+pair<const QString&, const QString&> keywords(const SearchEngine &e)
+{
+    if (e.name.length() < e.trigger.length())
+        return {e.name, e.trigger};
+    return {e.trigger, e.name};
+}
 }
 
 static QByteArray serializeEngines(const vector<SearchEngine> &engines)
@@ -100,6 +109,14 @@ void Plugin::setEngines(vector<SearchEngine> engines)
 
     searchEngines_ = ::move(engines);
 
+    keywords_ = {};
+    for (const auto &e : searchEngines_)
+    {
+        auto [shorter, longer] = keywords(e);
+        keywords_.add(shorter);
+        keywords_.add(longer);
+    }
+
     QFile f(QDir(configLocation()).filePath(ENGINES_FILE_NAME));
     if (f.open(QIODevice::WriteOnly))
         f.write(serializeEngines(searchEngines_));
@@ -149,24 +166,24 @@ static shared_ptr<StandardItem> buildItem(const SearchEngine &se, const QString
 
 vector<RankItem> Plugin::handleGlobalQuery(const Query *query)
 {
+    TRACE_SCOPE("query", "websearch");
     vector<RankItem> results;
 
-    for (const SearchEngine &e: searchEngines_)
-    {
-        vector<QString> S{ e.trigger, e.name };
-
-        // sort shortest first (yield higher scores) (*)
-        sort(S.begin(), S.end(), [](auto &a, auto &b){ return a.length() < b.length(); });
+    // The query prefix of the keyword length is matched, one matcher per length
+    map<qsizetype, batchmatch::BatchMatcher> matchers;
+    auto matcher = [&](qsizetype length) -> const batchmatch::BatchMatcher &
+    { return matchers.try_emplace(length, query->string().left(length)).first->second; };
 
-        for (const auto &s : S)
+    for (size_t i = 0; i < searchEngines_.size(); ++i)
+    {
+        const SearchEngine &e = searchEngines_[i];
+        auto [shorter, longer] = keywords(e);
+        for (size_t k : {2 * i, 2 * i + 1})
         {
-            auto keyword = QStringLiteral("%1 ").arg(s.toLower());
-            auto prefix = query->string().toLower().left(keyword.size());
-            Matcher matcher(prefix, {});
-            Match m = matcher.match(keyword);
-            if (m)
+            auto prefix_size = (k % 2 ? longer : shorter).size() + 1;  // including the separating space
+            if (auto m = matcher(prefix_size).match(keywords_, k); m >= 0)
             {
-                results.emplace_back(buildItem(e, query->string().mid(prefix.size())), m);
+                results.emplace_back(buildItem(e, query->string().mid(prefix_size)), m);
                 // max one of these icons, assumption: following cant yield higher scores (*)
                 break;
             }
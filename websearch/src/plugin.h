@@ -1,6 +1,7 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #pragma once
+#include "batchmatcher.h"
 #include <QString>
 #include <albert/extensionplugin.h>
 #include <albert/fallbackhandler.h>
@@ -35,6 +36,7 @@ private:
     QWidget *buildConfigWidget() override;
 
     std::vector<SearchEngine> searchEngines_;
+    batchmatch::Candidates keywords_;  // shorter, then longer of trigger and name per engine
 
 signals:
     void enginesChanged(const std::vector<SearchEngine> &engines);
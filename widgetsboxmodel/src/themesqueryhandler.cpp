@@ -1,6 +1,7 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #include "themesqueryhandler.h"
+#include "trace.h"
 #include "window.h"
 #include <albert/standarditem.h>
 #include <albert/util.h>
@@ -23,11 +24,23 @@ QString ThemesQueryHandler::defaultTrigger() const { return "theme "; }
 
 void ThemesQueryHandler::handleTriggerQuery(Query *query)
 {
+    TRACE_SCOPE("query", "themes");
     auto trimmed = query->string().trimmed();
-    for (const auto &[name, path] : window->themes)
+
+    vector<const pair<const QString, QString>*> candidates;
+    if (auto cached = refinement_cache.candidates(query->string(), 0))
+        candidates = ::move(*cached);
+    else
+        for (const auto &theme : window->themes)
+            candidates.emplace_back(&theme);
+
+    vector<const pair<const QString, QString>*> matches;
+    for (const auto *theme : candidates)
     {
+        const auto &[name, path] = *theme;
         if (name.contains(trimmed, Qt::CaseInsensitive))
         {
+            matches.emplace_back(theme);
             query->add(
                 StandardItem::make(
                     QString("theme_%1").arg(name),
@@ -56,5 +69,6 @@ void ThemesQueryHandler::handleTriggerQuery(Query *query)
             );
         }
     }
-}
 
+    refinement_cache.store(query->string(), 0, ::move(matches));
+}
@@ -2,7 +2,9 @@
 
 #pragma once
 
+#include "refinementcache.h"
 #include <albert/triggerqueryhandler.h>
+#include <map>
 class Window;
 
 class ThemesQueryHandler : public albert::TriggerQueryHandler
@@ -20,5 +22,6 @@ public:
 private:
 
     Window *window;
+    RefinementCache<const std::pair<const QString, QString>*> refinement_cache;  // themes are static
 };
 